@@ -1,6 +1,8 @@
 #ifndef ACTIVATION_FUNCTION_H
 #define ACTIVATION_FUNCTION_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <ostream>
 
@@ -13,6 +15,12 @@ enum class ActivationType {
     LINEAR
 };
 
+// Whether a value read from a model file names an ActivationType; negative
+// ints convert to large values and fail too
+inline bool is_activation_type(uint32_t value) {
+    return value <= static_cast<uint32_t>(ActivationType::LINEAR);
+}
+
 // Operator<< for ActivationType to support stream output
 inline std::ostream& operator<<(std::ostream& os, const ActivationType& type) {
     switch (type) {
@@ -25,21 +33,37 @@ inline std::ostream& operator<<(std::ostream& os, const ActivationType& type) {
     }
 }
 
-// Abstract base class for polymorphism - demonstrates virtual methods
+// Span-wide kernels of one activation (SIMD-dispatched, see simd_kernels.h).
+// The network resolves them once per pass, so the hot loops make plain
+// function calls over whole layers instead of a virtual call per element.
+template<typename T>
+struct ActivationKernels {
+    // x = f(x), in place
+    void (*activate)(T* x, size_t n);
+    // d *= f'(y), with the derivative expressed through the output y = f(x)
+    void (*derivative)(const T* y, T* d, size_t n);
+};
+
+// Abstract base class for polymorphism - demonstrates virtual methods.
+// Templated on the scalar type; float is the production default.
+template<typename T = float>
 class ActivationFunction {
 public:
     virtual ~ActivationFunction() = default;
 
-    // Pure virtual methods - must be overridden
-    virtual double activate(double x) const = 0;
-    virtual double derivative(double x) const = 0;
+    // Pure virtual methods - must be overridden. derivative takes the
+    // activation output, like the span kernels.
+    virtual T activate(T x) const = 0;
+    virtual T derivative(T x) const = 0;
     virtual ActivationType getType() const = 0;
+    virtual ActivationKernels<T> kernels() const = 0;
 };
 
-// Factory for creating activation functions
+// Factory for creating activation functions (float and double)
 class ActivationFactory {
 public:
-    static std::unique_ptr<ActivationFunction> create(ActivationType type);
+    template<typename T = float>
+    static std::unique_ptr<ActivationFunction<T>> create(ActivationType type);
 };
 
 #endif
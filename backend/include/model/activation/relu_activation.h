@@ -2,22 +2,28 @@
 #define RELU_ACTIVATION_H
 
 #include "activation_function.h"
+#include "simd_kernels.h"
 #include <algorithm>
 
 // Concrete class - inheritance and polymorphism
-class ReLUActivation : public ActivationFunction {
+template<typename T = float>
+class ReLUActivation : public ActivationFunction<T> {
 public:
-    double activate(double x) const override {
-        return std::max(0.0, x);
+    T activate(T x) const override {
+        return std::max(T(0), x);
     }
 
-    double derivative(double x) const override {
-        return x > 0.0 ? 1.0 : 0.0;
+    T derivative(T x) const override {
+        return x > T(0) ? T(1) : T(0);
     }
 
     ActivationType getType() const override {
         return ActivationType::RELU;
     }
+
+    ActivationKernels<T> kernels() const override {
+        return {simd<T>().relu, simd<T>().relu_grad};
+    }
 };
 
 #endif
@@ -2,22 +2,36 @@
 #define SIGMOID_ACTIVATION_H
 
 #include "activation_function.h"
+#include "fast_math.h"
+#include "simd_kernels.h"
 #include <cmath>
+#include <type_traits>
 
 // Concrete class - inheritance and polymorphism
-class SigmoidActivation : public ActivationFunction {
+template<typename T = float>
+class SigmoidActivation : public ActivationFunction<T> {
 public:
-    double activate(double x) const override {
-        return 1.0 / (1.0 + std::exp(-x));
+    T activate(T x) const override {
+        return T(1) / (T(1) + std::exp(-x));
     }
 
-    double derivative(double x) const override {
-        return x * (1.0 - x);
+    T derivative(T x) const override {
+        return x * (T(1) - x);
     }
 
     ActivationType getType() const override {
         return ActivationType::SIGMOID;
     }
+
+    // float forward passes take the approximate kernels of the configured
+    // MathAccuracy; double stays on libm
+    ActivationKernels<T> kernels() const override {
+        if constexpr (std::is_same<T, float>::value) {
+            return {math_kernels().sigmoid, simd<T>().sigmoid_grad};
+        } else {
+            return {simd<T>().sigmoid, simd<T>().sigmoid_grad};
+        }
+    }
 };
 
 #endif
@@ -2,22 +2,36 @@
 #define TANH_ACTIVATION_H
 
 #include "activation_function.h"
+#include "fast_math.h"
+#include "simd_kernels.h"
 #include <cmath>
+#include <type_traits>
 
 // Concrete class - inheritance and polymorphism
-class TanhActivation : public ActivationFunction {
+template<typename T = float>
+class TanhActivation : public ActivationFunction<T> {
 public:
-    double activate(double x) const override {
+    T activate(T x) const override {
         return std::tanh(x);
     }
 
-    double derivative(double x) const override {
-        return 1.0 - x * x;
+    T derivative(T x) const override {
+        return T(1) - x * x;
     }
 
     ActivationType getType() const override {
         return ActivationType::TANH;
     }
+
+    // float forward passes take the approximate kernels of the configured
+    // MathAccuracy; double stays on libm
+    ActivationKernels<T> kernels() const override {
+        if constexpr (std::is_same<T, float>::value) {
+            return {math_kernels().tanh, simd<T>().tanh_grad};
+        } else {
+            return {simd<T>().tanh, simd<T>().tanh_grad};
+        }
+    }
 };
 
 #endif
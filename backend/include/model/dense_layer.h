@@ -0,0 +1,83 @@
+#ifndef DENSE_LAYER_H
+#define DENSE_LAYER_H
+
+#include <cstddef>
+#include "aligned_buffer.h"
+
+// Parameters of one fully connected layer kept in a single aligned block:
+// the row-major weight matrix (outputs x inputs) followed by the biases,
+// which start on their own cache line.
+template<typename T>
+struct DenseLayer {
+    int inputs = 0;
+    int outputs = 0;
+    size_t bias_offset = 0;
+    AlignedVector<T> params;
+
+    // Set when the block lives in a read-only memory-mapped model file
+    // instead of params. Only the const accessors see it; call
+    // materialize() before writing to the layer.
+    const T* mapped = nullptr;
+
+    // Optional column-major copy of the weights (inputs x outputs), so that
+    // W^T products can also stream through memory in order
+    AlignedVector<T> weights_cm;
+
+    DenseLayer() = default;
+
+    DenseLayer(int in, int out)
+        : inputs(in), outputs(out),
+          bias_offset(align_elements<T>(static_cast<size_t>(in) * out)),
+          params(bias_offset + out, T()) {}
+
+    // View of a block laid out like params (64-byte aligned) owned elsewhere
+    static DenseLayer view(int in, int out, const T* block) {
+        DenseLayer layer;
+        layer.inputs = in;
+        layer.outputs = out;
+        layer.bias_offset = align_elements<T>(static_cast<size_t>(in) * out);
+        layer.mapped = block;
+        return layer;
+    }
+
+    size_t weight_count() const { return static_cast<size_t>(inputs) * outputs; }
+    size_t block_size() const { return bias_offset + outputs; }
+
+    const T* data() const { return mapped != nullptr ? mapped : params.data(); }
+
+    T* weights() { return params.data(); }
+    const T* weights() const { return data(); }
+
+    T* row(int neuron) { return params.data() + static_cast<size_t>(neuron) * inputs; }
+    const T* row(int neuron) const { return data() + static_cast<size_t>(neuron) * inputs; }
+
+    T* biases() { return params.data() + bias_offset; }
+    const T* biases() const { return data() + bias_offset; }
+
+    // Copy a mapped block into params so the layer can be trained
+    void materialize() {
+        if (mapped == nullptr) return;
+        params.assign(mapped, mapped + block_size());
+        mapped = nullptr;
+    }
+
+    bool has_column_major() const { return !weights_cm.empty(); }
+
+    // Rebuild the column-major copy from the row-major weights
+    void sync_column_major() {
+        weights_cm.resize(weight_count());
+        const T* w = data();
+        for (int j = 0; j < outputs; j++) {
+            for (int i = 0; i < inputs; i++) {
+                weights_cm[static_cast<size_t>(i) * outputs + j] = w[static_cast<size_t>(j) * inputs + i];
+            }
+        }
+    }
+
+    void drop_column_major() {
+        weights_cm.clear();
+        weights_cm.shrink_to_fit();
+    }
+};
+
+#endif
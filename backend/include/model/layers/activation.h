@@ -0,0 +1,66 @@
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include "layer.h"
+#include "activation_function.h"
+
+// Element-wise activation (sigmoid, ReLU or tanh) as a layer of its own, so
+// every layer of a network can pick its own. Runs in place.
+template<typename T = float>
+class Activation : public Layer<T> {
+private:
+    std::unique_ptr<ActivationFunction<T>> function;
+    ActivationType type;
+    size_t width = 0;
+
+public:
+    explicit Activation(ActivationType act_type) : type(act_type) {
+        if (type == ActivationType::SOFTMAX || type == ActivationType::LINEAR) {
+            throw std::invalid_argument("Use the Softmax layer, or no layer for linear outputs");
+        }
+        function = ActivationFactory::create<T>(type);
+    }
+
+    LayerKind kind() const override { return LayerKind::ACTIVATION; }
+
+    LayerConfig config() const override {
+        LayerConfig c;
+        c.kind = LayerKind::ACTIVATION;
+        c.args[0] = static_cast<int32_t>(type);
+        return c;
+    }
+
+    std::string describe() const override {
+        std::ostringstream os;
+        os << "Activation(" << type << ")";
+        return os.str();
+    }
+
+    Shape build(const Shape& input) override {
+        width = input.size();
+        return input;
+    }
+
+    void forward(const T* in, T* out, size_t n, bool) override {
+        if (out != in) std::copy(in, in + n * width, out);
+        function->kernels().activate(out, n * width);
+    }
+
+    void backward(const T*, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T*) override {
+        if (grad_in != grad_out) std::copy(grad_out, grad_out + n * width, grad_in);
+        function->kernels().derivative(out, grad_in, n * width);
+    }
+
+    bool in_place() const override { return true; }
+
+    // Span kernels for plans that fuse this activation into the layer before it
+    ActivationKernels<T> kernels() const { return function->kernels(); }
+    ActivationType getType() const { return type; }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef CONV2D_H
+#define CONV2D_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "layer.h"
+#include "dense_layer.h"
+#include "im2col.h"
+
+// How Conv2D computes its forward pass. AUTO resolves by shape when the
+// layer is built; backward always uses im2col.
+enum class ConvAlgorithm {
+    AUTO,
+    IM2COL,
+    DIRECT,        // NCHWc direct kernels (direct_conv.h)
+    WINOGRAD_2X2,  // F(2x2, 3x3)
+    WINOGRAD_4X4   // F(4x4, 3x3)
+};
+
+const char* conv_algorithm_name(ConvAlgorithm algorithm);
+
+// 2-D convolution over C x H x W samples with square kernels. Every sample
+// is unrolled with im2col and multiplied with the filter matrix on the
+// blocked GEMM, run by direct kernels on a channel-blocked copy of the
+// sample, or for 3x3 stride 1 kernels run through Winograd's tile
+// transforms (winograd.h); the batch is split across threads.
+template<typename T = float>
+class Conv2D : public Layer<T> {
+private:
+    int filters;
+    int kernel;
+    int stride;
+    int padding;
+    ConvGeometry geometry;
+
+    // filters x (C * kernel * kernel) filter matrix followed by the biases,
+    // in the same aligned block layout as a dense layer
+    DenseLayer<T> block;
+
+    int num_threads = 1;
+
+    ConvAlgorithm requested = ConvAlgorithm::AUTO;
+    ConvAlgorithm algorithm = ConvAlgorithm::IM2COL;
+
+    // Filters repacked for the forward algorithm (Winograd domain, or NCHWc
+    // blocks followed by the padded biases). params_version moves on
+    // whenever the parameters are handed out for writing, and a forward
+    // pass repacks when packed_version is behind it; passes that find the
+    // packing current read it without taking packed_mutex.
+    AlignedVector<T> packed_filters;
+    std::atomic<uint64_t> params_version{1};
+    std::atomic<uint64_t> packed_version{0};
+    std::mutex packed_mutex;  // serializes repacking
+
+    // Parameter gradients of the backward threads other than the caller's,
+    // summed into param_grads after the pass
+    std::vector<AlignedVector<T>> partial_grads;
+
+    ConvAlgorithm resolve_algorithm() const;
+    const T* forward_filters();
+
+    void forward_direct(const T* in, T* out, size_t n);
+    template<int M>
+    void forward_winograd(const T* in, T* out, size_t n);
+
+public:
+    // padding = kernel / 2 keeps H x W for odd kernels at stride 1
+    Conv2D(int filters, int kernel, int stride = 1, int padding = 0);
+
+    LayerKind kind() const override { return LayerKind::CONV2D; }
+    std::string describe() const override;
+    LayerConfig config() const override;
+
+    Shape build(const Shape& input) override;
+    void forward(const T* in, T* out, size_t n, bool training) override;
+    void backward(const T* in, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T* param_grads) override;
+
+    // One patch matrix for forward, plus its gradient for backward, or the
+    // blocked sample and output of a direct pass, or the transformed tiles
+    // and products of a Winograd pass
+    size_t workspace_bytes() const override;
+    void set_num_threads(int threads) override;
+
+    // AUTO picks Winograd F(4x4) for 3x3 stride 1 layers with 32 or more
+    // filters, an output of 16x16 or more and channels x output width of
+    // at least 1024 (32 channels at 32x32, 64 at 16x16); below that the tile
+    // transforms and the small per-point GEMMs cost more than they save.
+    // Other layers run direct, except pointwise layers (a plain GEMM) and
+    // single-channel inputs, whose patch matrix is small enough for im2col
+    // to win. F(2x2) is only used when
+    // forced. Throws std::invalid_argument if a Winograd algorithm is forced
+    // on another kernel or stride.
+    void set_algorithm(ConvAlgorithm requested_algorithm);
+    ConvAlgorithm get_algorithm() const { return algorithm; }
+
+    // Handing out the parameters for writing (SGD, load) marks the packed
+    // filters stale; write before the next forward pass, and fetch the
+    // pointer again to write after one
+    size_t parameter_count() const override { return block.params.size(); }
+    T* parameters() override {
+        params_version++;
+        return block.params.data();
+    }
+
+    const ConvGeometry& get_geometry() const { return geometry; }
+    const DenseLayer<T>& get_block() const { return block; }
+    DenseLayer<T>& get_block() {
+        params_version++;
+        return block;
+    }
+};
+
+// 1x1 convolution mixing the channels at every pixel: one GEMM per sample
+// on the sample as stored. Saved and loaded as a Conv2D.
+template<typename T = float>
+class PointwiseConv2D : public Conv2D<T> {
+public:
+    explicit PointwiseConv2D(int filters) : Conv2D<T>(filters, 1) {}
+};
+
+#endif
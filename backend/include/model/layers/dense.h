@@ -0,0 +1,95 @@
+#ifndef DENSE_H
+#define DENSE_H
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include "layer.h"
+#include "dense_layer.h"
+#include "gemm.h"
+#include "simd_kernels.h"
+
+// Fully connected layer: out = in * W^T + b. The input size is taken from
+// the previous layer when the network is built; any input shape is read
+// as a flat row.
+template<typename T = float>
+class Dense : public Layer<T> {
+private:
+    int units;
+    DenseLayer<T> block;
+    int num_threads = 1;
+
+public:
+    explicit Dense(int outputs) : units(outputs) {
+        if (outputs <= 0) throw std::invalid_argument("Dense layer needs at least one unit");
+    }
+
+    LayerKind kind() const override { return LayerKind::DENSE; }
+
+    LayerConfig config() const override {
+        LayerConfig c;
+        c.kind = LayerKind::DENSE;
+        c.args[0] = units;
+        return c;
+    }
+
+    std::string describe() const override {
+        return "Dense(" + std::to_string(block.inputs) + " -> " + std::to_string(units) + ")";
+    }
+
+    Shape build(const Shape& input) override {
+        int inputs = static_cast<int>(input.size());
+        if (inputs == 0) throw std::invalid_argument("Dense layer needs a non-empty input");
+        if (block.inputs == inputs) return Shape::flat(units);
+        if (block.inputs != 0) {
+            throw std::invalid_argument("Dense layer was already built for " +
+                                        std::to_string(block.inputs) + " inputs");
+        }
+
+        // Same initialization as NeuralNetwork
+        block = DenseLayer<T>(inputs, units);
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::normal_distribution<> d(0, 0.1);
+        for (int j = 0; j < units; j++) {
+            T* w = block.row(j);
+            for (int k = 0; k < inputs; k++) {
+                w[k] = d(gen);
+            }
+            block.biases()[j] = d(gen);
+        }
+        return Shape::flat(units);
+    }
+
+    void forward(const T* in, T* out, size_t n, bool) override {
+        gemm(Transpose::NO, Transpose::YES, n, block.outputs, block.inputs, T(1),
+             in, block.inputs, block.weights(), block.inputs, T(0), out, block.outputs, num_threads);
+        simd<T>().bias_add(out, block.biases(), n, block.outputs);
+    }
+
+    void backward(const T* in, const T*, const T* grad_out, T* grad_in,
+                  size_t n, T* param_grads) override {
+        // dW += grad_out^T * in, db += column sums of grad_out
+        gemm(Transpose::YES, Transpose::NO, block.outputs, block.inputs, n, T(1),
+             grad_out, block.outputs, in, block.inputs, T(1), param_grads, block.inputs, num_threads);
+        for (size_t r = 0; r < n; r++) {
+            simd<T>().axpy(T(1), grad_out + r * block.outputs, param_grads + block.bias_offset,
+                           block.outputs);
+        }
+        if (grad_in != nullptr) {
+            gemm(Transpose::NO, Transpose::NO, n, block.inputs, block.outputs, T(1),
+                 grad_out, block.outputs, block.weights(), block.inputs,
+                 T(0), grad_in, block.inputs, num_threads);
+        }
+    }
+
+    void set_num_threads(int threads) override { num_threads = std::max(1, threads); }
+
+    size_t parameter_count() const override { return block.params.size(); }
+    T* parameters() override { return block.params.data(); }
+
+    const DenseLayer<T>& get_block() const { return block; }
+    DenseLayer<T>& get_block() { return block; }
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef DEPTHWISE_CONV2D_H
+#define DEPTHWISE_CONV2D_H
+
+#include "layer.h"
+#include "dense_layer.h"
+#include "im2col.h"
+
+// Depthwise 2-D convolution: every channel has its own square kernel and
+// no channels are mixed (depth multiplier 1). Followed by a pointwise
+// Conv2D it forms a depthwise-separable block at a fraction of a full
+// convolution's cost. Forward runs the vectorized row kernels of
+// direct_conv.h over each zero-padded plane; planes are split across
+// threads, and backward splits the channels.
+template<typename T = float>
+class DepthwiseConv2D : public Layer<T> {
+private:
+    int kernel;
+    int stride;
+    int padding;
+    ConvGeometry geometry;
+
+    // channels x (kernel * kernel) taps followed by the biases, in the same
+    // aligned block layout as a dense layer
+    DenseLayer<T> block;
+
+    int num_threads = 1;
+
+public:
+    // padding = kernel / 2 keeps H x W for odd kernels at stride 1
+    explicit DepthwiseConv2D(int kernel, int stride = 1, int padding = 0);
+
+    LayerKind kind() const override { return LayerKind::DEPTHWISE_CONV2D; }
+    std::string describe() const override;
+    LayerConfig config() const override;
+
+    Shape build(const Shape& input) override;
+    void forward(const T* in, T* out, size_t n, bool training) override;
+    void backward(const T* in, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T* param_grads) override;
+
+    // One padded plane for forward, plus its gradient for backward
+    size_t workspace_bytes() const override;
+    void set_num_threads(int threads) override;
+
+    size_t parameter_count() const override { return block.params.size(); }
+    T* parameters() override { return block.params.data(); }
+
+    const ConvGeometry& get_geometry() const { return geometry; }
+    const DenseLayer<T>& get_block() const { return block; }
+    DenseLayer<T>& get_block() { return block; }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef DROPOUT_H
+#define DROPOUT_H
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "layer.h"
+#include "aligned_buffer.h"
+
+// Inverted dropout: while training every value is zeroed with probability
+// rate and the survivors are scaled by 1 / (1 - rate), so inference is the
+// identity and execution plans leave the layer out. Runs in place.
+template<typename T = float>
+class Dropout : public Layer<T> {
+private:
+    double rate;
+    size_t width = 0;
+    std::mt19937 gen;
+    // Per-value factor of the last training pass (0 or 1 / (1 - rate))
+    AlignedVector<T> mask;
+
+public:
+    explicit Dropout(double drop_rate) : rate(drop_rate), gen(std::random_device()()) {
+        if (rate < 0.0 || rate >= 1.0) {
+            throw std::invalid_argument("Dropout rate must be in [0, 1)");
+        }
+    }
+
+    LayerKind kind() const override { return LayerKind::DROPOUT; }
+
+    LayerConfig config() const override {
+        LayerConfig c;
+        c.kind = LayerKind::DROPOUT;
+        c.rate = rate;
+        return c;
+    }
+    std::string describe() const override {
+        std::ostringstream os;
+        os << "Dropout(" << rate << ")";
+        return os.str();
+    }
+
+    Shape build(const Shape& input) override {
+        width = input.size();
+        return input;
+    }
+
+    void forward(const T* in, T* out, size_t n, bool training) override {
+        const size_t count = n * width;
+        if (!training || rate == 0.0) {
+            if (out != in) std::copy(in, in + count, out);
+            return;
+        }
+        mask.resize(count);
+        std::bernoulli_distribution keep(1.0 - rate);
+        const T scale = static_cast<T>(1.0 / (1.0 - rate));
+        for (size_t i = 0; i < count; i++) {
+            mask[i] = keep(gen) ? scale : T(0);
+            out[i] = in[i] * mask[i];
+        }
+    }
+
+    void backward(const T*, const T*, const T* grad_out, T* grad_in,
+                  size_t n, T*) override {
+        const size_t count = n * width;
+        if (rate == 0.0) {
+            if (grad_in != grad_out) std::copy(grad_out, grad_out + count, grad_in);
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            grad_in[i] = grad_out[i] * mask[i];
+        }
+    }
+
+    bool in_place() const override { return true; }
+    double get_rate() const { return rate; }
+};
+
+#endif
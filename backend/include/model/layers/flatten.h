@@ -0,0 +1,41 @@
+#ifndef FLATTEN_H
+#define FLATTEN_H
+
+#include <algorithm>
+#include "layer.h"
+
+// Reads a C x H x W sample as a flat row. Samples are already stored as
+// rows, so the data is untouched and execution plans leave the layer out.
+template<typename T = float>
+class Flatten : public Layer<T> {
+private:
+    size_t width = 0;
+
+public:
+    LayerKind kind() const override { return LayerKind::FLATTEN; }
+    std::string describe() const override { return "Flatten"; }
+
+    LayerConfig config() const override {
+        LayerConfig c;
+        c.kind = LayerKind::FLATTEN;
+        return c;
+    }
+
+    Shape build(const Shape& input) override {
+        width = input.size();
+        return Shape::flat(static_cast<int>(width));
+    }
+
+    void forward(const T* in, T* out, size_t n, bool) override {
+        if (out != in) std::copy(in, in + n * width, out);
+    }
+
+    void backward(const T*, const T*, const T* grad_out, T* grad_in,
+                  size_t n, T*) override {
+        if (grad_in != grad_out) std::copy(grad_out, grad_out + n * width, grad_in);
+    }
+
+    bool in_place() const override { return true; }
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef LAYER_H
+#define LAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of one sample as it flows between layers. Samples are stored as
+// rows of size() values, channel-major (C x H x W); fully connected layers
+// produce flat shapes {features, 1, 1}.
+struct Shape {
+    int channels = 0;
+    int height = 1;
+    int width = 1;
+
+    static Shape flat(int features) { return {features, 1, 1}; }
+
+    size_t size() const {
+        return static_cast<size_t>(channels) * height * width;
+    }
+
+    bool operator==(const Shape& other) const {
+        return channels == other.channels && height == other.height && width == other.width;
+    }
+    bool operator!=(const Shape& other) const { return !(*this == other); }
+
+    std::string str() const {
+        if (height == 1 && width == 1) return std::to_string(channels);
+        return std::to_string(channels) + "x" + std::to_string(height) + "x" + std::to_string(width);
+    }
+};
+
+enum class LayerKind {
+    DENSE,
+    ACTIVATION,
+    SOFTMAX,
+    DROPOUT,
+    CONV2D,
+    MAX_POOL2D,
+    AVG_POOL2D,
+    FLATTEN,
+    DEPTHWISE_CONV2D,
+    GLOBAL_AVG_POOL2D
+};
+
+// What a layer needs to be recreated from a model file: its kind, up to
+// four integer settings (units, filters, kernel, stride, ActivationType...)
+// and a rate
+struct LayerConfig {
+    LayerKind kind = LayerKind::DENSE;
+    int32_t args[4] = {0, 0, 0, 0};
+    double rate = 0.0;
+};
+
+// Abstract base of the layers a Sequential network is built from. Every
+// call works on n samples at once, stored as consecutive rows.
+template<typename T = float>
+class Layer {
+public:
+    virtual ~Layer() = default;
+
+    virtual LayerKind kind() const = 0;
+    virtual std::string describe() const = 0;
+    virtual LayerConfig config() const = 0;
+
+    // Fix the input shape, allocating parameters on the first call, and
+    // return the output shape. Throws std::invalid_argument if the layer
+    // cannot take the input.
+    virtual Shape build(const Shape& input) = 0;
+
+    // out = f(in) for n samples. Layers that can run in place accept
+    // out == in.
+    virtual void forward(const T* in, T* out, size_t n, bool training) = 0;
+
+    // grad_in = dL/d(in) from grad_out = dL/d(out), given the in and out of
+    // the forward pass, and add the parameter gradients to param_grads
+    // (laid out like parameters()). In-place layers accept grad_in == grad_out.
+    virtual void backward(const T* in, const T* out, const T* grad_out, T* grad_in,
+                          size_t n, T* param_grads) = 0;
+
+    virtual bool in_place() const { return false; }
+
+    // Scratch bytes forward or backward take from the calling thread's
+    // workspace arena (reserved by the network before the pass)
+    virtual size_t workspace_bytes() const { return 0; }
+
+    // Threads to split the batch (or the GEMMs) across
+    virtual void set_num_threads(int) {}
+
+    // Trainable parameters as one flat block (empty for most layers)
+    virtual size_t parameter_count() const { return 0; }
+    virtual T* parameters() { return nullptr; }
+};
+
+#endif
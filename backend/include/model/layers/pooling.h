@@ -0,0 +1,80 @@
+#ifndef POOLING_H
+#define POOLING_H
+
+#include "layer.h"
+#include "im2col.h"
+
+enum class PoolType {
+    MAX,
+    AVERAGE
+};
+
+// Max or average over square windows of every channel, without padding.
+// The batch is split across threads.
+template<typename T = float>
+class Pool2D : public Layer<T> {
+private:
+    PoolType type;
+    int pool;
+    int stride;
+    ConvGeometry geometry;
+    int num_threads = 1;
+
+public:
+    // stride 0 means stride = pool (non-overlapping windows)
+    Pool2D(PoolType pool_type, int pool_size, int pool_stride = 0);
+
+    LayerKind kind() const override {
+        return type == PoolType::MAX ? LayerKind::MAX_POOL2D : LayerKind::AVG_POOL2D;
+    }
+    std::string describe() const override;
+    LayerConfig config() const override;
+
+    Shape build(const Shape& input) override;
+    void forward(const T* in, T* out, size_t n, bool training) override;
+
+    // Max pooling routes each gradient to the first maximum of its window,
+    // found again from in; average pooling spreads it evenly
+    void backward(const T* in, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T* param_grads) override;
+
+    void set_num_threads(int threads) override;
+};
+
+template<typename T = float>
+class MaxPool2D : public Pool2D<T> {
+public:
+    explicit MaxPool2D(int pool_size, int pool_stride = 0)
+        : Pool2D<T>(PoolType::MAX, pool_size, pool_stride) {}
+};
+
+template<typename T = float>
+class AvgPool2D : public Pool2D<T> {
+public:
+    explicit AvgPool2D(int pool_size, int pool_stride = 0)
+        : Pool2D<T>(PoolType::AVERAGE, pool_size, pool_stride) {}
+};
+
+// Mean of every channel plane (C x H x W -> C), which ends the
+// convolutional part of a network without a dense layer over every pixel.
+// The batch is split across threads.
+template<typename T = float>
+class GlobalAvgPool2D : public Layer<T> {
+private:
+    Shape input_shape;
+    int num_threads = 1;
+
+public:
+    LayerKind kind() const override { return LayerKind::GLOBAL_AVG_POOL2D; }
+    std::string describe() const override { return "GlobalAvgPool2D"; }
+    LayerConfig config() const override;
+
+    Shape build(const Shape& input) override;
+    void forward(const T* in, T* out, size_t n, bool training) override;
+    void backward(const T* in, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T* param_grads) override;
+
+    void set_num_threads(int threads) override;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SOFTMAX_H
+#define SOFTMAX_H
+
+#include <algorithm>
+#include "layer.h"
+#include "fast_math.h"
+#include "simd_kernels.h"
+
+// Softmax over every sample's row. Runs in place. As the last layer of a
+// Sequential network it is trained with cross-entropy, whose gradient the
+// network takes directly (probs - targets) instead of calling backward.
+template<typename T = float>
+class Softmax : public Layer<T> {
+private:
+    size_t width = 0;
+
+public:
+    LayerKind kind() const override { return LayerKind::SOFTMAX; }
+    std::string describe() const override { return "Softmax"; }
+
+    LayerConfig config() const override {
+        LayerConfig c;
+        c.kind = LayerKind::SOFTMAX;
+        return c;
+    }
+
+    Shape build(const Shape& input) override {
+        width = input.size();
+        return input;
+    }
+
+    void forward(const T* in, T* out, size_t n, bool) override {
+        if (out != in) std::copy(in, in + n * width, out);
+        softmax_rows(out, n, width);
+    }
+
+    // grad_in = y * (grad_out - <grad_out, y>) per row
+    void backward(const T*, const T* out, const T* grad_out, T* grad_in,
+                  size_t n, T*) override {
+        for (size_t r = 0; r < n; r++) {
+            const T* y = out + r * width;
+            const T* g = grad_out + r * width;
+            T* d = grad_in + r * width;
+            T dot = simd<T>().dot(g, y, width);
+            for (size_t i = 0; i < width; i++) {
+                d[i] = y[i] * (g[i] - dot);
+            }
+        }
+    }
+
+    bool in_place() const override { return true; }
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "activation_function.h"
+#include "quantization.h"
+
+// Precision of the parameters in a model file (value = bytes per parameter)
+enum class ScalarType : uint32_t {
+    FLOAT32 = 4,
+    FLOAT64 = 8
+};
+
+inline const char* scalar_type_name(ScalarType type) {
+    return type == ScalarType::FLOAT32 ? "float32" : "float64";
+}
+
+// Self-describing model file, laid out so it can be memory-mapped and run
+// in place:
+//
+//   ModelFileHeader                         64 bytes
+//   uint32 layer sizes[num_layers]
+//   float (min, max)[num_ranges]            learned activation ranges
+//   class names                             uint32 length + bytes, each
+//   padding to 64 bytes
+//   one block per layer, 64-byte aligned:   weights (outputs x inputs,
+//                                           row-major), padding to 64
+//                                           bytes, biases (outputs)
+//
+// All values are little-endian host order; the checksum is FNV-1a 64 over
+// the whole file with the checksum field zeroed.
+constexpr uint32_t MODEL_FILE_MAGIC = 0x464E4E43;  // "CNNF"
+constexpr uint32_t MODEL_FILE_VERSION = 1;
+constexpr size_t MODEL_FILE_ALIGNMENT = 64;
+
+struct ModelFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dtype;          // ScalarType
+    uint32_t activation;     // ActivationType of the hidden layers
+    uint32_t num_layers;     // entries in the layer size table
+    uint32_t num_classes;    // entries in the class name table (0 if unnamed)
+    uint32_t input_size;
+    uint32_t num_ranges;     // 0, or one per dense layer
+    double learning_rate;
+    uint64_t tensor_offset;  // byte offset of the first layer block
+    uint64_t file_size;
+    uint64_t checksum;
+};
+static_assert(sizeof(ModelFileHeader) == 64, "model file header must stay 64 bytes");
+
+// Everything in a model file except the parameters
+struct ModelInfo {
+    ScalarType dtype = ScalarType::FLOAT32;
+    ActivationType activation = ActivationType::SIGMOID;
+    std::vector<int> layer_sizes;
+    std::vector<std::string> class_names;
+    std::vector<ActivationRange> activation_ranges;
+    double learning_rate = 0.01;
+
+    size_t input_size() const { return layer_sizes.empty() ? 0 : layer_sizes.front(); }
+};
+
+// Bytes of one layer block: the same layout as DenseLayer::params, with the
+// biases starting on their own cache line
+size_t layer_block_bytes(int inputs, int outputs, ScalarType dtype);
+
+// Write info and one parameter block per dense layer (layer_block_bytes
+// each). The file is written next to filename and renamed over it, so a
+// server still mapping the old file keeps its pages and a reloading one
+// never sees half a file. Returns false if the file could not be written.
+bool write_model_file(const std::string& filename, const ModelInfo& info,
+                      const std::vector<const void*>& layer_blocks);
+
+// FNV-1a 64 of size bytes, continuing from hash (the checksum files store)
+uint64_t fnv1a_checksum(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL);
+
+// Write size bytes to filename + ".tmp" and rename it over filename, so
+// readers see either the old file or the whole new one. Returns false
+// (removing the temporary file) if it could not be written.
+bool write_file_atomically(const std::string& filename, const char* data, size_t size);
+
+// Whether filename starts with MODEL_FILE_MAGIC (older formats do not)
+bool is_model_file(const std::string& filename);
+
+// Read-only memory mapping of a model file. The layer blocks point straight
+// into the mapped pages, which the OS shares between processes mapping the
+// same file.
+class MappedModelFile {
+private:
+    void* base = nullptr;
+    size_t length = 0;
+    ModelInfo model;
+    std::vector<size_t> block_offsets;
+
+    MappedModelFile() = default;
+
+public:
+    ~MappedModelFile();
+    MappedModelFile(const MappedModelFile&) = delete;
+    MappedModelFile& operator=(const MappedModelFile&) = delete;
+
+    // Map and validate filename (magic, version, sizes and alignment).
+    // The checksum covers every byte, so verify_checksum reads the whole
+    // file up front; without it only the metadata pages are touched and the
+    // tensors fault in lazily, shared with other processes. Returns nullptr
+    // with a message on std::cerr if it is not a valid model file.
+    static std::shared_ptr<const MappedModelFile> open(const std::string& filename,
+                                                       bool verify_checksum = false);
+
+    const ModelInfo& info() const { return model; }
+    size_t size_bytes() const { return length; }
+    size_t num_layer_blocks() const { return block_offsets.size(); }
+
+    // Parameters of dense layer i in info().dtype, 64-byte aligned
+    const void* layer_block(size_t i) const {
+        return static_cast<const char*>(base) + block_offsets[i];
+    }
+};
+
+#endif
@@ -4,54 +4,203 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdint>
 #include <random>
 #include <memory>
 #include <thread>
-#include <mutex>
 #include "activation_function.h"
+#include "dense_layer.h"
+#include "model_file.h"
+#include "quantization.h"
+#include "matrix.h"
 
+// Cross-entropy loss and number of correctly classified samples of one
+// training step, taken from the activations the step already computed
+struct StepResult {
+    double loss = 0.0;
+    size_t correct = 0;
+
+    StepResult& operator+=(const StepResult& other) {
+        loss += other.loss;
+        correct += other.correct;
+        return *this;
+    }
+};
+
+// Summary of a training run, used to compare training modes
+struct TrainingStats {
+    size_t samples = 0;              // samples processed over all epochs
+    double seconds = 0.0;            // wall-clock training time
+    double samples_per_second = 0.0;
+    double final_loss = 0.0;         // mean cross-entropy of the last epoch
+    double final_accuracy = 0.0;     // fraction classified correctly in the last epoch
+    size_t workspace_peak_bytes = 0; // largest per-thread scratch arena in use
+};
+
+// Fully connected classifier templated on its scalar type. float is the
+// production default (half the memory traffic and twice the SIMD width of
+// double); NeuralNetwork<double> is kept for reference runs.
+template<typename T = float>
 class NeuralNetwork {
 private:
     std::vector<int> layers;
-    std::vector<std::vector<std::vector<double>>> weights;
-    std::vector<std::vector<double>> biases;
+    // One flat, 64-byte aligned parameter block per layer
+    std::vector<DenseLayer<T>> dense_layers;
     double learning_rate;
+    bool keep_column_major = false;
+
+    // Threads used by the batched GEMMs
+    int num_threads = 1;
+
+    // Gradient accumulators with the same layout as dense_layers
+    std::vector<DenseLayer<T>> gradients;
 
     // Polymorphism - using activation function via base class pointer
-    std::unique_ptr<ActivationFunction> activation;
+    std::unique_ptr<ActivationFunction<T>> activation;
+
+    // Quantization-aware training: the fake-quantized weights the forward
+    // pass runs on, and the learned input range of every layer
+    bool quantization_aware = false;
+    std::vector<DenseLayer<T>> fake_quant_layers;
+    std::vector<ActivationRange> activation_ranges;
+
+    // Class label per output, recorded in the model file
+    std::vector<std::string> class_names;
+
+    // Model file the layers point into when they were memory-mapped
+    std::shared_ptr<const MappedModelFile> mapping;
+
+    // Empty network for from_file
+    NeuralNetwork() : learning_rate(0.01) {}
+
+    // Take architecture, metadata and parameters from a model file, either
+    // viewing the mapped blocks in place or copying (and converting) them
+    void adopt_model_file(std::shared_ptr<const MappedModelFile> file, bool keep_mapping);
+    bool load_legacy(const std::string& filename);
+
+    // Copy mapped parameters into owned memory before the weights change
+    void detach_mapping();
+
+    // Mini-batch building blocks: accumulate the summed gradients of n samples
+    // into grads (returning their summed loss), then apply
+    // params -= lr * scale * grads. With fake_quant_ranges the pass runs on
+    // fake_quant_layers, fake-quantizes every layer input and updates the ranges.
+    std::vector<DenseLayer<T>> make_gradient_buffers() const;
+    StepResult compute_gradients(const T* inputs, const T* targets, size_t n,
+                                 std::vector<DenseLayer<T>>& grads, int gemm_threads,
+                                 std::vector<ActivationRange>* fake_quant_ranges = nullptr) const;
 
-    // Mutex for thread safety in parallel training
-    std::mutex training_mutex;
+    // Round the current weights onto the int8 grid in fake_quant_layers
+    void refresh_fake_quant_layers();
 
-    double sigmoid(double x);
-    double sigmoid_derivative(double x);
-    std::vector<double> softmax(const std::vector<double>& x);
+    // Scratch bytes one forward/backward pass over n rows takes from the
+    // thread's workspace arena
+    size_t workspace_bytes(size_t n, bool fake_quant = false) const;
+
+    // Class probabilities (n x C) for n contiguous input rows written to out,
+    // with intermediate activations in the thread's workspace arena; safe to
+    // call from several threads at once
+    void forward_into(const T* inputs, size_t n, T* out, int gemm_threads) const;
+    Matrix<T> forward_rows(const T* inputs, size_t n, int gemm_threads) const;
+    void apply_gradients(const std::vector<DenseLayer<T>>& grads, T scale);
 
 public:
+    // Precision recorded in saved model files
+    static constexpr ScalarType scalar_type =
+        sizeof(T) == sizeof(float) ? ScalarType::FLOAT32 : ScalarType::FLOAT64;
+
     NeuralNetwork(const std::vector<int>& layer_sizes, double lr = 0.01,
                   ActivationType act_type = ActivationType::SIGMOID);
 
     // Destructor - cleanup resources
     ~NeuralNetwork();
 
-    std::vector<double> forward(const std::vector<double>& input);
-    void train(const std::vector<double>& input, const std::vector<double>& target);
-    void train_batch(const std::vector<std::vector<double>>& inputs,
-                     const std::vector<std::vector<double>>& targets,
-                     int epochs);
+    // Inference only reads the weights and keeps its activations in the
+    // calling thread's workspace arena, so any number of threads may run
+    // forward, forward_batch and predict_class on one network at once
+    // (as long as nothing trains it meanwhile)
+    std::vector<T> forward(const std::vector<T>& input) const;
+
+    // Batched inference: inputs is a contiguous row-major N x D block and the
+    // result is the row-major N x C matrix of class probabilities
+    std::vector<T> forward_batch(const std::vector<T>& inputs, size_t batch_size) const;
+    std::vector<T> forward_batch(const T* inputs, size_t batch_size) const;
+    Matrix<T> forward_batch(const Matrix<T>& inputs) const;
+    // Returns the sample's loss before the update
+    double train(const std::vector<T>& input, const std::vector<T>& target);
+
+    // One SGD update with the mean gradient of a contiguous mini-batch
+    // (inputs: N x D, targets: N x C, both row-major). Returns the summed
+    // loss and correct count of the batch before the update.
+    StepResult train_step(const T* inputs, const T* targets, size_t batch_size);
+
+    // Mini-batch SGD over shuffled samples, one update per batch_size samples.
+    // The update uses the mean gradient, so scale the learning rate with the batch.
+    void train_batch(const std::vector<std::vector<T>>& inputs,
+                     const std::vector<std::vector<T>>& targets,
+                     int epochs, int batch_size = 1);
+
+    // Synchronous data-parallel mini-batch SGD using std::thread: every worker
+    // computes the gradient of its slice of each batch into a private buffer,
+    // the buffers are combined by a parallel tree reduction and one update is
+    // applied per batch
+    TrainingStats train_batch_parallel(const std::vector<std::vector<T>>& inputs,
+                                       const std::vector<std::vector<T>>& targets,
+                                       int epochs, int num_threads = 4, int batch_size = 64);
+
+    // Hogwild-style asynchronous SGD: every worker walks its own shuffled
+    // shard of the samples and applies its updates to the shared weights
+    // without any locking. Concurrent updates may overwrite each other (a
+    // deliberate, benign race), in exchange for never waiting on other workers.
+    TrainingStats train_hogwild(const std::vector<std::vector<T>>& inputs,
+                                const std::vector<std::vector<T>>& targets,
+                                int epochs, int num_threads = 4, int batch_size = 1);
 
-    // Parallel training using std::thread
-    void train_batch_parallel(const std::vector<std::vector<double>>& inputs,
-                             const std::vector<std::vector<double>>& targets,
-                             int epochs, int num_threads = 4);
+    // Simulate int8 weights and activations in the forward passes of train,
+    // train_step and train_batch (straight-through gradients), learning the
+    // activation ranges the INT8 network is quantized with. The parallel
+    // modes always train in full precision.
+    void set_quantization_aware(bool enabled);
+    bool is_quantization_aware() const { return quantization_aware; }
 
+    // Learned input range per layer; empty until a quantization-aware step ran
+    const std::vector<ActivationRange>& get_activation_ranges() const { return activation_ranges; }
+
+    // Save in the self-describing model file format (model_file.h). load
+    // replaces the architecture, activation and parameters with the file's;
+    // older files and other precisions are converted to T. Returns false if
+    // the file could not be read.
     void save(const std::string& filename);
-    void load(const std::string& filename);
+    bool load(const std::string& filename);
+
+    // Network described entirely by a model file, or nullptr if it cannot be
+    // read. With memory_map, a file in this precision is run straight from
+    // the mapped pages (checksum not verified, so startup touches only the
+    // metadata); training copies the weights in first. Without it the file
+    // is loaded and its checksum verified.
+    static std::unique_ptr<NeuralNetwork> from_file(const std::string& filename,
+                                                    bool memory_map = true);
+    bool is_memory_mapped() const { return mapping != nullptr; }
 
-    int predict_class(const std::vector<double>& input);
+    void set_class_names(const std::vector<std::string>& names) { class_names = names; }
+    const std::vector<std::string>& get_class_names() const { return class_names; }
+
+    int predict_class(const std::vector<T>& input) const;
 
     // Get activation type
     ActivationType getActivationType() const;
+
+    // Split batched matrix products across this many threads
+    void set_num_threads(int threads);
+
+    // Keep a column-major copy of every weight matrix in sync (used by backprop)
+    void set_column_major_copy(bool enabled);
+
+    // High-water mark of the calling thread's workspace arena
+    size_t workspace_peak_bytes() const;
+
+    const std::vector<DenseLayer<T>>& get_layers() const { return dense_layers; }
+    const std::vector<int>& get_layer_sizes() const { return layers; }
 };
 
 #endif
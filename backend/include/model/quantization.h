@@ -0,0 +1,95 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "int8_kernels.h"
+
+// Scheme shared by quantization-aware training and the INT8 network, so the
+// rounding simulated in training is exactly the rounding done at inference
+
+// x ~ scale * (q - zero_point) with q in [0, INT8_ACTIVATION_MAX]
+struct QuantParams {
+    float scale = 1.0f;
+    int32_t zero_point = 0;
+};
+
+// Asymmetric 7-bit parameters covering [lo, hi], widened to include zero
+inline QuantParams activation_quant_params(float lo, float hi) {
+    lo = std::min(lo, 0.0f);
+    hi = std::max(hi, 0.0f);
+    QuantParams p;
+    p.scale = (hi - lo) / INT8_ACTIVATION_MAX;
+    if (p.scale <= 0.0f) p.scale = 1.0f;
+    int32_t zero_point = static_cast<int32_t>(std::lround(-lo / p.scale));
+    p.zero_point = std::clamp<int32_t>(zero_point, 0, INT8_ACTIVATION_MAX);
+    return p;
+}
+
+template<typename T>
+inline int32_t quantize_activation(T x, float inv_scale, int32_t zero_point) {
+    int32_t v = static_cast<int32_t>(std::lrint(static_cast<float>(x) * inv_scale)) + zero_point;
+    return std::clamp<int32_t>(v, 0, INT8_ACTIVATION_MAX);
+}
+
+// Symmetric scale of one output channel: max |w| maps to INT8_WEIGHT_MAX
+template<typename T>
+inline float weight_scale(const T* w, size_t n) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < n; i++) max_abs = std::max(max_abs, static_cast<float>(std::fabs(w[i])));
+    return max_abs > 0.0f ? max_abs / INT8_WEIGHT_MAX : 1.0f;
+}
+
+template<typename T>
+inline int8_t quantize_weight(T w, float scale) {
+    int32_t v = static_cast<int32_t>(std::lround(static_cast<float>(w) / scale));
+    return static_cast<int8_t>(std::clamp(v, -INT8_WEIGHT_MAX, INT8_WEIGHT_MAX));
+}
+
+// Fake quantization: round to the int8 grid and straight back, so the
+// forward pass sees the quantization error while gradients pass through
+// unchanged (straight-through estimator)
+template<typename T>
+void fake_quantize_weights(const T* w, size_t n, T* out) {
+    float scale = weight_scale(w, n);
+    for (size_t i = 0; i < n; i++) out[i] = static_cast<T>(quantize_weight(w[i], scale) * scale);
+}
+
+template<typename T>
+void fake_quantize_activations(const T* x, size_t n, const QuantParams& p, T* out) {
+    const float inv_scale = 1.0f / p.scale;
+    for (size_t i = 0; i < n; i++) {
+        int32_t q = quantize_activation(x[i], inv_scale, p.zero_point);
+        out[i] = static_cast<T>((q - p.zero_point) * p.scale);
+    }
+}
+
+// Range of one layer's input learned during quantization-aware training as
+// an exponential moving average of the observed batch minimum and maximum
+struct ActivationRange {
+    float min = 0.0f;
+    float max = 0.0f;
+    bool observed = false;
+
+    template<typename T>
+    void observe(const T* x, size_t n, float momentum = 0.9f) {
+        if (n == 0) return;
+        auto range = std::minmax_element(x, x + n);
+        float lo = static_cast<float>(*range.first);
+        float hi = static_cast<float>(*range.second);
+        if (!observed) {
+            min = lo;
+            max = hi;
+            observed = true;
+        } else {
+            min = momentum * min + (1.0f - momentum) * lo;
+            max = momentum * max + (1.0f - momentum) * hi;
+        }
+    }
+
+    QuantParams params() const { return activation_quant_params(min, max); }
+};
+
+#endif
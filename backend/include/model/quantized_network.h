@@ -0,0 +1,92 @@
+#ifndef QUANTIZED_NETWORK_H
+#define QUANTIZED_NETWORK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "aligned_buffer.h"
+#include "int8_kernels.h"
+#include "neural_network.h"
+
+// One fully connected layer with int8 weights. Weights are symmetric per
+// output channel (w ~ weight_scales[o] * q) and the layer input is
+// asymmetric 7-bit (x ~ input_scale * (q - input_zero_point)).
+struct QuantizedLayer {
+    int inputs = 0;
+    int outputs = 0;
+    AlignedVector<int8_t> weights;     // outputs x inputs, row-major
+    std::vector<float> weight_scales;  // one per output channel
+    std::vector<int32_t> row_sums;     // sum of each weight row, for the zero point
+    std::vector<float> biases;         // kept in float, added after dequantization
+    float input_scale = 1.0f;
+    int32_t input_zero_point = 0;
+};
+
+// Post-training INT8 copy of a trained float network for serving. The
+// products run on the integer kernels (int8_kernels()); activations,
+// biases and softmax stay in float between layers.
+class QuantizedNetwork {
+private:
+    std::vector<QuantizedLayer> layers;
+    // Hidden-layer activation of the float network it was quantized from,
+    // and its kernels, resolved once rather than on every forward pass
+    ActivationType activation = ActivationType::SIGMOID;
+    ActivationKernels<float> hidden = ActivationFactory::create<float>(ActivationType::SIGMOID)->kernels();
+
+    void set_activation(ActivationType type);
+
+    // Scratch bytes forward_into takes from the thread's workspace arena
+    size_t workspace_bytes() const;
+
+public:
+    QuantizedNetwork() = default;
+
+    // Quantize the weights of net and take every layer's input range from
+    // quantization-aware training, or else calibrate it on the activations
+    // the float network produces for the calibration samples
+    static QuantizedNetwork quantize(const NeuralNetwork<float>& net,
+                                     const std::vector<std::vector<float>>& calibration);
+
+    std::vector<float> forward(const std::vector<float>& input) const;
+
+    // Class probabilities (N x C, row-major) for a contiguous N x D block
+    std::vector<float> forward_batch(const float* inputs, size_t batch_size) const;
+    void forward_into(const float* inputs, size_t n, float* out) const;
+
+    int predict_class(const std::vector<float>& input) const;
+
+    // Bytes of int8 weights (the part that has to stay cache resident)
+    size_t weight_bytes() const;
+    size_t input_size() const { return layers.empty() ? 0 : layers.front().inputs; }
+    size_t output_size() const { return layers.empty() ? 0 : layers.back().outputs; }
+    const std::vector<QuantizedLayer>& get_layers() const { return layers; }
+    ActivationType getActivationType() const { return activation; }
+
+    // Written next to filename and renamed over it, like write_model_file;
+    // returns false if the file could not be written
+    bool save(const std::string& filename) const;
+    // Returns false if the file is missing or not a quantized model
+    bool load(const std::string& filename);
+};
+
+// Accuracy and speed of the INT8 network next to the float network it was
+// quantized from, measured on the same labelled samples
+struct QuantizationReport {
+    size_t samples = 0;
+    double fp32_accuracy = 0.0;
+    double int8_accuracy = 0.0;
+    double agreement = 0.0;          // fraction with the same top-1 class
+    double max_prob_error = 0.0;     // largest |p_fp32 - p_int8| of any class
+    size_t fp32_weight_bytes = 0;
+    size_t int8_weight_bytes = 0;
+    double fp32_seconds = 0.0;       // batched inference over all samples
+    double int8_seconds = 0.0;
+};
+
+QuantizationReport compare_quantized(NeuralNetwork<float>& net, const QuantizedNetwork& qnet,
+                                     const std::vector<std::vector<float>>& inputs,
+                                     const std::vector<int>& labels);
+
+void print_quantization_report(const QuantizationReport& report);
+
+#endif
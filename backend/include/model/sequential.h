@@ -0,0 +1,172 @@
+#ifndef SEQUENTIAL_H
+#define SEQUENTIAL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "layer.h"
+#include "dense.h"
+#include "activation.h"
+#include "softmax.h"
+#include "dropout.h"
+#include "conv2d.h"
+#include "depthwise_conv2d.h"
+#include "pooling.h"
+#include "flatten.h"
+#include "aligned_buffer.h"
+#include "neural_network.h"
+
+// Element-wise work a plan step runs on its output rows right after the
+// layer, while they are still in cache
+enum class Epilogue {
+    NONE,
+    ACTIVATION,
+    SOFTMAX
+};
+
+// One step of an execution plan: a layer, possibly fused with the
+// activation or softmax layer that follows it
+template<typename T>
+struct PlanStep {
+    Layer<T>* layer = nullptr;
+    size_t first_layer = 0;   // index of layer in the network
+    Layer<T>* fused = nullptr;  // the activation or softmax layer folded in
+    Epilogue epilogue = Epilogue::NONE;
+    ActivationKernels<T> activation = {nullptr, nullptr};
+    size_t input_width = 0;
+    size_t output_width = 0;
+    bool in_place = false;    // output written over the input buffer
+};
+
+// Steps, buffer use and scratch size of a forward pass, resolved once per
+// architecture and reused by every call
+template<typename T>
+struct ExecutionPlan {
+    std::vector<PlanStep<T>> steps;
+    bool training = false;
+    size_t widest = 0;        // widest input or output of any step
+    size_t layer_scratch = 0; // largest Layer::workspace_bytes of any step
+
+    // Scratch bytes a pass over n samples takes from the thread's workspace
+    // arena: two ping-pong buffers for inference; for training one output
+    // buffer per step (kept for backprop) plus two gradient buffers; and
+    // the layers' own scratch
+    size_t workspace_bytes(size_t n) const;
+};
+
+// Recreates a layer from the config it was saved with
+class LayerFactory {
+public:
+    template<typename T = float>
+    static std::unique_ptr<Layer<T>> create(const LayerConfig& config);
+};
+
+// Model file of a Sequential network: magic, version, ScalarType, input
+// shape, learning rate, then per layer its LayerConfig and parameter block,
+// then the class names. Parameters are stored in the network's own
+// precision and block layout. Since version 2 the file ends with the
+// fnv1a_checksum of everything before it.
+constexpr uint32_t GRAPH_FILE_MAGIC = 0x474E4E43;  // "CNNG"
+constexpr uint32_t GRAPH_FILE_VERSION = 2;
+
+// Whether filename starts with GRAPH_FILE_MAGIC
+bool is_graph_model_file(const std::string& filename);
+
+// Network defined as a list of layers, each with its own type (Dense,
+// Conv2D, pooling, Flatten, Activation, Softmax, Dropout). Shapes are
+// inferred as layers are added; the inference and training plans are
+// rebuilt only when the architecture changes. Plans fuse Dense or Conv2D
+// with a following Activation or Softmax into one step, and leave out
+// Flatten (and Dropout at inference).
+template<typename T = float>
+class Sequential {
+private:
+    Shape input_shape;
+    std::vector<std::unique_ptr<Layer<T>>> layers;
+    std::vector<Shape> output_shapes;
+    double learning_rate;
+    int num_threads = 1;
+
+    // Class label per output, recorded in the model file
+    std::vector<std::string> class_names;
+
+    ExecutionPlan<T> inference_plan;
+    ExecutionPlan<T> training_plan;
+
+    // Parameter gradients, one block per layer (empty if it has none)
+    std::vector<AlignedVector<T>> gradients;
+
+    ExecutionPlan<T> build_plan(bool training) const;
+
+    // Run one plan step over n rows (in may equal out for in-place steps)
+    void run_step(const PlanStep<T>& step, const T* in, T* out, size_t n, bool training) const;
+
+public:
+    // Precision recorded in saved model files
+    static constexpr ScalarType scalar_type = NeuralNetwork<T>::scalar_type;
+
+    explicit Sequential(const Shape& input, double lr = 0.01);
+    explicit Sequential(int input_size, double lr = 0.01)
+        : Sequential(Shape::flat(input_size), lr) {}
+
+    // Append a layer, building it for the current output shape. Throws
+    // std::invalid_argument if the layer cannot take that shape.
+    Sequential& add(std::unique_ptr<Layer<T>> layer);
+
+    // net.add<Dense>(128).add<Activation>(ActivationType::RELU)
+    template<template<typename> class L, typename... Args>
+    Sequential& add(Args&&... args) {
+        return add(std::make_unique<L<T>>(std::forward<Args>(args)...));
+    }
+
+    std::vector<T> forward(const std::vector<T>& input) const;
+
+    // Batched inference over a contiguous row-major N x D block; the result
+    // is the N x C output. forward_into only reads the network and the
+    // thread's workspace arena, so several threads may run it at once.
+    std::vector<T> forward_batch(const T* inputs, size_t batch_size) const;
+    void forward_into(const T* inputs, size_t n, T* out) const;
+
+    int predict_class(const std::vector<T>& input) const;
+
+    // One SGD update with the mean cross-entropy gradient of a contiguous
+    // mini-batch. The network must end in Softmax. Returns the summed loss
+    // and correct count of the batch before the update.
+    StepResult train_step(const T* inputs, const T* targets, size_t batch_size);
+
+    // Mini-batch SGD over shuffled samples, one update per batch_size samples
+    void train_batch(const std::vector<std::vector<T>>& inputs,
+                     const std::vector<std::vector<T>>& targets,
+                     int epochs, int batch_size = 1);
+
+    // Split batches across this many threads (Conv2D and pooling by sample,
+    // Dense inside its GEMMs)
+    void set_num_threads(int threads);
+
+    // Save the architecture, parameters and class names (GRAPH_FILE_MAGIC),
+    // written next to filename and renamed over it; false if it could not
+    // be written. from_file returns nullptr with a message on std::cerr if
+    // the file is missing, corrupt or stored in another precision.
+    bool save(const std::string& filename) const;
+    static std::unique_ptr<Sequential> from_file(const std::string& filename);
+
+    void set_class_names(const std::vector<std::string>& names) { class_names = names; }
+    const std::vector<std::string>& get_class_names() const { return class_names; }
+
+    Shape get_input_shape() const { return input_shape; }
+    size_t input_size() const { return input_shape.size(); }
+    size_t output_size() const;
+    Shape output_shape() const { return output_shapes.empty() ? input_shape : output_shapes.back(); }
+    size_t parameter_count() const;
+
+    const std::vector<std::unique_ptr<Layer<T>>>& get_layers() const { return layers; }
+    const ExecutionPlan<T>& get_plan(bool training = false) const {
+        return training ? training_plan : inference_plan;
+    }
+
+    // Layers with their output shapes, then the inference plan's steps
+    std::string summary() const;
+};
+
+#endif
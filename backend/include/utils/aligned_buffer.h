@@ -0,0 +1,54 @@
+#ifndef ALIGNED_BUFFER_H
+#define ALIGNED_BUFFER_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Cache line size used for all aligned numeric buffers
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Minimal STL allocator returning cache-line aligned memory, so that
+// contiguous weight and activation blocks start on a 64-byte boundary
+template<typename T, size_t Alignment = CACHE_LINE_SIZE>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+// Contiguous, 64-byte aligned vector
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Round a number of elements up so the next block starts on a new cache line
+template<typename T>
+constexpr size_t align_elements(size_t count) {
+    constexpr size_t per_line = CACHE_LINE_SIZE / sizeof(T);
+    return (count + per_line - 1) / per_line * per_line;
+}
+
+#endif
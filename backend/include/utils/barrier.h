@@ -0,0 +1,34 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Reusable thread barrier: every participant blocks in arrive_and_wait()
+// until all of them have arrived, then the barrier resets for the next phase
+class Barrier {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t count;
+    size_t waiting = 0;
+    size_t generation = 0;
+
+public:
+    explicit Barrier(size_t participants) : count(participants) {}
+
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        size_t gen = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&]() { return gen != generation; });
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef DIRECT_CONV_H
+#define DIRECT_CONV_H
+
+#include <algorithm>
+#include <cstddef>
+#include "simd_kernels.h"
+
+// Direct convolution over the channel-blocked NCHWc layout: channels are
+// grouped in blocks of CONV_BLOCK lanes and each pixel of a block stores
+// its lanes contiguously (C/8 x H x W x 8). The kernels keep a few output
+// pixels of one 8-filter block in registers and accumulate broadcast input
+// values times 8-wide filter taps, so nothing is unrolled into a patch
+// matrix the way im2col does.
+//
+// Depthwise convolution (one kernel per channel) has no channel sum to
+// block, so its kernel runs on plain planes and vectorizes along the row.
+
+// Lanes of a channel block: one AVX2 register of floats
+constexpr int CONV_BLOCK = 8;
+
+inline int conv_blocks(int channels) { return (channels + CONV_BLOCK - 1) / CONV_BLOCK; }
+
+// One output row of one 8-filter block
+template<typename T>
+struct DirectConvArgs {
+    const T* input;         // padded NCHWc sample at the row the window starts on
+    size_t channel_stride;  // elements between channel blocks of the input
+    size_t row_stride;      // elements between input rows
+    const T* weights;       // channels x kernel x kernel x 8 taps of the block
+    const T* bias;          // 8 biases the accumulators start from
+    T* output;              // out_width x 8
+    int channels;
+    int kernel;
+    int stride;
+    int out_width;
+};
+
+// Row kernels for one instruction set and scalar type (float or double)
+template<typename T>
+struct DirectConvKernels {
+    SimdLevel level;
+    void (*row)(const DirectConvArgs<T>& args);
+
+    // out[ox] = bias + sum of kernel x kernel taps w over the zero-padded
+    // plane in, whose first row is the window's top row
+    void (*depthwise_row)(const T* in, size_t row_stride, const T* w, T bias, T* out,
+                          int kernel, int stride, int out_width);
+};
+
+// Kernels for a given level, falling back like simd_kernels_for
+template<typename T>
+const DirectConvKernels<T>& direct_conv_kernels_for(SimdLevel level);
+
+// Kernels for the detected level, resolved once on first use
+template<typename T>
+const DirectConvKernels<T>& direct_conv_kernels();
+
+// x (C x H x W) -> NCHWc blocks of (H + 2 padding) x (W + 2 padding) pixels
+// with a zero border. Lanes past the last channel are left as they are.
+template<typename T>
+void to_nchwc(const T* x, int channels, int height, int width, int padding, T* blocked) {
+    const int hp = height + 2 * padding;
+    const int wp = width + 2 * padding;
+    const size_t block_size = static_cast<size_t>(hp) * wp * CONV_BLOCK;
+    std::fill(blocked, blocked + conv_blocks(channels) * block_size, T(0));
+    for (int c = 0; c < channels; c++) {
+        T* block = blocked + (c / CONV_BLOCK) * block_size + c % CONV_BLOCK;
+        const T* plane = x + static_cast<size_t>(c) * height * width;
+        for (int y = 0; y < height; y++) {
+            T* row = block + (static_cast<size_t>(y + padding) * wp + padding) * CONV_BLOCK;
+            const T* src = plane + static_cast<size_t>(y) * width;
+            for (int i = 0; i < width; i++) row[i * CONV_BLOCK] = src[i];
+        }
+    }
+}
+
+// NCHWc blocks of H x W pixels -> y (C x H x W), dropping the unused lanes
+template<typename T>
+void from_nchwc(const T* blocked, int channels, int height, int width, T* y) {
+    const size_t pixels = static_cast<size_t>(height) * width;
+    for (int c = 0; c < channels; c++) {
+        const T* src = blocked + (c / CONV_BLOCK) * pixels * CONV_BLOCK + c % CONV_BLOCK;
+        T* plane = y + c * pixels;
+        for (size_t i = 0; i < pixels; i++) plane[i] = src[i * CONV_BLOCK];
+    }
+}
+
+// Filter matrix rows (filters x C * kernel^2) -> blocks of 8 filters, each
+// C x kernel x kernel x 8, and biases -> blocks of 8; the filters padding
+// the last block are zero
+template<typename T>
+void pack_nchwc_filters(const T* weights, const T* biases, int filters, int channels, int kernel,
+                        T* packed, T* packed_biases) {
+    const size_t taps = static_cast<size_t>(channels) * kernel * kernel;
+    const int blocks = conv_blocks(filters);
+    std::fill(packed, packed + blocks * taps * CONV_BLOCK, T(0));
+    std::fill(packed_biases, packed_biases + blocks * CONV_BLOCK, T(0));
+    for (int f = 0; f < filters; f++) {
+        T* block = packed + (f / CONV_BLOCK) * taps * CONV_BLOCK + f % CONV_BLOCK;
+        const T* row = weights + f * taps;
+        for (size_t t = 0; t < taps; t++) block[t * CONV_BLOCK] = row[t];
+        packed_biases[f] = biases[f];
+    }
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cstddef>
+#include "simd_kernels.h"
+
+// Accuracy tiers of the float transcendental kernels. Max error against the
+// double-precision result rounded to float, measured on 23M inputs spread
+// over |x| <= 86 (softmax: relative error on random rows of 1..67 logits,
+// where the float sum itself costs ~2.5e-6 even with libm exp):
+//
+//            exp                    sigmoid    tanh      softmax (rel)
+//   PRECISE  libm                   libm       libm      2.5e-6
+//   FAST     1 ulp                  3 ulp      1 ulp     2.5e-6
+//   FASTEST  166 ulp (rel 1.4e-5)   167 ulp    60 ulp    1.8e-5
+//
+// PRECISE is libm one element at a time and identical on every SIMD level.
+// FAST and FASTEST reduce x = n*ln2 + r, evaluate a polynomial for e^r
+// (Cephes minimax, degree 7 for FAST; degree 4 Chebyshev fit for FASTEST) and
+// scale by 2^n through the exponent bits; tanh uses an odd polynomial below
+// |x| = 0.625 to avoid cancellation. exp flushes results for x < -86.6 to
+// zero and saturates at e^88, so sigmoid and tanh saturate cleanly to 0, 1
+// and +-1. FASTEST also replaces the divisions by a reciprocal estimate
+// refined with one Newton step.
+enum class MathAccuracy {
+    PRECISE,
+    FAST,
+    FASTEST
+};
+
+// Vectorized float transcendental kernels for one SIMD level and tier
+struct MathKernels {
+    SimdLevel level;
+    MathAccuracy accuracy;
+
+    // y = e^x (y may alias x)
+    void (*exp)(const float* x, float* y, size_t n);
+    // In place
+    void (*sigmoid)(float* x, size_t n);
+    void (*tanh)(float* x, size_t n);
+    // Every row in place: max-subtract and exp with a running sum in one
+    // pass, then one multiply by the reciprocal of the sum
+    void (*softmax)(float* x, size_t rows, size_t cols);
+};
+
+// Process-wide tier: CNN_MATH_ACCURACY (precise, fast, fastest) or FAST
+MathAccuracy default_math_accuracy();
+
+const char* math_accuracy_name(MathAccuracy accuracy);
+
+// Kernels for a level and tier; levels the CPU cannot run fall back to the
+// best supported one below them (SSE4.2 and scalar run portable code)
+const MathKernels& math_kernels_for(SimdLevel level, MathAccuracy accuracy);
+
+// Kernels for the detected level and default tier, resolved once on first use
+const MathKernels& math_kernels();
+
+// Row softmax for either scalar type: float runs math_kernels(), double
+// stays on libm
+void softmax_rows(float* x, size_t rows, size_t cols);
+void softmax_rows(double* x, size_t rows, size_t cols);
+
+#endif
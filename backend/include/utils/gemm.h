@@ -0,0 +1,324 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "aligned_buffer.h"
+#include "simd_kernels.h"
+
+// Whether an operand is used as stored or transposed
+enum class Transpose {
+    NO,
+    YES
+};
+
+namespace gemm_detail {
+
+// Register tile (MR x NR) and cache tiles: an MC x KC block of A is packed
+// to stay in L2, a KC x NR micro-panel of B streams through L1 and a
+// KC x NC panel of B is shared by all MC blocks.
+template<typename T>
+struct Blocking {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 8;
+    static constexpr size_t MC = 64;
+    static constexpr size_t KC = 256;
+    static constexpr size_t NC = 1024;
+};
+
+template<>
+struct Blocking<float> {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 16;
+    static constexpr size_t MC = 128;
+    static constexpr size_t KC = 256;
+    static constexpr size_t NC = 2048;
+};
+
+// Element (r, c) of op(X) for a row-major X with leading dimension ld
+template<typename T>
+inline T element(const T* X, size_t ld, Transpose t, size_t r, size_t c) {
+    return t == Transpose::NO ? X[r * ld + c] : X[c * ld + r];
+}
+
+// Pack an mc x kc block of op(A) into MR-row micro-panels (zero padded)
+template<typename T>
+void pack_a(const T* A, size_t lda, Transpose ta, size_t i0, size_t k0,
+            size_t mc, size_t kc, T* buf) {
+    constexpr size_t MR = Blocking<T>::MR;
+    for (size_t ir = 0; ir < mc; ir += MR) {
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t i = 0; i < MR; i++) {
+                *buf++ = (ir + i < mc) ? element(A, lda, ta, i0 + ir + i, k0 + p) : T();
+            }
+        }
+    }
+}
+
+// Pack a kc x nc block of op(B) into NR-column micro-panels (zero padded)
+template<typename T>
+void pack_b(const T* B, size_t ldb, Transpose tb, size_t k0, size_t j0,
+            size_t kc, size_t nc, T* buf) {
+    constexpr size_t NR = Blocking<T>::NR;
+    for (size_t jr = 0; jr < nc; jr += NR) {
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t j = 0; j < NR; j++) {
+                *buf++ = (jr + j < nc) ? element(B, ldb, tb, k0 + p, j0 + jr + j) : T();
+            }
+        }
+    }
+}
+
+// C[mr x nr] += alpha * (packed A micro-panel) * (packed B micro-panel),
+// accumulated in an MR x NR register tile
+template<typename T>
+void micro_kernel(size_t kc, const T* a, const T* b, T* C, size_t ldc,
+                  size_t mr, size_t nr, T alpha) {
+    constexpr size_t MR = Blocking<T>::MR;
+    constexpr size_t NR = Blocking<T>::NR;
+    T acc[MR][NR] = {};
+
+    for (size_t p = 0; p < kc; p++) {
+        const T* bp = b + p * NR;
+        for (size_t i = 0; i < MR; i++) {
+            T ai = a[p * MR + i];
+            for (size_t j = 0; j < NR; j++) {
+                acc[i][j] += ai * bp[j];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) {
+            C[i * ldc + j] += alpha * acc[i][j];
+        }
+    }
+}
+
+// The float and double paths run on the runtime-dispatched SIMD kernels
+template<typename T>
+using MicroKernel = void (*)(size_t, const T*, const T*, T*, size_t, size_t, size_t, T);
+
+template<typename T>
+MicroKernel<T> select_micro_kernel() {
+    return &micro_kernel<T>;
+}
+
+template<>
+inline MicroKernel<double> select_micro_kernel<double>() {
+    static_assert(Blocking<double>::MR == 4 && Blocking<double>::NR == 8,
+                  "SIMD double micro-kernels are 4 x 8");
+    return simd<double>().gemm_micro;
+}
+
+template<>
+inline MicroKernel<float> select_micro_kernel<float>() {
+    static_assert(Blocking<float>::MR == 4 && Blocking<float>::NR == 16,
+                  "SIMD float micro-kernels are 4 x 16");
+    return simd<float>().gemm_micro;
+}
+
+template<typename T>
+T dot(const T* a, const T* b, size_t n) {
+    T sum = T();
+    for (size_t i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+inline double dot(const double* a, const double* b, size_t n) {
+    return simd<double>().dot(a, b, n);
+}
+
+inline float dot(const float* a, const float* b, size_t n) {
+    return simd<float>().dot(a, b, n);
+}
+
+template<typename T>
+void axpy(T alpha, const T* x, T* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+inline void axpy(double alpha, const double* x, double* y, size_t n) {
+    simd<double>().axpy(alpha, x, y, n);
+}
+
+inline void axpy(float alpha, const float* x, float* y, size_t n) {
+    simd<float>().axpy(alpha, x, y, n);
+}
+
+// y (rows) += alpha * W (rows x cols, leading dimension ldw) * x
+template<typename T>
+void gemv(const T* W, size_t ldw, const T* x, T alpha, T* y, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] += alpha * dot(W + r * ldw, x, cols);
+}
+
+inline void gemv(const double* W, size_t ldw, const double* x, double alpha, double* y,
+                 size_t rows, size_t cols) {
+    if (alpha == 1.0 && ldw == cols) {
+        simd<double>().gemv(W, x, y, rows, cols);
+        return;
+    }
+    for (size_t r = 0; r < rows; r++) y[r] += alpha * dot(W + r * ldw, x, cols);
+}
+
+inline void gemv(const float* W, size_t ldw, const float* x, float alpha, float* y,
+                 size_t rows, size_t cols) {
+    if (alpha == 1.0f && ldw == cols) {
+        simd<float>().gemv(W, x, y, rows, cols);
+        return;
+    }
+    for (size_t r = 0; r < rows; r++) y[r] += alpha * dot(W + r * ldw, x, cols);
+}
+
+// C = beta * C before the accumulating kernels run
+template<typename T>
+void scale_c(size_t m, size_t n, T beta, T* C, size_t ldc) {
+    if (beta == T(1)) return;
+    for (size_t i = 0; i < m; i++) {
+        T* c = C + i * ldc;
+        if (beta == T()) {
+            std::fill(c, c + n, T());
+        } else {
+            for (size_t j = 0; j < n; j++) c[j] *= beta;
+        }
+    }
+}
+
+// Contiguous copy of a strided vector (or the vector itself when contiguous)
+template<typename T>
+const T* contiguous(const T* x, size_t stride, size_t n, AlignedVector<T>& scratch) {
+    if (stride == 1) return x;
+    scratch.resize(n);
+    for (size_t i = 0; i < n; i++) scratch[i] = x[i * stride];
+    return scratch.data();
+}
+
+// Matrix-vector shapes skip packing entirely and stream the large operand
+template<typename T>
+bool gemv_fast_path(Transpose ta, Transpose tb, size_t m, size_t n, size_t k, T alpha,
+                    const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc) {
+    thread_local AlignedVector<T> scratch;
+
+    if (m == 1) {
+        const T* a = contiguous(A, ta == Transpose::NO ? 1 : lda, k, scratch);
+        if (tb == Transpose::YES) {
+            // c[j] += alpha * dot(a, B row j)
+            gemv(B, ldb, a, alpha, C, n, k);
+        } else {
+            // c += alpha * a[p] * B row p
+            for (size_t p = 0; p < k; p++) {
+                axpy(alpha * a[p], B + p * ldb, C, n);
+            }
+        }
+        return true;
+    }
+    if (k == 1) {
+        // Rank-1 update: C row i += alpha * a[i] * b
+        const T* b = contiguous(B, tb == Transpose::NO ? 1 : ldb, n, scratch);
+        for (size_t i = 0; i < m; i++) {
+            T ai = alpha * element(A, lda, ta, i, 0);
+            axpy(ai, b, C + i * ldc, n);
+        }
+        return true;
+    }
+    return false;
+}
+
+template<typename T>
+void gemm_serial(Transpose ta, Transpose tb, size_t m, size_t n, size_t k, T alpha,
+                 const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc) {
+    using Blk = Blocking<T>;
+
+    if (gemv_fast_path(ta, tb, m, n, k, alpha, A, lda, B, ldb, C, ldc)) return;
+
+    const MicroKernel<T> kernel = select_micro_kernel<T>();
+
+    // Packing buffers are reused across calls on the same thread
+    thread_local AlignedVector<T> a_buf;
+    thread_local AlignedVector<T> b_buf;
+    a_buf.resize(Blk::MC * Blk::KC);
+    b_buf.resize(Blk::KC * (Blk::NC + Blk::NR));
+
+    for (size_t jc = 0; jc < n; jc += Blk::NC) {
+        size_t nc = std::min(Blk::NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += Blk::KC) {
+            size_t kc = std::min(Blk::KC, k - pc);
+            pack_b(B, ldb, tb, pc, jc, kc, nc, b_buf.data());
+
+            for (size_t ic = 0; ic < m; ic += Blk::MC) {
+                size_t mc = std::min(Blk::MC, m - ic);
+                pack_a(A, lda, ta, ic, pc, mc, kc, a_buf.data());
+
+                for (size_t jr = 0; jr < nc; jr += Blk::NR) {
+                    size_t nr = std::min(Blk::NR, nc - jr);
+                    const T* bp = b_buf.data() + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += Blk::MR) {
+                        size_t mr = std::min(Blk::MR, mc - ir);
+                        kernel(kc, a_buf.data() + ir * kc, bp,
+                               C + (ic + ir) * ldc + jc + jr, ldc, mr, nr, alpha);
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace gemm_detail
+
+// General matrix multiply on row-major storage:
+//   C (m x n) = alpha * op(A) (m x k) * op(B) (k x n) + beta * C
+// With num_threads > 1 the larger of the M/N dimensions is split into
+// independent column or row blocks of C, one per std::thread.
+template<typename T>
+void gemm(Transpose ta, Transpose tb, size_t m, size_t n, size_t k, T alpha,
+          const T* A, size_t lda, const T* B, size_t ldb, T beta, T* C, size_t ldc,
+          int num_threads = 1) {
+    using Blk = gemm_detail::Blocking<T>;
+
+    if (m == 0 || n == 0) return;
+    gemm_detail::scale_c(m, n, beta, C, ldc);
+    if (k == 0 || alpha == T()) return;
+
+    // Small problems are not worth a thread start
+    const size_t min_work_per_thread = 1 << 18;
+    size_t max_threads = std::max<size_t>(1, (m * n * k) / min_work_per_thread);
+    size_t threads = std::min<size_t>(num_threads > 1 ? num_threads : 1, max_threads);
+
+    bool split_rows = (m >= n);
+    size_t extent = split_rows ? m : n;
+    size_t unit = split_rows ? Blk::MR : Blk::NR;
+    threads = std::min(threads, (extent + unit - 1) / unit);
+
+    if (threads <= 1) {
+        gemm_detail::gemm_serial(ta, tb, m, n, k, alpha, A, lda, B, ldb, C, ldc);
+        return;
+    }
+
+    size_t units = (extent + unit - 1) / unit;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        size_t begin = std::min(extent, units * t / threads * unit);
+        size_t end = std::min(extent, units * (t + 1) / threads * unit);
+        if (begin >= end) continue;
+
+        workers.emplace_back([=]() {
+            size_t len = end - begin;
+            if (split_rows) {
+                const T* a = (ta == Transpose::NO) ? A + begin * lda : A + begin;
+                gemm_detail::gemm_serial(ta, tb, len, n, k, alpha, a, lda, B, ldb,
+                                         C + begin * ldc, ldc);
+            } else {
+                const T* b = (tb == Transpose::NO) ? B + begin : B + begin * ldb;
+                gemm_detail::gemm_serial(ta, tb, m, len, k, alpha, A, lda, b, ldb,
+                                         C + begin, ldc);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif
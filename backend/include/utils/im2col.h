@@ -0,0 +1,101 @@
+#ifndef IM2COL_H
+#define IM2COL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// Geometry of a square sliding window (convolution or pooling) over one
+// C x H x W sample stored channel-major
+struct ConvGeometry {
+    int channels = 0;
+    int height = 0;
+    int width = 0;
+    int kernel = 1;
+    int stride = 1;
+    int padding = 0;
+
+    int out_height() const { return (height + 2 * padding - kernel) / stride + 1; }
+    int out_width() const { return (width + 2 * padding - kernel) / stride + 1; }
+
+    // The unrolled patch matrix is col_rows() x col_cols(): one row per
+    // (channel, ky, kx) tap, one column per output position
+    size_t col_rows() const { return static_cast<size_t>(channels) * kernel * kernel; }
+    size_t col_cols() const { return static_cast<size_t>(out_height()) * out_width(); }
+
+    // A 1x1, stride 1, unpadded window reads the sample as its own patch matrix
+    bool is_pointwise() const { return kernel == 1 && stride == 1 && padding == 0; }
+};
+
+namespace im2col_detail {
+
+// Output columns [begin, end) whose input column ox * stride - padding + kx
+// lies inside the row
+inline void valid_range(const ConvGeometry& g, int kx, int& begin, int& end) {
+    int offset = kx - g.padding;
+    begin = offset >= 0 ? 0 : (-offset + g.stride - 1) / g.stride;
+    end = g.width - offset <= 0 ? 0 : (g.width - offset - 1) / g.stride + 1;
+    end = std::min(end, g.out_width());
+    begin = std::min(begin, end);
+}
+
+} // namespace im2col_detail
+
+// Unroll one sample into its patch matrix (zeros where the window hangs
+// over the padding), so the convolution becomes one GEMM with the filters
+template<typename T>
+void im2col(const T* x, const ConvGeometry& g, T* col) {
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    for (int c = 0; c < g.channels; c++) {
+        const T* plane = x + static_cast<size_t>(c) * g.height * g.width;
+        for (int ky = 0; ky < g.kernel; ky++) {
+            for (int kx = 0; kx < g.kernel; kx++) {
+                int begin, end;
+                im2col_detail::valid_range(g, kx, begin, end);
+                for (int oy = 0; oy < oh; oy++, col += ow) {
+                    int iy = oy * g.stride - g.padding + ky;
+                    if (iy < 0 || iy >= g.height) {
+                        std::fill(col, col + ow, T(0));
+                        continue;
+                    }
+                    const T* row = plane + static_cast<size_t>(iy) * g.width;
+                    const int offset = kx - g.padding;
+                    std::fill(col, col + begin, T(0));
+                    if (g.stride == 1) {
+                        std::memcpy(col + begin, row + begin + offset, (end - begin) * sizeof(T));
+                    } else {
+                        for (int ox = begin; ox < end; ox++) col[ox] = row[ox * g.stride + offset];
+                    }
+                    std::fill(col + end, col + ow, T(0));
+                }
+            }
+        }
+    }
+}
+
+// Scatter-add a patch matrix back onto a sample (the adjoint of im2col).
+// x is accumulated into, so clear it first.
+template<typename T>
+void col2im(const T* col, const ConvGeometry& g, T* x) {
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    for (int c = 0; c < g.channels; c++) {
+        T* plane = x + static_cast<size_t>(c) * g.height * g.width;
+        for (int ky = 0; ky < g.kernel; ky++) {
+            for (int kx = 0; kx < g.kernel; kx++) {
+                int begin, end;
+                im2col_detail::valid_range(g, kx, begin, end);
+                for (int oy = 0; oy < oh; oy++, col += ow) {
+                    int iy = oy * g.stride - g.padding + ky;
+                    if (iy < 0 || iy >= g.height) continue;
+                    T* row = plane + static_cast<size_t>(iy) * g.width;
+                    const int offset = kx - g.padding;
+                    for (int ox = begin; ox < end; ox++) row[ox * g.stride + offset] += col[ox];
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef INT8_KERNELS_H
+#define INT8_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "simd_kernels.h"
+
+// Largest quantized activation. Activations use 7 bits so that AVX2's
+// saturating maddubs (u8 * s8 pairs summed into int16) can never overflow:
+// 2 * 127 * 127 < 32767. Weights use the symmetric int8 range [-127, 127].
+constexpr int32_t INT8_ACTIVATION_MAX = 127;
+constexpr int32_t INT8_WEIGHT_MAX = 127;
+
+// Integer kernels for quantized inference: unsigned 8-bit activations times
+// signed 8-bit weights, accumulated in int32. Every variant returns exactly
+// the same sums.
+struct Int8Kernels {
+    const char* name;
+
+    // sum(a[i] * b[i])
+    int32_t (*dot)(const uint8_t* a, const int8_t* b, size_t n);
+    // y (rows) = W (rows x cols, row stride ldw) * x (cols)
+    void (*gemv)(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+                 size_t rows, size_t cols);
+};
+
+// Best integer kernels at or below the given level: AVX-512 VNNI, AVX-VNNI or
+// AVX2 maddubs, SSE4.2 maddubs, then scalar. allow_vnni = false selects the
+// maddubs variants even on VNNI hardware (used to compare the paths).
+const Int8Kernels& int8_kernels_for(SimdLevel level, bool allow_vnni = true);
+
+// Kernels for the detected level, resolved once on first use
+const Int8Kernels& int8_kernels();
+
+#endif
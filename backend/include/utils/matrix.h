@@ -4,38 +4,62 @@
 #include <vector>
 #include <stdexcept>
 #include <iostream>
+#include "aligned_buffer.h"
+#include "gemm.h"
 
-// Generic template class for Matrix operations
+// Generic template class for Matrix operations.
+// Storage is one contiguous, 64-byte aligned row-major block.
 template<typename T>
 class Matrix {
 private:
-    std::vector<std::vector<T>> data;
+    AlignedVector<T> values;
     size_t rows;
     size_t cols;
 
 public:
-    // Constructor
-    Matrix(size_t r, size_t c, T init_val = T()) : rows(r), cols(c) {
-        data.resize(rows, std::vector<T>(cols, init_val));
-    }
+    // Constructors
+    Matrix() : rows(0), cols(0) {}
+
+    Matrix(size_t r, size_t c, T init_val = T()) : values(r * c, init_val), rows(r), cols(c) {}
 
     // Get dimensions
     size_t getRows() const { return rows; }
     size_t getCols() const { return cols; }
+    size_t size() const { return values.size(); }
+
+    // Raw row-major storage
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+
+    // Reshape, reusing the existing allocation where possible
+    void resize(size_t r, size_t c) {
+        rows = r;
+        cols = c;
+        values.resize(r * c);
+    }
+
+    // Access operators - unchecked row pointer, so mat[i][j] stays cheap
+    T* operator[](size_t row) {
+        return values.data() + row * cols;
+    }
 
-    // Access operators
-    std::vector<T>& operator[](size_t row) {
-        if (row >= rows) {
-            throw std::out_of_range("Row index out of range");
+    const T* operator[](size_t row) const {
+        return values.data() + row * cols;
+    }
+
+    // Bounds-checked element access
+    T& at(size_t row, size_t col) {
+        if (row >= rows || col >= cols) {
+            throw std::out_of_range("Matrix index out of range");
         }
-        return data[row];
+        return values[row * cols + col];
     }
 
-    const std::vector<T>& operator[](size_t row) const {
-        if (row >= rows) {
-            throw std::out_of_range("Row index out of range");
+    const T& at(size_t row, size_t col) const {
+        if (row >= rows || col >= cols) {
+            throw std::out_of_range("Matrix index out of range");
         }
-        return data[row];
+        return values[row * cols + col];
     }
 
     // Operator overloading: Matrix addition
@@ -45,10 +69,8 @@ public:
         }
 
         Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; i++) {
-            for (size_t j = 0; j < cols; j++) {
-                result[i][j] = data[i][j] + other[i][j];
-            }
+        for (size_t i = 0; i < values.size(); i++) {
+            result.values[i] = values[i] + other.values[i];
         }
         return result;
     }
@@ -60,10 +82,8 @@ public:
         }
 
         Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; i++) {
-            for (size_t j = 0; j < cols; j++) {
-                result[i][j] = data[i][j] - other[i][j];
-            }
+        for (size_t i = 0; i < values.size(); i++) {
+            result.values[i] = values[i] - other.values[i];
         }
         return result;
     }
@@ -71,11 +91,27 @@ public:
     // Operator overloading: Scalar multiplication
     Matrix<T> operator*(T scalar) const {
         Matrix<T> result(rows, cols);
-        for (size_t i = 0; i < rows; i++) {
-            for (size_t j = 0; j < cols; j++) {
-                result[i][j] = data[i][j] * scalar;
-            }
+        for (size_t i = 0; i < values.size(); i++) {
+            result.values[i] = values[i] * scalar;
+        }
+        return result;
+    }
+
+    // Operator overloading: Matrix multiplication (blocked GEMM)
+    Matrix<T> operator*(const Matrix<T>& other) const {
+        return multiply(other);
+    }
+
+    // Matrix multiplication, optionally split across threads
+    Matrix<T> multiply(const Matrix<T>& other, int num_threads = 1) const {
+        if (cols != other.rows) {
+            throw std::invalid_argument("Matrix dimensions must agree for multiplication");
         }
+
+        Matrix<T> result(rows, other.cols);
+        gemm(Transpose::NO, Transpose::NO, rows, other.cols, cols, T(1),
+             data(), cols, other.data(), other.cols, T(), result.data(), other.cols,
+             num_threads);
         return result;
     }
 
@@ -83,7 +119,7 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const Matrix<T>& mat) {
         for (size_t i = 0; i < mat.rows; i++) {
             for (size_t j = 0; j < mat.cols; j++) {
-                os << mat.data[i][j] << " ";
+                os << mat[i][j] << " ";
             }
             os << "\n";
         }
@@ -95,7 +131,7 @@ public:
         Matrix<T> result(cols, rows);
         for (size_t i = 0; i < rows; i++) {
             for (size_t j = 0; j < cols; j++) {
-                result[j][i] = data[i][j];
+                result[j][i] = (*this)[i][j];
             }
         }
         return result;
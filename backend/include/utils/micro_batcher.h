@@ -0,0 +1,203 @@
+#ifndef MICRO_BATCHER_H
+#define MICRO_BATCHER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Collects single-sample inference requests into batches. A request waits
+// until max_batch requests are queued or the oldest one has waited
+// max_wait, then a worker runs the whole batch through one batched forward
+// pass (one GEMM per layer instead of one GEMV per request) and hands every
+// caller its own row of the output. Several workers let the next batch
+// form while the previous one is still computing.
+class MicroBatcher {
+public:
+    // Runs n contiguous input rows and writes n contiguous output rows;
+    // called from several workers at once, so it must be thread-safe
+    using BatchFn = std::function<void(const float* inputs, size_t n, float* outputs)>;
+    using Clock = std::chrono::steady_clock;
+    // Receives a request's output row, or the error its batch threw (with
+    // an empty row); called on a worker thread, so it should return quickly
+    using Callback = std::function<void(std::vector<float> output, std::exception_ptr error)>;
+
+    struct Options {
+        size_t max_batch = 32;
+        std::chrono::microseconds max_wait{2000};
+        int workers = 1;
+        // Run once on every worker before the constructor returns, e.g. a
+        // dummy batch that sizes the thread's workspace arena. If it throws
+        // on any worker, the constructor stops them all and rethrows.
+        std::function<void()> warmup;
+    };
+
+private:
+    struct Request {
+        std::vector<float> input;
+        Callback done;
+        Clock::time_point arrival;
+    };
+
+    const size_t input_size;
+    const size_t output_size;
+    const BatchFn run;
+    const Options options;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Request> queue;
+    bool stopping = false;
+    int warmed_up = 0;
+    std::exception_ptr warmup_error;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> batch_count{0};
+    std::atomic<size_t> request_count{0};
+
+    void worker_loop() {
+        std::exception_ptr failed;
+        if (options.warmup) {
+            try {
+                options.warmup();
+            } catch (...) {
+                failed = std::current_exception();
+            }
+        }
+
+        std::vector<Request> batch;
+        std::vector<float> inputs, outputs;
+        std::unique_lock<std::mutex> lock(mutex);
+        if (failed && !warmup_error) warmup_error = failed;
+        warmed_up++;
+        cv.notify_all();
+        for (;;) {
+            cv.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+
+            // Hold the batch open until it fills or its oldest request is due,
+            // checking again after every wake-up since another worker may have
+            // taken the queue; on shutdown whatever is queued runs at once
+            const Clock::time_point deadline = queue.front().arrival + options.max_wait;
+            if (!stopping && queue.size() < options.max_batch && Clock::now() < deadline) {
+                cv.wait_until(lock, deadline);
+                continue;
+            }
+
+            const size_t n = std::min(queue.size(), options.max_batch);
+            batch.clear();
+            for (size_t i = 0; i < n; i++) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            // Requests left over may already be due
+            if (!queue.empty()) cv.notify_one();
+            lock.unlock();
+
+            inputs.resize(n * input_size);
+            outputs.resize(n * output_size);
+            for (size_t i = 0; i < n; i++) {
+                std::copy(batch[i].input.begin(), batch[i].input.end(), inputs.begin() + i * input_size);
+            }
+            // Counted before any caller wakes up
+            batch_count++;
+            request_count += n;
+            std::exception_ptr error;
+            try {
+                run(inputs.data(), n, outputs.data());
+            } catch (...) {
+                error = std::current_exception();
+            }
+            for (size_t i = 0; i < n; i++) {
+                const float* row = outputs.data() + i * output_size;
+                batch[i].done(error ? std::vector<float>() : std::vector<float>(row, row + output_size), error);
+            }
+
+            lock.lock();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+public:
+    MicroBatcher(size_t input_size, size_t output_size, BatchFn run, Options options)
+        : input_size(input_size), output_size(output_size), run(std::move(run)), options(options) {
+        if (this->options.max_batch == 0 || this->options.workers <= 0) {
+            throw std::invalid_argument("MicroBatcher needs a positive batch size and worker count");
+        }
+        for (int w = 0; w < this->options.workers; w++) {
+            workers.emplace_back([this]() { worker_loop(); });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return warmed_up == this->options.workers; });
+        if (warmup_error) {
+            lock.unlock();
+            stop();
+            std::rethrow_exception(warmup_error);
+        }
+    }
+
+    // Runs the requests still queued, then joins the workers
+    ~MicroBatcher() { stop(); }
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    // Queue one input row; done is called with its output row once its
+    // batch has run
+    void submit(std::vector<float> input, Callback done) {
+        if (input.size() != input_size) {
+            throw std::invalid_argument("MicroBatcher input does not match the model input size");
+        }
+        Request request;
+        request.input = std::move(input);
+        request.done = std::move(done);
+        request.arrival = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) throw std::logic_error("MicroBatcher is shutting down");
+            queue.push_back(std::move(request));
+        }
+        cv.notify_one();
+    }
+
+    // Blocking form: the future yields the output row, or rethrows what the
+    // batch function threw
+    std::future<std::vector<float>> submit(std::vector<float> input) {
+        auto result = std::make_shared<std::promise<std::vector<float>>>();
+        std::future<std::vector<float>> future = result->get_future();
+        submit(std::move(input), [result](std::vector<float> output, std::exception_ptr error) {
+            if (error) {
+                result->set_exception(error);
+            } else {
+                result->set_value(std::move(output));
+            }
+        });
+        return future;
+    }
+
+    size_t batches() const { return batch_count; }
+    size_t requests() const { return request_count; }
+    const Options& get_options() const { return options; }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "rcu_ptr.h"
+
+// Named models loaded on first use and kept resident within a memory
+// budget, evicting the least recently used ones to make room.
+//
+// The resident table is an immutable snapshot published through RcuPtr,
+// so a lookup of a resident model takes no lock: it loads the snapshot,
+// finds the name and stamps the entry's last use. Loads, replacements and
+// evictions (rare) copy the table under a mutex and store the copy. An
+// evicted model stays alive as long as a request still holds it.
+template<typename T>
+class ModelRegistry {
+public:
+    // nullptr if name cannot be loaded
+    using Loader = std::function<std::shared_ptr<T>(const std::string& name)>;
+    // Bytes a loaded model counts against the budget
+    using Sizer = std::function<size_t(const T& value)>;
+
+private:
+    struct Entry {
+        std::shared_ptr<T> value;
+        size_t bytes = 0;
+        // Shared by every snapshot holding the entry, so a lookup in an old
+        // snapshot still counts
+        std::shared_ptr<std::atomic<uint64_t>> last_used;
+    };
+    using Table = std::unordered_map<std::string, Entry>;
+
+    const Loader loader;
+    const Sizer sizer;
+    const size_t budget_bytes;
+
+    RcuPtr<const Table> table;
+    std::mutex writer;  // serializes loads, replacements and evictions
+    std::atomic<uint64_t> clock{0};
+    std::atomic<size_t> load_count{0};
+    std::atomic<size_t> eviction_count{0};
+
+    static size_t total_bytes(const Table& t) {
+        size_t bytes = 0;
+        for (const auto& entry : t) bytes += entry.second.bytes;
+        return bytes;
+    }
+
+    // Drop least recently used entries other than keep until t fits. A
+    // model larger than the whole budget still stays, alone.
+    void evict_over_budget(Table& t, const std::string& keep) {
+        size_t bytes = total_bytes(t);
+        while (bytes > budget_bytes) {
+            auto victim = t.end();
+            for (auto it = t.begin(); it != t.end(); ++it) {
+                if (it->first == keep) continue;
+                if (victim == t.end() || it->second.last_used->load() < victim->second.last_used->load()) {
+                    victim = it;
+                }
+            }
+            if (victim == t.end()) break;
+            bytes -= victim->second.bytes;
+            t.erase(victim);
+            eviction_count++;
+        }
+    }
+
+    void insert_locked(const std::string& name, std::shared_ptr<T> value) {
+        auto next = std::make_shared<Table>(*table.load());
+        Entry entry;
+        entry.bytes = sizer(*value);
+        entry.value = std::move(value);
+        entry.last_used = std::make_shared<std::atomic<uint64_t>>(++clock);
+        (*next)[name] = std::move(entry);
+        evict_over_budget(*next, name);
+        table.store(std::move(next));
+    }
+
+public:
+    ModelRegistry(Loader loader, Sizer sizer, size_t budget_bytes)
+        : loader(std::move(loader)), sizer(std::move(sizer)), budget_bytes(budget_bytes),
+          table(std::make_shared<const Table>()) {}
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    // The resident model, or nullptr; does not load or count as a use
+    std::shared_ptr<T> find(const std::string& name) const {
+        std::shared_ptr<const Table> snapshot = table.load();
+        auto it = snapshot->find(name);
+        return it == snapshot->end() ? nullptr : it->second.value;
+    }
+
+    // The named model, loading it first if it is not resident (other
+    // misses wait meanwhile; hits do not). nullptr if it cannot be loaded.
+    std::shared_ptr<T> get(const std::string& name) {
+        {
+            std::shared_ptr<const Table> snapshot = table.load();
+            auto it = snapshot->find(name);
+            if (it != snapshot->end()) {
+                it->second.last_used->store(++clock);
+                return it->second.value;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(writer);
+        // Another request may have loaded it while this one waited
+        if (std::shared_ptr<T> loaded = find(name)) return loaded;
+        std::shared_ptr<T> value = loader(name);
+        if (value == nullptr) return nullptr;
+        load_count++;
+        insert_locked(name, value);
+        return value;
+    }
+
+    // Swap in a new value for name (e.g. a reloaded model), which counts as
+    // a use; requests holding the old one finish on it
+    void replace(const std::string& name, std::shared_ptr<T> value) {
+        std::lock_guard<std::mutex> lock(writer);
+        insert_locked(name, std::move(value));
+    }
+
+    // replace() only while name still maps to expected, checked and swapped
+    // under the same lock, so a model evicted meanwhile is not brought back
+    bool replace_if(const std::string& name, const std::shared_ptr<T>& expected, std::shared_ptr<T> value) {
+        std::lock_guard<std::mutex> lock(writer);
+        if (find(name) != expected) return false;
+        insert_locked(name, std::move(value));
+        return true;
+    }
+
+    bool evict(const std::string& name) {
+        std::lock_guard<std::mutex> lock(writer);
+        auto next = std::make_shared<Table>(*table.load());
+        if (next->erase(name) == 0) return false;
+        table.store(std::move(next));
+        eviction_count++;
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writer);
+        table.store(std::make_shared<const Table>());
+    }
+
+    // Resident models, most recently used first
+    std::vector<std::pair<std::string, std::shared_ptr<T>>> resident() const {
+        std::shared_ptr<const Table> snapshot = table.load();
+        std::vector<std::pair<uint64_t, const typename Table::value_type*>> order;
+        for (const auto& entry : *snapshot) order.push_back({entry.second.last_used->load(), &entry});
+        std::sort(order.begin(), order.end(),
+                  [](const auto& a, const auto& b) { return a.first > b.first; });
+        std::vector<std::pair<std::string, std::shared_ptr<T>>> models;
+        for (const auto& item : order) models.push_back({item.second->first, item.second->second.value});
+        return models;
+    }
+
+    size_t resident_bytes() const { return total_bytes(*table.load()); }
+    size_t budget() const { return budget_bytes; }
+    size_t loads() const { return load_count; }
+    size_t evictions() const { return eviction_count; }
+};
+
+#endif
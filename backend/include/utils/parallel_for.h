@@ -0,0 +1,37 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Threads parallel_for(count, num_threads, ...) runs on
+inline size_t parallel_threads(size_t count, int num_threads) {
+    return std::min<size_t>(static_cast<size_t>(std::max(1, num_threads)), count);
+}
+
+// Split [0, count) into contiguous ranges, one per thread, and run
+// body(begin, end, thread_index) on each. The calling thread takes range 0,
+// so with num_threads <= 1 nothing is started.
+template<typename F>
+void parallel_for(size_t count, int num_threads, F&& body) {
+    size_t threads = parallel_threads(count, num_threads);
+    if (threads <= 1) {
+        if (count > 0) body(size_t(0), count, size_t(0));
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back([&body, count, threads, t]() {
+            body(count * t / threads, count * (t + 1) / threads, t);
+        });
+    }
+    body(size_t(0), count / threads, size_t(0));
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef RCU_PTR_H
+#define RCU_PTR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// A shared_ptr that many readers load while a rare writer replaces it,
+// in the style of read-copy-update. load() takes no lock: a reader
+// announces itself in the counter of the current epoch, copies the
+// pointer (one atomic reference increment) and leaves. store() swaps in
+// the new pointer, advances the epoch and waits for the readers of the
+// old epoch before dropping its reference. The object itself lives on
+// in every copy a reader took, so work in flight finishes on the value
+// it started with.
+template<typename T>
+class RcuPtr {
+private:
+    std::atomic<std::shared_ptr<T>*> current;
+    std::atomic<uint64_t> epoch{0};
+    mutable std::atomic<size_t> readers[2] = {{0}, {0}};
+    std::mutex writer;  // serializes store(); readers never touch it
+
+public:
+    explicit RcuPtr(std::shared_ptr<T> initial = nullptr)
+        : current(new std::shared_ptr<T>(std::move(initial))) {}
+
+    ~RcuPtr() { delete current.load(); }
+
+    RcuPtr(const RcuPtr&) = delete;
+    RcuPtr& operator=(const RcuPtr&) = delete;
+
+    std::shared_ptr<T> load() const {
+        for (;;) {
+            const uint64_t e = epoch.load();
+            readers[e & 1].fetch_add(1);
+            // A store() between the two epoch reads may already be waiting
+            // on the other counter; retry in the new epoch
+            if (epoch.load() == e) {
+                std::shared_ptr<T> value = *current.load();
+                readers[e & 1].fetch_sub(1);
+                return value;
+            }
+            readers[e & 1].fetch_sub(1);
+        }
+    }
+
+    // Readers that start after this returns see value. The previous value
+    // is released here unless a reader still holds a copy.
+    void store(std::shared_ptr<T> value) {
+        std::lock_guard<std::mutex> lock(writer);
+        std::shared_ptr<T>* fresh = new std::shared_ptr<T>(std::move(value));
+        std::shared_ptr<T>* old = current.exchange(fresh);
+        const uint64_t e = epoch.fetch_add(1);
+        // Readers of earlier epochs were drained by the previous store
+        while (readers[e & 1].load() != 0) std::this_thread::yield();
+        delete old;
+    }
+};
+
+#endif
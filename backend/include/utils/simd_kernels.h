@@ -0,0 +1,60 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+
+// Instruction set levels, ordered from least to most capable
+enum class SimdLevel {
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+// Table of vectorized dense-layer kernels for one instruction set and
+// scalar type (float or double). All matrices are row-major and all vectors
+// contiguous.
+template<typename T>
+struct SimdKernels {
+    SimdLevel level;
+
+    // sum(a[i] * b[i])
+    T (*dot)(const T* a, const T* b, size_t n);
+    // y += alpha * x
+    void (*axpy)(T alpha, const T* x, T* y, size_t n);
+    // y (rows) += W (rows x cols) * x (cols)
+    void (*gemv)(const T* W, const T* x, T* y, size_t rows, size_t cols);
+    // C[mr x nr] += alpha * A_panel (kc x 4) * B_panel (kc x NR), packed as in
+    // gemm.h; NR is 8 for double and 16 for float
+    void (*gemm_micro)(size_t kc, const T* a, const T* b, T* C, size_t ldc,
+                       size_t mr, size_t nr, T alpha);
+    // Every row of Y (rows x cols) += b
+    void (*bias_add)(T* Y, const T* b, size_t rows, size_t cols);
+
+    // In-place activations
+    void (*sigmoid)(T* x, size_t n);
+    void (*relu)(T* x, size_t n);
+    void (*tanh)(T* x, size_t n);
+
+    // d *= f'(y), with the derivative expressed through the activation output y
+    void (*sigmoid_grad)(const T* y, T* d, size_t n);
+    void (*relu_grad)(const T* y, T* d, size_t n);
+    void (*tanh_grad)(const T* y, T* d, size_t n);
+};
+
+// Best level supported by this CPU and OS. The CNN_SIMD_LEVEL environment
+// variable (scalar, sse4.2, avx2, avx512) can cap it, e.g. to compare paths.
+SimdLevel detect_simd_level();
+
+// Kernels for a given level; levels the CPU cannot run fall back to the best
+// supported one below them. Defined for float and double.
+template<typename T>
+const SimdKernels<T>& simd_kernels_for(SimdLevel level);
+
+// Kernels for the detected level, resolved once on first use
+template<typename T>
+const SimdKernels<T>& simd();
+
+const char* simd_level_name(SimdLevel level);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running posted jobs in FIFO order. Unlike
+// parallel_for, the threads live as long as the pool, so short jobs
+// arriving one at a time (e.g. one per request) pay no thread start-up.
+class ThreadPool {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cv.wait(lock, [&]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+public:
+    explicit ThreadPool(int num_threads) {
+        if (num_threads <= 0) {
+            throw std::invalid_argument("ThreadPool needs at least one thread");
+        }
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    ~ThreadPool() { shutdown(); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a job; false (and the job is dropped) once shutdown has begun.
+    // Jobs must not throw.
+    bool post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) return false;
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    // Run the jobs already queued, then join the threads; later posts fail
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& thread : threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+
+    size_t size() const { return threads.size(); }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TRAINING_HELPERS_H
+#define TRAINING_HELPERS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Pieces shared by the training loops of NeuralNetwork and Sequential
+
+// Copy the rows order[start .. start + count) of src into one contiguous block
+template<typename T>
+void gather_rows(const std::vector<std::vector<T>>& src, const std::vector<size_t>& order,
+                 size_t start, size_t count, std::vector<T>& dst) {
+    dst.clear();
+    for (size_t i = start; i < start + count; i++) {
+        const std::vector<T>& row = src[order[i]];
+        dst.insert(dst.end(), row.begin(), row.end());
+    }
+}
+
+// Per-epoch progress line of every training mode, from the summed loss and
+// correct count of the epoch's samples
+inline void report_epoch(int epoch, int epochs, double loss, size_t correct, size_t samples) {
+    double n = static_cast<double>(std::max<size_t>(1, samples));
+    std::cout << "Epoch " << epoch << "/" << epochs
+              << " - Loss: " << loss / n
+              << " - Accuracy: " << 100.0 * correct / n << "%" << std::endl;
+}
+
+#endif
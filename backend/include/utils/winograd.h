@@ -0,0 +1,284 @@
+#ifndef WINOGRAD_H
+#define WINOGRAD_H
+
+#include <algorithm>
+#include <cstddef>
+#include "im2col.h"
+
+// Winograd minimal filtering F(m x m, 3 x 3) for 3x3, stride 1 convolutions.
+// The output is cut into m x m tiles, each computed from an (m + 2)^2 input
+// tile. Filters and input tiles are moved into the transform domain, where
+// the convolution becomes (m + 2)^2 independent channel-mixing products (one
+// GEMM each), so an output tile costs (m + 2)^2 instead of 9 m^2
+// multiplications per filter and channel: 2.25x fewer for F(2x2, 3x3) and
+// 4x fewer for F(4x4, 3x3).
+//
+// Larger tiles amplify rounding. In float, F(2x2) stays within ~1e-6 of the
+// im2col result relative to the largest output and F(4x4) within ~5e-6
+// (checked by test_winograd_conv).
+
+// Transforms from Lavin & Gray, "Fast Algorithms for Convolutional Neural
+// Networks": Y = A^T [(G g G^T) * (B^T d B)] A. B^T and A^T are applied as
+// explicit 1-D formulas over "lanes" (tiles or columns), with compile-time
+// input and output strides, so each 2-D transform is two vectorizable
+// passes; d[k] / m[k] and out[i] point at the k-th input and i-th output of
+// lane 0.
+template<int M>
+struct WinogradTransform;
+
+template<>
+struct WinogradTransform<2> {
+    static constexpr int alpha = 4;
+    static constexpr double G[4][3] = {
+        {1.0,  0.0, 0.0},
+        {0.5,  0.5, 0.5},
+        {0.5, -0.5, 0.5},
+        {0.0,  0.0, 1.0}
+    };
+
+    // B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1]
+    template<int SI, int SO, typename T>
+    static void input(const T* const* d, T* const* out, int lanes) {
+        const T* __restrict__ d0 = d[0];
+        const T* __restrict__ d1 = d[1];
+        const T* __restrict__ d2 = d[2];
+        const T* __restrict__ d3 = d[3];
+        T* __restrict__ o0 = out[0];
+        T* __restrict__ o1 = out[1];
+        T* __restrict__ o2 = out[2];
+        T* __restrict__ o3 = out[3];
+        for (int l = 0; l < lanes; l++) {
+            const T x0 = d0[l * SI], x1 = d1[l * SI], x2 = d2[l * SI], x3 = d3[l * SI];
+            o0[l * SO] = x0 - x2;
+            o1[l * SO] = x1 + x2;
+            o2[l * SO] = x2 - x1;
+            o3[l * SO] = x1 - x3;
+        }
+    }
+
+    // A^T = [1 1 1 0; 0 1 -1 -1]
+    template<int SI, int SO, typename T>
+    static void output(const T* const* m, T* const* out, int lanes) {
+        const T* __restrict__ m0 = m[0];
+        const T* __restrict__ m1 = m[1];
+        const T* __restrict__ m2 = m[2];
+        const T* __restrict__ m3 = m[3];
+        T* __restrict__ o0 = out[0];
+        T* __restrict__ o1 = out[1];
+        for (int l = 0; l < lanes; l++) {
+            const T x1 = m1[l * SI], x2 = m2[l * SI];
+            o0[l * SO] = m0[l * SI] + x1 + x2;
+            o1[l * SO] = x1 - x2 - m3[l * SI];
+        }
+    }
+};
+
+template<>
+struct WinogradTransform<4> {
+    static constexpr int alpha = 6;
+    static constexpr double G[6][3] = {
+        { 1.0 / 4,        0.0,        0.0},
+        {-1.0 / 6,  -1.0 / 6,   -1.0 / 6},
+        {-1.0 / 6,   1.0 / 6,   -1.0 / 6},
+        { 1.0 / 24,  1.0 / 12,   1.0 / 6},
+        { 1.0 / 24, -1.0 / 12,   1.0 / 6},
+        {      0.0,       0.0,       1.0}
+    };
+
+    // B^T = [4  0 -5  0 1 0;
+    //        0 -4 -4  1 1 0;
+    //        0  4 -4 -1 1 0;
+    //        0 -2 -1  2 1 0;
+    //        0  2 -1 -2 1 0;
+    //        0  4  0 -5 0 1]
+    template<int SI, int SO, typename T>
+    static void input(const T* const* d, T* const* out, int lanes) {
+        const T* __restrict__ d0 = d[0];
+        const T* __restrict__ d1 = d[1];
+        const T* __restrict__ d2 = d[2];
+        const T* __restrict__ d3 = d[3];
+        const T* __restrict__ d4 = d[4];
+        const T* __restrict__ d5 = d[5];
+        T* __restrict__ o0 = out[0];
+        T* __restrict__ o1 = out[1];
+        T* __restrict__ o2 = out[2];
+        T* __restrict__ o3 = out[3];
+        T* __restrict__ o4 = out[4];
+        T* __restrict__ o5 = out[5];
+        for (int l = 0; l < lanes; l++) {
+            const T x0 = d0[l * SI], x1 = d1[l * SI], x2 = d2[l * SI];
+            const T x3 = d3[l * SI], x4 = d4[l * SI], x5 = d5[l * SI];
+            o0[l * SO] = T(4) * x0 - T(5) * x2 + x4;
+            o1[l * SO] = (x3 + x4) - T(4) * (x1 + x2);
+            o2[l * SO] = (x4 - x3) + T(4) * (x1 - x2);
+            o3[l * SO] = (x4 - x2) + T(2) * (x3 - x1);
+            o4[l * SO] = (x4 - x2) + T(2) * (x1 - x3);
+            o5[l * SO] = T(4) * x1 - T(5) * x3 + x5;
+        }
+    }
+
+    // A^T = [1 1  1 1  1 0;
+    //        0 1 -1 2 -2 0;
+    //        0 1  1 4  4 0;
+    //        0 1 -1 8 -8 1]
+    template<int SI, int SO, typename T>
+    static void output(const T* const* m, T* const* out, int lanes) {
+        const T* __restrict__ m0 = m[0];
+        const T* __restrict__ m1 = m[1];
+        const T* __restrict__ m2 = m[2];
+        const T* __restrict__ m3 = m[3];
+        const T* __restrict__ m4 = m[4];
+        const T* __restrict__ m5 = m[5];
+        T* __restrict__ o0 = out[0];
+        T* __restrict__ o1 = out[1];
+        T* __restrict__ o2 = out[2];
+        T* __restrict__ o3 = out[3];
+        for (int l = 0; l < lanes; l++) {
+            const T a = m1[l * SI] + m2[l * SI], b = m1[l * SI] - m2[l * SI];
+            const T c = m3[l * SI] + m4[l * SI], e = m3[l * SI] - m4[l * SI];
+            o0[l * SO] = m0[l * SI] + a + c;
+            o1[l * SO] = b + T(2) * e;
+            o2[l * SO] = a + T(4) * c;
+            o3[l * SO] = b + T(8) * e + m5[l * SI];
+        }
+    }
+};
+
+// Output tiles per sample: tiles_y x tiles_x
+template<int M>
+size_t winograd_tiles(const ConvGeometry& g) {
+    return static_cast<size_t>((g.out_height() + M - 1) / M) * ((g.out_width() + M - 1) / M);
+}
+
+// U = G g G^T for every filter and channel of the filters x (C * 9) filter
+// matrix, stored as alpha^2 matrices of filters x channels. Computed in
+// double so only the final rounding is in T.
+template<int M, typename T>
+void winograd_filter_transform(const T* weights, int filters, int channels, T* u) {
+    using W = WinogradTransform<M>;
+    constexpr int alpha = W::alpha;
+    const size_t plane = static_cast<size_t>(filters) * channels;
+    for (int f = 0; f < filters; f++) {
+        for (int c = 0; c < channels; c++) {
+            const T* k = weights + (static_cast<size_t>(f) * channels + c) * 9;
+            double gg[alpha][3];
+            for (int i = 0; i < alpha; i++) {
+                for (int j = 0; j < 3; j++) {
+                    gg[i][j] = W::G[i][0] * k[j] + W::G[i][1] * k[3 + j] + W::G[i][2] * k[6 + j];
+                }
+            }
+            T* out = u + static_cast<size_t>(f) * channels + c;
+            for (int i = 0; i < alpha; i++) {
+                for (int j = 0; j < alpha; j++) {
+                    double v = gg[i][0] * W::G[j][0] + gg[i][1] * W::G[j][1] + gg[i][2] * W::G[j][2];
+                    out[(i * alpha + j) * plane] = static_cast<T>(v);
+                }
+            }
+        }
+    }
+}
+
+// Elements of scratch the input and output transforms take: two sets of
+// alpha rows of one padded tile row
+template<int M>
+size_t winograd_scratch_size(const ConvGeometry& g) {
+    const size_t tiles_x = (g.out_width() + M - 1) / M;
+    return 2 * WinogradTransform<M>::alpha * (tiles_x * M + 2);
+}
+
+// V = B^T d B for every input tile d of one sample (zero outside the image),
+// stored as alpha^2 matrices of channels x tiles. Works one row of tiles at
+// a time: B^T runs down the zero-padded rows, then B across each tile.
+template<int M, typename T>
+void winograd_input_transform(const T* x, const ConvGeometry& g, T* v, T* scratch) {
+    using W = WinogradTransform<M>;
+    constexpr int alpha = W::alpha;
+    const int tiles_y = (g.out_height() + M - 1) / M;
+    const int tiles_x = (g.out_width() + M - 1) / M;
+    const size_t tiles = static_cast<size_t>(tiles_y) * tiles_x;
+    const size_t plane = static_cast<size_t>(g.channels) * tiles;
+
+    // Columns of a padded tile row, and the ones the image covers
+    const int span = tiles_x * M + 2;
+    const int first = std::min(g.padding, span);
+    const int last = std::min(g.padding + g.width, span);
+
+    T* padded[alpha];
+    T* rows[alpha];
+    for (int i = 0; i < alpha; i++) {
+        padded[i] = scratch + i * span;
+        rows[i] = scratch + (alpha + i) * span;
+    }
+
+    for (int c = 0; c < g.channels; c++) {
+        const T* image = x + static_cast<size_t>(c) * g.height * g.width;
+        for (int ty = 0; ty < tiles_y; ty++) {
+            const int y0 = ty * M - g.padding;
+            for (int k = 0; k < alpha; k++) {
+                const int iy = y0 + k;
+                std::fill(padded[k], padded[k] + span, T(0));
+                if (iy < 0 || iy >= g.height) continue;
+                const T* row = image + static_cast<size_t>(iy) * g.width;
+                std::copy(row + (first - g.padding), row + (last - g.padding), padded[k] + first);
+            }
+            W::template input<1, 1>(padded, rows, span);
+
+            T* dst = v + static_cast<size_t>(c) * tiles + static_cast<size_t>(ty) * tiles_x;
+            for (int i = 0; i < alpha; i++) {
+                const T* taps[alpha];
+                T* out[alpha];
+                for (int k = 0; k < alpha; k++) {
+                    taps[k] = rows[i] + k;
+                    out[k] = dst + (i * alpha + k) * plane;
+                }
+                W::template input<M, 1>(taps, out, tiles_x);
+            }
+        }
+    }
+}
+
+// Y = A^T m A for every tile of the alpha^2 products (filters x tiles each),
+// clipped to the filters x out_height x out_width output of one sample. A
+// runs across each tile of a tile row, then A^T down the columns.
+template<int M, typename T>
+void winograd_output_transform(const T* products, const ConvGeometry& g, int filters, T* y,
+                               T* scratch) {
+    using W = WinogradTransform<M>;
+    constexpr int alpha = W::alpha;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const int tiles_y = (oh + M - 1) / M;
+    const int tiles_x = (ow + M - 1) / M;
+    const size_t tiles = static_cast<size_t>(tiles_y) * tiles_x;
+    const size_t plane = static_cast<size_t>(filters) * tiles;
+    const int span = tiles_x * M + 2;
+
+    // Rows past the bottom edge go to spare scratch rows
+    T* rows[alpha];
+    T* spare[M];
+    for (int i = 0; i < alpha; i++) rows[i] = scratch + i * span;
+    for (int a = 0; a < M; a++) spare[a] = scratch + (alpha + a) * span;
+
+    for (int f = 0; f < filters; f++) {
+        T* out = y + static_cast<size_t>(f) * oh * ow;
+        for (int ty = 0; ty < tiles_y; ty++) {
+            const T* src = products + static_cast<size_t>(f) * tiles + static_cast<size_t>(ty) * tiles_x;
+            for (int i = 0; i < alpha; i++) {
+                const T* m[alpha];
+                T* cols[M];
+                for (int k = 0; k < alpha; k++) m[k] = src + (i * alpha + k) * plane;
+                for (int a = 0; a < M; a++) cols[a] = rows[i] + a;
+                W::template output<1, M>(m, cols, tiles_x);
+            }
+
+            T* targets[M];
+            for (int a = 0; a < M; a++) {
+                const int oy = ty * M + a;
+                targets[a] = oy < oh ? out + static_cast<size_t>(oy) * ow : spare[a];
+            }
+            W::template output<1, 1>(rows, targets, ow);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include "aligned_buffer.h"
+
+// Bump-pointer arena for the scratch buffers of one forward/backward pass.
+// The block is reserved up front and handed out in cache-line aligned
+// slices, so a training step in steady state does no heap allocation.
+// Not thread-safe: every thread works in its own arena (thread_workspace()).
+class Workspace {
+private:
+    AlignedVector<double> block;
+    size_t used = 0;   // in doubles
+    size_t peak = 0;   // high-water mark of used, in doubles
+    size_t grows = 0;  // times the block had to be reallocated
+
+public:
+    // Bytes that alloc<T>(count) consumes, including alignment padding
+    template<typename T>
+    static constexpr size_t bytes_for(size_t count) {
+        return align_elements<double>((count * sizeof(T) + sizeof(double) - 1) / sizeof(double))
+               * sizeof(double);
+    }
+
+    // Make sure at least bytes are available. The block can only move while
+    // nothing is handed out, so call this before the first alloc of a pass.
+    void reserve(size_t bytes) {
+        size_t needed = (bytes + sizeof(double) - 1) / sizeof(double);
+        if (needed <= block.size()) return;
+        if (used != 0) {
+            throw std::logic_error("Workspace cannot grow while buffers are in use");
+        }
+        block.resize(align_elements<double>(needed));
+        grows++;
+    }
+
+    // Uninitialized, 64-byte aligned slice of count elements
+    template<typename T>
+    T* alloc(size_t count) {
+        size_t doubles = bytes_for<T>(count) / sizeof(double);
+        if (used + doubles > block.size()) {
+            throw std::length_error("Workspace exhausted; reserve() a larger arena first");
+        }
+        T* p = reinterpret_cast<T*>(block.data() + used);
+        used += doubles;
+        peak = std::max(peak, used);
+        return p;
+    }
+
+    // Hand the whole arena back
+    void reset() { used = 0; }
+
+    size_t capacity_bytes() const { return block.size() * sizeof(double); }
+    size_t used_bytes() const { return used * sizeof(double); }
+    size_t peak_bytes() const { return peak * sizeof(double); }
+    size_t grow_count() const { return grows; }
+
+    // Releases everything allocated after its construction
+    class Scope {
+    private:
+        Workspace& ws;
+        size_t mark;
+
+    public:
+        explicit Scope(Workspace& w) : ws(w), mark(w.used) {}
+        ~Scope() { ws.used = mark; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+// The calling thread's arena, reused across every call on that thread
+inline Workspace& thread_workspace() {
+    thread_local Workspace workspace;
+    return workspace;
+}
+
+#endif
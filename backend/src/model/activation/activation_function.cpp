@@ -4,15 +4,19 @@
 #include "tanh_activation.h"
 
 // Factory method implementation - demonstrates polymorphism
-std::unique_ptr<ActivationFunction> ActivationFactory::create(ActivationType type) {
+template<typename T>
+std::unique_ptr<ActivationFunction<T>> ActivationFactory::create(ActivationType type) {
     switch (type) {
         case ActivationType::SIGMOID:
-            return std::make_unique<SigmoidActivation>();
+            return std::make_unique<SigmoidActivation<T>>();
         case ActivationType::RELU:
-            return std::make_unique<ReLUActivation>();
+            return std::make_unique<ReLUActivation<T>>();
         case ActivationType::TANH:
-            return std::make_unique<TanhActivation>();
+            return std::make_unique<TanhActivation<T>>();
         default:
-            return std::make_unique<SigmoidActivation>();
+            return std::make_unique<SigmoidActivation<T>>();
     }
 }
+
+template std::unique_ptr<ActivationFunction<float>> ActivationFactory::create<float>(ActivationType type);
+template std::unique_ptr<ActivationFunction<double>> ActivationFactory::create<double>(ActivationType type);
@@ -0,0 +1,382 @@
+#include "conv2d.h"
+#include "direct_conv.h"
+#include "gemm.h"
+#include "parallel_for.h"
+#include "simd_kernels.h"
+#include "winograd.h"
+#include "workspace.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// y[f][p] += b[f] for every filter's output plane
+template<typename T>
+void add_filter_biases(T* y, const T* biases, int filters, size_t positions) {
+    for (int f = 0; f < filters; f++) {
+        T* plane = y + static_cast<size_t>(f) * positions;
+        const T b = biases[f];
+        for (size_t p = 0; p < positions; p++) {
+            plane[p] += b;
+        }
+    }
+}
+
+} // namespace
+
+const char* conv_algorithm_name(ConvAlgorithm algorithm) {
+    switch (algorithm) {
+        case ConvAlgorithm::AUTO: return "auto";
+        case ConvAlgorithm::IM2COL: return "im2col";
+        case ConvAlgorithm::DIRECT: return "direct NCHWc";
+        case ConvAlgorithm::WINOGRAD_2X2: return "Winograd F(2x2,3x3)";
+        case ConvAlgorithm::WINOGRAD_4X4: return "Winograd F(4x4,3x3)";
+    }
+    return "unknown";
+}
+
+template<typename T>
+Conv2D<T>::Conv2D(int f, int k, int s, int p)
+    : filters(f), kernel(k), stride(s), padding(p) {
+    if (filters <= 0 || kernel <= 0 || stride <= 0 || padding < 0) {
+        throw std::invalid_argument("Conv2D needs positive filters, kernel and stride");
+    }
+}
+
+template<typename T>
+std::string Conv2D<T>::describe() const {
+    std::string text = "Conv2D(" + std::to_string(filters) + " filters, " + std::to_string(kernel) +
+                       "x" + std::to_string(kernel) + ", stride " + std::to_string(stride) +
+                       ", padding " + std::to_string(padding);
+    if (algorithm != ConvAlgorithm::IM2COL) text += std::string(", ") + conv_algorithm_name(algorithm);
+    return text + ")";
+}
+
+template<typename T>
+LayerConfig Conv2D<T>::config() const {
+    LayerConfig c;
+    c.kind = LayerKind::CONV2D;
+    c.args[0] = filters;
+    c.args[1] = kernel;
+    c.args[2] = stride;
+    c.args[3] = padding;
+    return c;
+}
+
+template<typename T>
+Shape Conv2D<T>::build(const Shape& input) {
+    ConvGeometry g;
+    g.channels = input.channels;
+    g.height = input.height;
+    g.width = input.width;
+    g.kernel = kernel;
+    g.stride = stride;
+    g.padding = padding;
+    if (g.channels <= 0 || g.height + 2 * padding < kernel || g.width + 2 * padding < kernel) {
+        throw std::invalid_argument("Conv2D kernel does not fit the " + input.str() + " input");
+    }
+    Shape output = {filters, g.out_height(), g.out_width()};
+
+    const int patch = static_cast<int>(g.col_rows());
+    if (block.inputs != 0 && block.inputs != patch) {
+        throw std::invalid_argument("Conv2D layer was already built for another input");
+    }
+    geometry = g;
+    algorithm = resolve_algorithm();
+    params_version++;  // the geometry or algorithm may have changed
+    if (block.inputs == patch) return output;
+
+    // Same initialization as the dense layers
+    block = DenseLayer<T>(patch, filters);
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::normal_distribution<> d(0, 0.1);
+    for (int j = 0; j < filters; j++) {
+        T* w = block.row(j);
+        for (int k = 0; k < patch; k++) {
+            w[k] = d(gen);
+        }
+        block.biases()[j] = d(gen);
+    }
+    return output;
+}
+
+template<typename T>
+ConvAlgorithm Conv2D<T>::resolve_algorithm() const {
+    const ConvGeometry& g = geometry;
+    const bool fits = kernel == 3 && stride == 1;
+    if (requested != ConvAlgorithm::AUTO) {
+        bool winograd = requested == ConvAlgorithm::WINOGRAD_2X2 ||
+                        requested == ConvAlgorithm::WINOGRAD_4X4;
+        if (winograd && !fits) {
+            throw std::invalid_argument("Winograd convolution needs a 3x3 kernel at stride 1");
+        }
+        return requested;
+    }
+    if (g.channels < 2 || g.is_pointwise()) return ConvAlgorithm::IM2COL;
+    const int extent = std::min(g.out_height(), g.out_width());
+    if (fits && filters >= 32 && extent >= 16 && g.channels * extent >= 1024) {
+        return ConvAlgorithm::WINOGRAD_4X4;
+    }
+    return ConvAlgorithm::DIRECT;
+}
+
+template<typename T>
+void Conv2D<T>::set_algorithm(ConvAlgorithm requested_algorithm) {
+    ConvAlgorithm previous = requested;
+    requested = requested_algorithm;
+    if (block.inputs == 0) return;
+    try {
+        algorithm = resolve_algorithm();
+    } catch (...) {
+        requested = previous;
+        throw;
+    }
+    params_version++;
+}
+
+template<typename T>
+size_t Conv2D<T>::workspace_bytes() const {
+    const ConvGeometry& g = geometry;
+    size_t bytes = g.is_pointwise() ? 0 : 2 * Workspace::bytes_for<T>(g.col_rows() * g.col_cols());
+    if (algorithm == ConvAlgorithm::IM2COL) return bytes;
+    if (algorithm == ConvAlgorithm::DIRECT) {
+        // Padded NCHWc sample and NCHWc output
+        size_t padded = static_cast<size_t>(g.height + 2 * padding) * (g.width + 2 * padding);
+        size_t direct = Workspace::bytes_for<T>(conv_blocks(g.channels) * padded * CONV_BLOCK) +
+                        Workspace::bytes_for<T>(conv_blocks(filters) * g.col_cols() * CONV_BLOCK);
+        return std::max(bytes, direct);
+    }
+
+    // Transformed tiles (alpha^2 x C x tiles), products (alpha^2 x F x tiles)
+    // and the transforms' scratch rows
+    const bool large = algorithm == ConvAlgorithm::WINOGRAD_4X4;
+    const size_t alpha2 = large ? 36 : 16;
+    const size_t tiles = large ? winograd_tiles<4>(g) : winograd_tiles<2>(g);
+    const size_t scratch = large ? winograd_scratch_size<4>(g) : winograd_scratch_size<2>(g);
+    size_t winograd = Workspace::bytes_for<T>(alpha2 * g.channels * tiles) +
+                      Workspace::bytes_for<T>(alpha2 * filters * tiles) +
+                      Workspace::bytes_for<T>(scratch);
+    return std::max(bytes, winograd);
+}
+
+template<typename T>
+const T* Conv2D<T>::forward_filters() {
+    // Parameters are not written during forward passes, so once packed
+    // every concurrent pass takes this path
+    const uint64_t version = params_version.load(std::memory_order_acquire);
+    if (packed_version.load(std::memory_order_acquire) == version) return packed_filters.data();
+
+    std::lock_guard<std::mutex> lock(packed_mutex);
+    if (packed_version.load(std::memory_order_relaxed) != version) {
+        const int channels = geometry.channels;
+        if (algorithm == ConvAlgorithm::DIRECT) {
+            const size_t weights = conv_blocks(filters) * geometry.col_rows() * CONV_BLOCK;
+            packed_filters.resize(weights + conv_blocks(filters) * CONV_BLOCK);
+            pack_nchwc_filters(block.weights(), block.biases(), filters, channels, kernel,
+                               packed_filters.data(), packed_filters.data() + weights);
+        } else if (algorithm == ConvAlgorithm::WINOGRAD_4X4) {
+            packed_filters.resize(36 * filters * channels);
+            winograd_filter_transform<4>(block.weights(), filters, channels, packed_filters.data());
+        } else {
+            packed_filters.resize(16 * filters * channels);
+            winograd_filter_transform<2>(block.weights(), filters, channels, packed_filters.data());
+        }
+        packed_version.store(version, std::memory_order_release);
+    }
+    return packed_filters.data();
+}
+
+template<typename T>
+void Conv2D<T>::forward_direct(const T* in, T* out, size_t n) {
+    const ConvGeometry& g = geometry;
+    const size_t in_size = static_cast<size_t>(g.channels) * g.height * g.width;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const size_t positions = g.col_cols();
+    const size_t out_size = filters * positions;
+    const int hp = g.height + 2 * padding;
+    const int wp = g.width + 2 * padding;
+    const size_t in_block = static_cast<size_t>(hp) * wp * CONV_BLOCK;
+    const size_t out_block = positions * CONV_BLOCK;
+    const int out_blocks = conv_blocks(filters);
+
+    const T* packed = forward_filters();
+    const size_t block_weights = g.col_rows() * CONV_BLOCK;
+    const T* packed_biases = packed + out_blocks * block_weights;
+    const DirectConvKernels<T>& kernels = direct_conv_kernels<T>();
+
+    // The sample is reordered to padded NCHWc once, every output row of
+    // every 8-filter block is one kernel call, and the NCHWc output is
+    // reordered back to the graph's C x H x W rows
+    parallel_for(n, num_threads, [&](size_t begin, size_t end, size_t) {
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* blocked_in = ws.alloc<T>(conv_blocks(g.channels) * in_block);
+        T* blocked_out = ws.alloc<T>(out_blocks * out_block);
+
+        DirectConvArgs<T> args;
+        args.channel_stride = in_block;
+        args.row_stride = static_cast<size_t>(wp) * CONV_BLOCK;
+        args.channels = g.channels;
+        args.kernel = kernel;
+        args.stride = stride;
+        args.out_width = ow;
+
+        for (size_t s = begin; s < end; s++) {
+            to_nchwc(in + s * in_size, g.channels, g.height, g.width, padding, blocked_in);
+            for (int b = 0; b < out_blocks; b++) {
+                args.weights = packed + b * block_weights;
+                args.bias = packed_biases + b * CONV_BLOCK;
+                for (int oy = 0; oy < oh; oy++) {
+                    args.input = blocked_in + static_cast<size_t>(oy) * stride * args.row_stride;
+                    args.output = blocked_out + b * out_block + static_cast<size_t>(oy) * ow * CONV_BLOCK;
+                    kernels.row(args);
+                }
+            }
+            from_nchwc(blocked_out, filters, oh, ow, out + s * out_size);
+        }
+    });
+}
+
+template<typename T>
+template<int M>
+void Conv2D<T>::forward_winograd(const T* in, T* out, size_t n) {
+    const ConvGeometry& g = geometry;
+    const size_t in_size = static_cast<size_t>(g.channels) * g.height * g.width;
+    const size_t positions = g.col_cols();
+    const size_t out_size = filters * positions;
+    constexpr size_t alpha2 = WinogradTransform<M>::alpha * WinogradTransform<M>::alpha;
+    const size_t tiles = winograd_tiles<M>(g);
+    const size_t channels = g.channels;
+    const T* u = forward_filters();
+
+    // Per transform-domain point e: products_e (F x tiles) = U_e (F x C) * V_e (C x tiles)
+    parallel_for(n, num_threads, [&](size_t begin, size_t end, size_t) {
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* v = ws.alloc<T>(alpha2 * channels * tiles);
+        T* products = ws.alloc<T>(alpha2 * filters * tiles);
+        T* scratch = ws.alloc<T>(winograd_scratch_size<M>(g));
+
+        for (size_t s = begin; s < end; s++) {
+            winograd_input_transform<M>(in + s * in_size, g, v, scratch);
+            for (size_t e = 0; e < alpha2; e++) {
+                gemm(Transpose::NO, Transpose::NO, filters, tiles, channels, T(1),
+                     u + e * filters * channels, channels, v + e * channels * tiles, tiles,
+                     T(0), products + e * filters * tiles, tiles);
+            }
+            T* y = out + s * out_size;
+            winograd_output_transform<M>(products, g, filters, y, scratch);
+            add_filter_biases(y, block.biases(), filters, positions);
+        }
+    });
+}
+
+template<typename T>
+void Conv2D<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+}
+
+template<typename T>
+void Conv2D<T>::forward(const T* in, T* out, size_t n, bool) {
+    if (algorithm == ConvAlgorithm::WINOGRAD_4X4) return forward_winograd<4>(in, out, n);
+    if (algorithm == ConvAlgorithm::WINOGRAD_2X2) return forward_winograd<2>(in, out, n);
+    if (algorithm == ConvAlgorithm::DIRECT) return forward_direct(in, out, n);
+
+    const ConvGeometry& g = geometry;
+    const size_t in_size = static_cast<size_t>(g.channels) * g.height * g.width;
+    const size_t patch = g.col_rows();
+    const size_t positions = g.col_cols();
+    const size_t out_size = filters * positions;
+
+    // out (filters x positions) = W (filters x patch) * col (patch x positions)
+    parallel_for(n, num_threads, [&](size_t begin, size_t end, size_t) {
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* col = g.is_pointwise() ? nullptr : ws.alloc<T>(patch * positions);
+
+        for (size_t s = begin; s < end; s++) {
+            const T* x = in + s * in_size;
+            if (col != nullptr) {
+                im2col(x, g, col);
+                x = col;
+            }
+            T* y = out + s * out_size;
+            gemm(Transpose::NO, Transpose::NO, filters, positions, patch, T(1),
+                 block.weights(), patch, x, positions, T(0), y, positions);
+            add_filter_biases(y, block.biases(), filters, positions);
+        }
+    });
+}
+
+template<typename T>
+void Conv2D<T>::backward(const T* in, const T*, const T* grad_out, T* grad_in,
+                         size_t n, T* param_grads) {
+    const ConvGeometry& g = geometry;
+    const size_t in_size = static_cast<size_t>(g.channels) * g.height * g.width;
+    const size_t patch = g.col_rows();
+    const size_t positions = g.col_cols();
+    const size_t out_size = filters * positions;
+
+    const size_t threads = parallel_threads(n, num_threads);
+    partial_grads.resize(threads - 1);
+
+    parallel_for(n, num_threads, [&](size_t begin, size_t end, size_t t) {
+        T* grads = param_grads;
+        if (t > 0) {
+            partial_grads[t - 1].assign(block.params.size(), T(0));
+            grads = partial_grads[t - 1].data();
+        }
+
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* col = g.is_pointwise() ? nullptr : ws.alloc<T>(patch * positions);
+        T* dcol = g.is_pointwise() ? nullptr : ws.alloc<T>(patch * positions);
+
+        for (size_t s = begin; s < end; s++) {
+            const T* x = in + s * in_size;
+            const T* dy = grad_out + s * out_size;
+            if (col != nullptr) {
+                im2col(x, g, col);
+                x = col;
+            }
+
+            // dW += dy (filters x positions) * col^T, db += row sums of dy
+            gemm(Transpose::NO, Transpose::YES, filters, patch, positions, T(1),
+                 dy, positions, x, positions, T(1), grads, patch);
+            T* db = grads + block.bias_offset;
+            for (int f = 0; f < filters; f++) {
+                const T* row = dy + static_cast<size_t>(f) * positions;
+                for (size_t p = 0; p < positions; p++) {
+                    db[f] += row[p];
+                }
+            }
+
+            if (grad_in == nullptr) continue;
+            // dx = col2im(W^T * dy)
+            T* dx = grad_in + s * in_size;
+            if (dcol == nullptr) {
+                gemm(Transpose::YES, Transpose::NO, patch, positions, filters, T(1),
+                     block.weights(), patch, dy, positions, T(0), dx, positions);
+            } else {
+                gemm(Transpose::YES, Transpose::NO, patch, positions, filters, T(1),
+                     block.weights(), patch, dy, positions, T(0), dcol, positions);
+                std::fill(dx, dx + in_size, T(0));
+                col2im(dcol, g, dx);
+            }
+        }
+    });
+
+    for (size_t t = 1; t < threads; t++) {
+        simd<T>().axpy(T(1), partial_grads[t - 1].data(), param_grads, block.params.size());
+    }
+}
+
+template class Conv2D<float>;
+template class Conv2D<double>;
@@ -0,0 +1,199 @@
+#include "depthwise_conv2d.h"
+#include "direct_conv.h"
+#include "parallel_for.h"
+#include "workspace.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Copy one H x W plane into the middle of a zero (H + 2p) x (W + 2p) plane
+template<typename T>
+void pad_plane(const T* plane, int height, int width, int padding, T* padded) {
+    const int wp = width + 2 * padding;
+    std::fill(padded, padded + static_cast<size_t>(height + 2 * padding) * wp, T(0));
+    for (int y = 0; y < height; y++) {
+        std::copy(plane + static_cast<size_t>(y) * width, plane + static_cast<size_t>(y + 1) * width,
+                  padded + static_cast<size_t>(y + padding) * wp + padding);
+    }
+}
+
+} // namespace
+
+template<typename T>
+DepthwiseConv2D<T>::DepthwiseConv2D(int k, int s, int p)
+    : kernel(k), stride(s), padding(p) {
+    if (kernel <= 0 || stride <= 0 || padding < 0) {
+        throw std::invalid_argument("DepthwiseConv2D needs a positive kernel and stride");
+    }
+}
+
+template<typename T>
+std::string DepthwiseConv2D<T>::describe() const {
+    return "DepthwiseConv2D(" + std::to_string(kernel) + "x" + std::to_string(kernel) +
+           ", stride " + std::to_string(stride) + ", padding " + std::to_string(padding) + ")";
+}
+
+template<typename T>
+LayerConfig DepthwiseConv2D<T>::config() const {
+    LayerConfig c;
+    c.kind = LayerKind::DEPTHWISE_CONV2D;
+    c.args[0] = kernel;
+    c.args[1] = stride;
+    c.args[2] = padding;
+    return c;
+}
+
+template<typename T>
+Shape DepthwiseConv2D<T>::build(const Shape& input) {
+    ConvGeometry g;
+    g.channels = input.channels;
+    g.height = input.height;
+    g.width = input.width;
+    g.kernel = kernel;
+    g.stride = stride;
+    g.padding = padding;
+    if (g.channels <= 0 || g.height + 2 * padding < kernel || g.width + 2 * padding < kernel) {
+        throw std::invalid_argument("DepthwiseConv2D kernel does not fit the " + input.str() + " input");
+    }
+    if (block.outputs != 0 && block.outputs != g.channels) {
+        throw std::invalid_argument("DepthwiseConv2D layer was already built for another input");
+    }
+    geometry = g;
+    Shape output = {g.channels, g.out_height(), g.out_width()};
+    if (block.outputs != 0) return output;
+
+    // Same initialization as the dense layers
+    block = DenseLayer<T>(kernel * kernel, g.channels);
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::normal_distribution<> d(0, 0.1);
+    for (int c = 0; c < g.channels; c++) {
+        T* w = block.row(c);
+        for (int k = 0; k < kernel * kernel; k++) {
+            w[k] = d(gen);
+        }
+        block.biases()[c] = d(gen);
+    }
+    return output;
+}
+
+template<typename T>
+size_t DepthwiseConv2D<T>::workspace_bytes() const {
+    if (padding == 0) return 0;
+    size_t padded = static_cast<size_t>(geometry.height + 2 * padding) * (geometry.width + 2 * padding);
+    return 2 * Workspace::bytes_for<T>(padded);
+}
+
+template<typename T>
+void DepthwiseConv2D<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+}
+
+template<typename T>
+void DepthwiseConv2D<T>::forward(const T* in, T* out, size_t n, bool) {
+    const ConvGeometry& g = geometry;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const size_t in_plane = static_cast<size_t>(g.height) * g.width;
+    const size_t out_plane = static_cast<size_t>(oh) * ow;
+    const size_t row_stride = g.width + 2 * padding;
+    const DirectConvKernels<T>& kernels = direct_conv_kernels<T>();
+
+    parallel_for(n * g.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* padded = padding > 0 ? ws.alloc<T>((g.height + 2 * padding) * row_stride) : nullptr;
+
+        for (size_t plane = begin; plane < end; plane++) {
+            const int c = static_cast<int>(plane % g.channels);
+            const T* x = in + plane * in_plane;
+            if (padded != nullptr) {
+                pad_plane(x, g.height, g.width, padding, padded);
+                x = padded;
+            }
+            const T* w = block.row(c);
+            const T bias = block.biases()[c];
+            T* y = out + plane * out_plane;
+            for (int oy = 0; oy < oh; oy++) {
+                kernels.depthwise_row(x + static_cast<size_t>(oy) * stride * row_stride, row_stride,
+                                      w, bias, y + static_cast<size_t>(oy) * ow, kernel, stride, ow);
+            }
+        }
+    });
+}
+
+template<typename T>
+void DepthwiseConv2D<T>::backward(const T* in, const T*, const T* grad_out, T* grad_in,
+                                  size_t n, T* param_grads) {
+    const ConvGeometry& g = geometry;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const int hp = g.height + 2 * padding;
+    const int wp = g.width + 2 * padding;
+    const size_t in_plane = static_cast<size_t>(g.height) * g.width;
+    const size_t out_plane = static_cast<size_t>(oh) * ow;
+    const size_t padded_plane = static_cast<size_t>(hp) * wp;
+    const size_t taps = static_cast<size_t>(kernel) * kernel;
+
+    // Each thread owns whole channels, so their parameter gradients are
+    // never shared
+    parallel_for(g.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        Workspace& ws = thread_workspace();
+        ws.reserve(workspace_bytes());
+        Workspace::Scope scope(ws);
+        T* padded = padding > 0 ? ws.alloc<T>(padded_plane) : nullptr;
+        T* dpadded = padding > 0 ? ws.alloc<T>(padded_plane) : nullptr;
+
+        for (size_t c = begin; c < end; c++) {
+            const T* w = block.row(static_cast<int>(c));
+            T* dw = param_grads + c * taps;
+            T& db = param_grads[block.bias_offset + c];
+
+            for (size_t s = 0; s < n; s++) {
+                const size_t plane = s * g.channels + c;
+                const T* x = in + plane * in_plane;
+                const T* dy = grad_out + plane * out_plane;
+                T* dx = grad_in != nullptr ? grad_in + plane * in_plane : nullptr;
+                if (padded != nullptr) {
+                    pad_plane(x, g.height, g.width, padding, padded);
+                    x = padded;
+                }
+                // Without padding the input gradient accumulates in place
+                T* dxp = padded != nullptr ? dpadded : dx;
+                if (dxp != nullptr) std::fill(dxp, dxp + padded_plane, T(0));
+
+                for (int oy = 0; oy < oh; oy++) {
+                    const T* d = dy + static_cast<size_t>(oy) * ow;
+                    for (int ox = 0; ox < ow; ox++) db += d[ox];
+                    for (int ky = 0; ky < kernel; ky++) {
+                        const size_t row = static_cast<size_t>(oy * stride + ky) * wp;
+                        for (int kx = 0; kx < kernel; kx++) {
+                            const T* xr = x + row + kx;
+                            T acc = T(0);
+                            for (int ox = 0; ox < ow; ox++) acc += d[ox] * xr[ox * stride];
+                            dw[ky * kernel + kx] += acc;
+
+                            if (dxp == nullptr) continue;
+                            const T tap = w[ky * kernel + kx];
+                            T* dr = dxp + row + kx;
+                            for (int ox = 0; ox < ow; ox++) dr[ox * stride] += tap * d[ox];
+                        }
+                    }
+                }
+
+                if (dx != nullptr && padded != nullptr) {
+                    for (int y = 0; y < g.height; y++) {
+                        const T* src = dpadded + static_cast<size_t>(y + padding) * wp + padding;
+                        std::copy(src, src + g.width, dx + static_cast<size_t>(y) * g.width);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template class DepthwiseConv2D<float>;
+template class DepthwiseConv2D<double>;
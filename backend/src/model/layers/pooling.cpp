@@ -0,0 +1,189 @@
+#include "pooling.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Sum of n values in 8 independent lanes, which the compiler keeps in
+// vector registers without reordering a single running sum
+template<typename T>
+T plane_sum(const T* x, size_t n) {
+    constexpr size_t LANES = 8;
+    T lanes[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (size_t l = 0; l < LANES; l++) lanes[l] += x[i + l];
+    }
+    T sum = T(0);
+    for (; i < n; i++) sum += x[i];
+    for (size_t l = 0; l < LANES; l++) sum += lanes[l];
+    return sum;
+}
+
+} // namespace
+
+template<typename T>
+Pool2D<T>::Pool2D(PoolType pool_type, int pool_size, int pool_stride)
+    : type(pool_type), pool(pool_size), stride(pool_stride > 0 ? pool_stride : pool_size) {
+    if (pool <= 0) throw std::invalid_argument("Pooling window must be positive");
+}
+
+template<typename T>
+std::string Pool2D<T>::describe() const {
+    return std::string(type == PoolType::MAX ? "MaxPool2D(" : "AvgPool2D(") +
+           std::to_string(pool) + "x" + std::to_string(pool) +
+           ", stride " + std::to_string(stride) + ")";
+}
+
+template<typename T>
+LayerConfig Pool2D<T>::config() const {
+    LayerConfig c;
+    c.kind = kind();
+    c.args[0] = pool;
+    c.args[1] = stride;
+    return c;
+}
+
+template<typename T>
+Shape Pool2D<T>::build(const Shape& input) {
+    if (input.channels <= 0 || input.height < pool || input.width < pool) {
+        throw std::invalid_argument("Pooling window does not fit the " + input.str() + " input");
+    }
+    geometry.channels = input.channels;
+    geometry.height = input.height;
+    geometry.width = input.width;
+    geometry.kernel = pool;
+    geometry.stride = stride;
+    geometry.padding = 0;
+    return {input.channels, geometry.out_height(), geometry.out_width()};
+}
+
+template<typename T>
+void Pool2D<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+}
+
+template<typename T>
+void Pool2D<T>::forward(const T* in, T* out, size_t n, bool) {
+    const ConvGeometry& g = geometry;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const size_t in_plane = static_cast<size_t>(g.height) * g.width;
+    const T scale = T(1) / (pool * pool);
+
+    parallel_for(n * g.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t plane = begin; plane < end; plane++) {
+            const T* x = in + plane * in_plane;
+            T* y = out + plane * oh * ow;
+            for (int oy = 0; oy < oh; oy++) {
+                for (int ox = 0; ox < ow; ox++) {
+                    const T* window = x + static_cast<size_t>(oy * stride) * g.width + ox * stride;
+                    T acc = type == PoolType::MAX ? window[0] : T(0);
+                    for (int ky = 0; ky < pool; ky++) {
+                        const T* row = window + static_cast<size_t>(ky) * g.width;
+                        for (int kx = 0; kx < pool; kx++) {
+                            if (type == PoolType::MAX) {
+                                acc = std::max(acc, row[kx]);
+                            } else {
+                                acc += row[kx];
+                            }
+                        }
+                    }
+                    *y++ = type == PoolType::MAX ? acc : acc * scale;
+                }
+            }
+        }
+    });
+}
+
+template<typename T>
+void Pool2D<T>::backward(const T* in, const T*, const T* grad_out, T* grad_in,
+                         size_t n, T*) {
+    const ConvGeometry& g = geometry;
+    const int oh = g.out_height();
+    const int ow = g.out_width();
+    const size_t in_plane = static_cast<size_t>(g.height) * g.width;
+    const T scale = T(1) / (pool * pool);
+
+    // Planes are independent, so threads never write the same gradient
+    parallel_for(n * g.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t plane = begin; plane < end; plane++) {
+            const T* x = in + plane * in_plane;
+            const T* dy = grad_out + plane * oh * ow;
+            T* dx = grad_in + plane * in_plane;
+            std::fill(dx, dx + in_plane, T(0));
+
+            for (int oy = 0; oy < oh; oy++) {
+                for (int ox = 0; ox < ow; ox++) {
+                    const size_t origin = static_cast<size_t>(oy * stride) * g.width + ox * stride;
+                    const T d = *dy++;
+                    if (type == PoolType::AVERAGE) {
+                        for (int ky = 0; ky < pool; ky++) {
+                            T* row = dx + origin + static_cast<size_t>(ky) * g.width;
+                            for (int kx = 0; kx < pool; kx++) row[kx] += d * scale;
+                        }
+                        continue;
+                    }
+                    size_t best = origin;
+                    for (int ky = 0; ky < pool; ky++) {
+                        for (int kx = 0; kx < pool; kx++) {
+                            size_t at = origin + static_cast<size_t>(ky) * g.width + kx;
+                            if (x[at] > x[best]) best = at;
+                        }
+                    }
+                    dx[best] += d;
+                }
+            }
+        }
+    });
+}
+
+template<typename T>
+LayerConfig GlobalAvgPool2D<T>::config() const {
+    LayerConfig c;
+    c.kind = LayerKind::GLOBAL_AVG_POOL2D;
+    return c;
+}
+
+template<typename T>
+Shape GlobalAvgPool2D<T>::build(const Shape& input) {
+    if (input.channels <= 0) {
+        throw std::invalid_argument("Global pooling needs a C x H x W input");
+    }
+    input_shape = input;
+    return Shape::flat(input.channels);
+}
+
+template<typename T>
+void GlobalAvgPool2D<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+}
+
+template<typename T>
+void GlobalAvgPool2D<T>::forward(const T* in, T* out, size_t n, bool) {
+    const size_t pixels = static_cast<size_t>(input_shape.height) * input_shape.width;
+    const T scale = T(1) / pixels;
+    parallel_for(n * input_shape.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t plane = begin; plane < end; plane++) {
+            out[plane] = plane_sum(in + plane * pixels, pixels) * scale;
+        }
+    });
+}
+
+template<typename T>
+void GlobalAvgPool2D<T>::backward(const T*, const T*, const T* grad_out, T* grad_in,
+                                  size_t n, T*) {
+    const size_t pixels = static_cast<size_t>(input_shape.height) * input_shape.width;
+    const T scale = T(1) / pixels;
+    parallel_for(n * input_shape.channels, num_threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t plane = begin; plane < end; plane++) {
+            std::fill(grad_in + plane * pixels, grad_in + (plane + 1) * pixels, grad_out[plane] * scale);
+        }
+    });
+}
+
+template class Pool2D<float>;
+template class Pool2D<double>;
+template class GlobalAvgPool2D<float>;
+template class GlobalAvgPool2D<double>;
@@ -0,0 +1,238 @@
+#include "model_file.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+size_t align_up(size_t bytes) {
+    return (bytes + MODEL_FILE_ALIGNMENT - 1) / MODEL_FILE_ALIGNMENT * MODEL_FILE_ALIGNMENT;
+}
+
+// FNV-1a 64 of data, skipping the header's checksum field
+uint64_t model_checksum(const char* data, size_t size) {
+    const size_t skip_begin = offsetof(ModelFileHeader, checksum);
+    const size_t skip_end = skip_begin + sizeof(uint64_t);
+    uint64_t hash = fnv1a_checksum(data, std::min(size, skip_begin));
+    return size > skip_end ? fnv1a_checksum(data + skip_end, size - skip_end, hash) : hash;
+}
+
+template<typename V>
+void append(std::vector<char>& out, const V& value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), p, p + sizeof(V));
+}
+
+// Bounds-checked reader over the mapped metadata
+class Cursor {
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+
+public:
+    Cursor(const char* d, size_t s, size_t start) : data(d), size(s), pos(start) {}
+
+    template<typename V>
+    bool read(V& value) {
+        if (pos + sizeof(V) > size) return false;
+        std::memcpy(&value, data + pos, sizeof(V));
+        pos += sizeof(V);
+        return true;
+    }
+
+    bool read_string(std::string& s, size_t length) {
+        if (pos + length > size) return false;
+        s.assign(data + pos, length);
+        pos += length;
+        return true;
+    }
+
+    size_t offset() const { return pos; }
+};
+
+} // namespace
+
+uint64_t fnv1a_checksum(const char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+size_t layer_block_bytes(int inputs, int outputs, ScalarType dtype) {
+    size_t element = static_cast<size_t>(dtype);
+    return align_up(static_cast<size_t>(inputs) * outputs * element) + outputs * element;
+}
+
+bool write_model_file(const std::string& filename, const ModelInfo& info,
+                      const std::vector<const void*>& layer_blocks) {
+    if (info.layer_sizes.size() < 2 || layer_blocks.size() != info.layer_sizes.size() - 1) {
+        std::cerr << "Inconsistent model passed to write_model_file" << std::endl;
+        return false;
+    }
+
+    ModelFileHeader header = {};
+    header.magic = MODEL_FILE_MAGIC;
+    header.version = MODEL_FILE_VERSION;
+    header.dtype = static_cast<uint32_t>(info.dtype);
+    header.activation = static_cast<uint32_t>(info.activation);
+    header.num_layers = static_cast<uint32_t>(info.layer_sizes.size());
+    header.num_classes = static_cast<uint32_t>(info.class_names.size());
+    header.input_size = static_cast<uint32_t>(info.input_size());
+    header.num_ranges = static_cast<uint32_t>(info.activation_ranges.size());
+    header.learning_rate = info.learning_rate;
+
+    std::vector<char> out(sizeof(ModelFileHeader));
+    for (int size : info.layer_sizes) append(out, static_cast<uint32_t>(size));
+    for (const ActivationRange& range : info.activation_ranges) {
+        append(out, range.min);
+        append(out, range.max);
+    }
+    for (const std::string& name : info.class_names) {
+        append(out, static_cast<uint32_t>(name.size()));
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    header.tensor_offset = align_up(out.size());
+    for (size_t i = 0; i < layer_blocks.size(); i++) {
+        out.resize(align_up(out.size()), 0);
+        size_t bytes = layer_block_bytes(info.layer_sizes[i], info.layer_sizes[i + 1], info.dtype);
+        const char* block = static_cast<const char*>(layer_blocks[i]);
+        out.insert(out.end(), block, block + bytes);
+    }
+
+    header.file_size = out.size();
+    std::memcpy(out.data(), &header, sizeof(header));
+    header.checksum = model_checksum(out.data(), out.size());
+    std::memcpy(out.data() + offsetof(ModelFileHeader, checksum), &header.checksum, sizeof(uint64_t));
+
+    if (!write_file_atomically(filename, out.data(), out.size())) {
+        std::cerr << "Could not write model file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool write_file_atomically(const std::string& filename, const char* data, size_t size) {
+    const std::string temp = filename + ".tmp";
+    std::ofstream file(temp, std::ios::binary);
+    file.write(data, size);
+    file.close();
+    if (!file || std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool is_model_file(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    uint32_t magic = 0;
+    file.read((char*)&magic, sizeof(uint32_t));
+    return file && magic == MODEL_FILE_MAGIC;
+}
+
+MappedModelFile::~MappedModelFile() {
+    if (base != nullptr) munmap(base, length);
+}
+
+std::shared_ptr<const MappedModelFile> MappedModelFile::open(const std::string& filename,
+                                                             bool verify_checksum) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open model file: " << filename << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ModelFileHeader)) {
+        ::close(fd);
+        std::cerr << "Model file too small: " << filename << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedModelFile> mapped(new MappedModelFile());
+    mapped->length = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, mapped->length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (base == MAP_FAILED) {
+        std::cerr << "Could not map model file: " << filename << std::endl;
+        return nullptr;
+    }
+    mapped->base = base;
+
+    const char* data = static_cast<const char*>(base);
+    ModelFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != MODEL_FILE_MAGIC) {
+        std::cerr << "Not a model file: " << filename << std::endl;
+        return nullptr;
+    }
+    if (header.version != MODEL_FILE_VERSION) {
+        std::cerr << "Unsupported model file version " << header.version << ": " << filename << std::endl;
+        return nullptr;
+    }
+    if (header.file_size != mapped->length) {
+        std::cerr << "Truncated model file: " << filename << std::endl;
+        return nullptr;
+    }
+    if (verify_checksum && model_checksum(data, mapped->length) != header.checksum) {
+        std::cerr << "Model file checksum mismatch: " << filename << std::endl;
+        return nullptr;
+    }
+
+    ModelInfo& info = mapped->model;
+    info.dtype = static_cast<ScalarType>(header.dtype);
+    info.activation = static_cast<ActivationType>(header.activation);
+    info.learning_rate = header.learning_rate;
+    bool valid = (info.dtype == ScalarType::FLOAT32 || info.dtype == ScalarType::FLOAT64)
+                 && is_activation_type(header.activation) && header.num_layers >= 2;
+
+    Cursor cursor(data, mapped->length, sizeof(ModelFileHeader));
+    for (uint32_t i = 0; valid && i < header.num_layers; i++) {
+        uint32_t size = 0;
+        valid = cursor.read(size) && size > 0 && size <= static_cast<uint32_t>(INT_MAX);
+        info.layer_sizes.push_back(static_cast<int>(size));
+    }
+    valid = valid && header.input_size == info.input_size()
+            && (header.num_ranges == 0 || header.num_ranges == header.num_layers - 1);
+    for (uint32_t i = 0; valid && i < header.num_ranges; i++) {
+        ActivationRange range;
+        valid = cursor.read(range.min) && cursor.read(range.max);
+        range.observed = true;
+        info.activation_ranges.push_back(range);
+    }
+    for (uint32_t i = 0; valid && i < header.num_classes; i++) {
+        uint32_t length = 0;
+        std::string name;
+        valid = cursor.read(length) && cursor.read_string(name, length);
+        info.class_names.push_back(name);
+    }
+    valid = valid && header.tensor_offset == align_up(cursor.offset());
+
+    size_t offset = header.tensor_offset;
+    for (size_t i = 0; valid && i + 1 < info.layer_sizes.size(); i++) {
+        // Bounded by the file before the block size is computed, so huge
+        // sizes cannot overflow it
+        valid = static_cast<size_t>(info.layer_sizes[i]) * info.layer_sizes[i + 1] <=
+                mapped->length / static_cast<size_t>(info.dtype);
+        if (!valid) break;
+        offset = align_up(offset);
+        mapped->block_offsets.push_back(offset);
+        offset += layer_block_bytes(info.layer_sizes[i], info.layer_sizes[i + 1], info.dtype);
+    }
+    if (!valid || offset != mapped->length) {
+        std::cerr << "Corrupt model file: " << filename << std::endl;
+        return nullptr;
+    }
+
+    return mapped;
+}
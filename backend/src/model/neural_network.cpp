@@ -1,293 +1,889 @@
 #include "neural_network.h"
+#include "barrier.h"
+#include "fast_math.h"
+#include "training_helpers.h"
+#include "workspace.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
 
-NeuralNetwork::NeuralNetwork(const std::vector<int>& layer_sizes, double lr,
-                             ActivationType act_type)
+namespace {
+
+// out (n x outputs) = in (n x inputs) * W^T + b on the blocked GEMM
+template<typename T>
+void dense_forward(const DenseLayer<T>& dl, const T* in, T* out, size_t n,
+                   int num_threads = 1) {
+    gemm(Transpose::NO, Transpose::YES, n, dl.outputs, dl.inputs, T(1),
+         in, dl.inputs, dl.weights(), dl.inputs, T(0), out, dl.outputs, num_threads);
+    simd<T>().bias_add(out, dl.biases(), n, dl.outputs);
+}
+
+// Tag in front of the pre-model_file.h models that record their precision.
+// Older files start directly with the size_t layer count and hold doubles.
+constexpr uint32_t MODEL_MAGIC = 0x4D4E4E43;  // "CNNM"
+
+// Optional trailing section with the per-layer activation ranges learned by
+// quantization-aware training: tag, size_t count, then count (min, max) floats
+constexpr uint32_t RANGES_TAG = 0x474E5251;  // "QRNG"
+
+// Read count stored values of type S into dst, converting them to T
+template<typename S, typename T>
+void read_converted(std::ifstream& file, T* dst, size_t count) {
+    if constexpr (std::is_same<S, T>::value) {
+        file.read((char*)dst, count * sizeof(T));
+    } else {
+        std::vector<S> stored(count);
+        file.read((char*)stored.data(), count * sizeof(S));
+        std::copy(stored.begin(), stored.end(), dst);
+    }
+}
+
+// Copy a stored layer block of type S into dl, converting to T. The bias
+// offset depends on the element size, so weights and biases go separately.
+template<typename S, typename T>
+void copy_block(const S* block, DenseLayer<T>& dl) {
+    const S* biases = block + align_elements<S>(dl.weight_count());
+    std::copy(block, block + dl.weight_count(), dl.weights());
+    std::copy(biases, biases + dl.outputs, dl.biases());
+}
+
+// Throughput summary printed after a parallel training run
+void report_throughput(const char* mode, const TrainingStats& stats) {
+    std::cout << mode << ": " << stats.samples << " samples in " << stats.seconds
+              << " s (" << stats.samples_per_second << " samples/sec, "
+              << stats.workspace_peak_bytes / 1024.0 << " KiB workspace per thread)" << std::endl;
+}
+
+} // namespace
+
+template<typename T>
+NeuralNetwork<T>::NeuralNetwork(const std::vector<int>& layer_sizes, double lr,
+                                ActivationType act_type)
     : layers(layer_sizes), learning_rate(lr) {
 
     // Polymorphism - create activation function using factory
-    activation = ActivationFactory::create(act_type);
+    activation = ActivationFactory::create<T>(act_type);
 
     std::random_device rd;
     std::mt19937 gen(rd());
     std::normal_distribution<> d(0, 0.1);
 
     for (size_t i = 0; i < layers.size() - 1; i++) {
-        std::vector<std::vector<double>> layer_weights;
-        std::vector<double> layer_biases;
+        DenseLayer<T> layer(layers[i], layers[i + 1]);
 
-        for (int j = 0; j < layers[i + 1]; j++) {
-            std::vector<double> neuron_weights;
-            for (int k = 0; k < layers[i]; k++) {
-                neuron_weights.push_back(d(gen));
+        // Same draw order as the original per-neuron layout: weights row, then bias
+        for (int j = 0; j < layer.outputs; j++) {
+            T* w = layer.row(j);
+            for (int k = 0; k < layer.inputs; k++) {
+                w[k] = d(gen);
             }
-            layer_weights.push_back(neuron_weights);
-            layer_biases.push_back(d(gen));
+            layer.biases()[j] = d(gen);
         }
 
-        weights.push_back(layer_weights);
-        biases.push_back(layer_biases);
+        dense_layers.push_back(std::move(layer));
     }
+
+    // Size this thread's arena for single-sample training up front
+    thread_workspace().reserve(workspace_bytes(1));
 }
 
 // Destructor - cleanup
-NeuralNetwork::~NeuralNetwork() {
+template<typename T>
+NeuralNetwork<T>::~NeuralNetwork() {
     // Smart pointers (unique_ptr) automatically clean up
     // This destructor is here to demonstrate proper resource management
-    weights.clear();
-    biases.clear();
+    dense_layers.clear();
 }
 
-double NeuralNetwork::sigmoid(double x) {
-    return 1.0 / (1.0 + exp(-x));
+template<typename T>
+std::vector<T> NeuralNetwork<T>::forward(const std::vector<T>& input) const {
+    std::vector<T> probs(dense_layers.back().outputs);
+    forward_into(input.data(), 1, probs.data(), 1);
+    return probs;
 }
 
-double NeuralNetwork::sigmoid_derivative(double x) {
-    return x * (1.0 - x);
+template<typename T>
+std::vector<T> NeuralNetwork<T>::forward_batch(const std::vector<T>& inputs, size_t batch_size) const {
+    if (inputs.size() != batch_size * static_cast<size_t>(layers.front())) {
+        throw std::invalid_argument("Batch input size does not match batch_size x input layer size");
+    }
+    return forward_batch(inputs.data(), batch_size);
 }
 
-std::vector<double> NeuralNetwork::softmax(const std::vector<double>& x) {
-    std::vector<double> result(x.size());
-    double max_val = *std::max_element(x.begin(), x.end());
-    double sum = 0.0;
-    
-    for (size_t i = 0; i < x.size(); i++) {
-        result[i] = exp(x[i] - max_val);
-        sum += result[i];
+template<typename T>
+size_t NeuralNetwork<T>::workspace_bytes(size_t n, bool fake_quant) const {
+    // Per-layer activations, two delta buffers of the widest layer and the
+    // table of activation pointers, plus the fake-quantized layer inputs
+    size_t bytes = Workspace::bytes_for<T*>(dense_layers.size());
+    size_t widest = 0;
+    for (const DenseLayer<T>& dl : dense_layers) {
+        bytes += Workspace::bytes_for<T>(n * dl.outputs);
+        widest = std::max(widest, static_cast<size_t>(std::max(dl.inputs, dl.outputs)));
     }
-    
-    for (size_t i = 0; i < result.size(); i++) {
-        result[i] /= sum;
+    if (fake_quant) {
+        bytes += Workspace::bytes_for<T*>(dense_layers.size());
+        for (const DenseLayer<T>& dl : dense_layers) {
+            bytes += Workspace::bytes_for<T>(n * dl.inputs);
+        }
     }
-    
-    return result;
+    return bytes + 2 * Workspace::bytes_for<T>(n * widest);
 }
 
-std::vector<double> NeuralNetwork::forward(const std::vector<double>& input) {
-    std::vector<double> activation = input;
-    
-    for (size_t layer = 0; layer < weights.size(); layer++) {
-        std::vector<double> new_activation;
-        
-        for (size_t neuron = 0; neuron < weights[layer].size(); neuron++) {
-            double sum = biases[layer][neuron];
-            for (size_t i = 0; i < activation.size(); i++) {
-                sum += activation[i] * weights[layer][neuron][i];
-            }
-            
-            if (layer == weights.size() - 1) {
-                new_activation.push_back(sum);
-            } else {
-                new_activation.push_back(sigmoid(sum));
-            }
+template<typename T>
+void NeuralNetwork<T>::forward_into(const T* inputs, size_t n, T* out, int gemm_threads) const {
+    const ActivationKernels<T> hidden = activation->kernels();
+    Workspace& ws = thread_workspace();
+    ws.reserve(workspace_bytes(n));
+    Workspace::Scope scope(ws);
+
+    const T* current = inputs;
+    for (size_t layer = 0; layer < dense_layers.size(); layer++) {
+        const DenseLayer<T>& dl = dense_layers[layer];
+        bool last = (layer == dense_layers.size() - 1);
+        T* next = last ? out : ws.alloc<T>(n * dl.outputs);
+        dense_forward(dl, current, next, n, gemm_threads);
+
+        if (!last) {
+            hidden.activate(next, n * dl.outputs);
         }
-        
-        activation = new_activation;
+        current = next;
     }
-    
-    return softmax(activation);
+
+    softmax_rows(out, n, dense_layers.back().outputs);
 }
 
-void NeuralNetwork::train(const std::vector<double>& input, const std::vector<double>& target) {
-    std::vector<std::vector<double>> activations;
-    std::vector<std::vector<double>> z_values;
-    
-    activations.push_back(input);
-    
-    std::vector<double> activation = input;
-    for (size_t layer = 0; layer < weights.size(); layer++) {
-        std::vector<double> z;
-        std::vector<double> new_activation;
-        
-        for (size_t neuron = 0; neuron < weights[layer].size(); neuron++) {
-            double sum = biases[layer][neuron];
-            for (size_t i = 0; i < activation.size(); i++) {
-                sum += activation[i] * weights[layer][neuron][i];
-            }
-            z.push_back(sum);
-            
-            if (layer == weights.size() - 1) {
-                new_activation.push_back(sum);
-            } else {
-                new_activation.push_back(sigmoid(sum));
-            }
+template<typename T>
+Matrix<T> NeuralNetwork<T>::forward_rows(const T* inputs, size_t n, int gemm_threads) const {
+    Matrix<T> probs(n, dense_layers.back().outputs);
+    forward_into(inputs, n, probs.data(), gemm_threads);
+    return probs;
+}
+
+template<typename T>
+std::vector<T> NeuralNetwork<T>::forward_batch(const T* inputs, size_t batch_size) const {
+    std::vector<T> probs(batch_size * dense_layers.back().outputs);
+    forward_into(inputs, batch_size, probs.data(), num_threads);
+    return probs;
+}
+
+template<typename T>
+Matrix<T> NeuralNetwork<T>::forward_batch(const Matrix<T>& inputs) const {
+    if (inputs.getCols() != static_cast<size_t>(layers.front())) {
+        throw std::invalid_argument("Batch input width does not match the input layer size");
+    }
+    return forward_rows(inputs.data(), inputs.getRows(), num_threads);
+}
+
+template<typename T>
+std::vector<DenseLayer<T>> NeuralNetwork<T>::make_gradient_buffers() const {
+    std::vector<DenseLayer<T>> grads;
+    for (const DenseLayer<T>& dl : dense_layers) {
+        grads.emplace_back(dl.inputs, dl.outputs);
+    }
+    return grads;
+}
+
+template<typename T>
+StepResult NeuralNetwork<T>::compute_gradients(const T* inputs, const T* targets, size_t n,
+                                               std::vector<DenseLayer<T>>& grads,
+                                               int gemm_threads,
+                                               std::vector<ActivationRange>* fake_quant_ranges) const {
+    const size_t num_layers = dense_layers.size();
+    const size_t classes = dense_layers.back().outputs;
+    const bool fake_quant = (fake_quant_ranges != nullptr);
+    const std::vector<DenseLayer<T>>& params = fake_quant ? fake_quant_layers : dense_layers;
+    const ActivationKernels<T> hidden = activation->kernels();
+
+    // Every buffer of the pass lives in this thread's arena
+    Workspace& ws = thread_workspace();
+    ws.reserve(workspace_bytes(n, fake_quant));
+    Workspace::Scope scope(ws);
+
+    // Forward pass, keeping every layer's activations (n x outputs)
+    T** activations = ws.alloc<T*>(num_layers);
+    T** quantized_inputs = fake_quant ? ws.alloc<T*>(num_layers) : nullptr;
+    size_t widest = 0;
+    const T* current = inputs;
+    for (size_t layer = 0; layer < num_layers; layer++) {
+        const DenseLayer<T>& dl = params[layer];
+        if (fake_quant) {
+            // Learn the input range, then feed the layer its int8-rounded input
+            size_t count = n * dl.inputs;
+            T* quantized = ws.alloc<T>(count);
+            ActivationRange& range = (*fake_quant_ranges)[layer];
+            range.observe(current, count);
+            fake_quantize_activations(current, count, range.params(), quantized);
+            quantized_inputs[layer] = quantized;
+            current = quantized;
         }
-        
-        z_values.push_back(z);
-        if (layer == weights.size() - 1) {
-            new_activation = softmax(new_activation);
+        T* out = ws.alloc<T>(n * dl.outputs);
+        dense_forward(dl, current, out, n, gemm_threads);
+
+        if (layer == num_layers - 1) {
+            softmax_rows(out, n, dl.outputs);
+        } else {
+            hidden.activate(out, n * dl.outputs);
         }
-        activations.push_back(new_activation);
-        activation = new_activation;
+        activations[layer] = out;
+        current = out;
+        widest = std::max(widest, static_cast<size_t>(std::max(dl.inputs, dl.outputs)));
     }
-    
-    std::vector<std::vector<double>> deltas(weights.size());
-    
-    std::vector<double> output_error(target.size());
-    for (size_t i = 0; i < target.size(); i++) {
-        output_error[i] = activations.back()[i] - target[i];
+
+    // Loss and accuracy come for free from the output probabilities
+    StepResult result;
+    const T* probs = activations[num_layers - 1];
+    for (size_t r = 0; r < n; r++) {
+        const T* p = probs + r * classes;
+        const T* y = targets + r * classes;
+        for (size_t j = 0; j < classes; j++) {
+            result.loss += -y[j] * log(p[j] + 1e-10);
+        }
+        if (std::max_element(p, p + classes) - p == std::max_element(y, y + classes) - y) {
+            result.correct++;
+        }
     }
-    deltas[deltas.size() - 1] = output_error;
-    
-    for (int layer = weights.size() - 2; layer >= 0; layer--) {
-        std::vector<double> error(weights[layer].size(), 0.0);
-        
-        for (size_t i = 0; i < weights[layer].size(); i++) {
-            for (size_t j = 0; j < weights[layer + 1].size(); j++) {
-                error[i] += deltas[layer + 1][j] * weights[layer + 1][j][i];
-            }
-            error[i] *= sigmoid_derivative(activations[layer + 1][i]);
+
+    // Softmax + cross-entropy output delta; delta and prev ping-pong between
+    // two buffers sized for the widest layer
+    T* delta = ws.alloc<T>(n * widest);
+    T* prev = ws.alloc<T>(n * widest);
+    for (size_t i = 0; i < n * classes; i++) {
+        delta[i] = probs[i] - targets[i];
+    }
+
+    for (size_t layer = num_layers; layer-- > 0;) {
+        const DenseLayer<T>& dl = params[layer];
+        const T* layer_input = fake_quant ? quantized_inputs[layer]
+                             : (layer == 0) ? inputs : activations[layer - 1];
+
+        // dW += delta^T (outputs x n) * input (n x inputs), one GEMM per batch
+        gemm(Transpose::YES, Transpose::NO, dl.outputs, dl.inputs, n, T(1),
+             delta, dl.outputs, layer_input, dl.inputs, T(1),
+             grads[layer].weights(), dl.inputs, gemm_threads);
+        for (size_t r = 0; r < n; r++) {
+            simd<T>().axpy(T(1), delta + r * dl.outputs, grads[layer].biases(), dl.outputs);
+        }
+
+        if (layer == 0) break;
+
+        // Previous delta (n x inputs) = delta * W, read from the column-major
+        // copy when one is kept, then scaled by the activation derivative
+        if (dl.has_column_major()) {
+            gemm(Transpose::NO, Transpose::YES, n, dl.inputs, dl.outputs, T(1),
+                 delta, dl.outputs, dl.weights_cm.data(), dl.outputs,
+                 T(0), prev, dl.inputs, gemm_threads);
+        } else {
+            gemm(Transpose::NO, Transpose::NO, n, dl.inputs, dl.outputs, T(1),
+                 delta, dl.outputs, dl.weights(), dl.inputs,
+                 T(0), prev, dl.inputs, gemm_threads);
         }
-        deltas[layer] = error;
+        // Straight-through: the derivative is taken at the unrounded activation
+        hidden.derivative(activations[layer - 1], prev, n * dl.inputs);
+        std::swap(delta, prev);
     }
-    
-    for (size_t layer = 0; layer < weights.size(); layer++) {
-        for (size_t neuron = 0; neuron < weights[layer].size(); neuron++) {
-            for (size_t w = 0; w < weights[layer][neuron].size(); w++) {
-                weights[layer][neuron][w] -= learning_rate * deltas[layer][neuron] * activations[layer][w];
-            }
-            biases[layer][neuron] -= learning_rate * deltas[layer][neuron];
+    return result;
+}
+
+template<typename T>
+void NeuralNetwork<T>::apply_gradients(const std::vector<DenseLayer<T>>& grads, T scale) {
+    for (size_t layer = 0; layer < dense_layers.size(); layer++) {
+        DenseLayer<T>& dl = dense_layers[layer];
+        // Weights and biases share one block, so a single axpy updates both
+        simd<T>().axpy(static_cast<T>(-learning_rate * scale), grads[layer].params.data(),
+                       dl.params.data(), dl.params.size());
+        if (dl.has_column_major()) {
+            dl.sync_column_major();
+        }
+    }
+}
+
+template<typename T>
+StepResult NeuralNetwork<T>::train_step(const T* inputs, const T* targets, size_t batch_size) {
+    if (batch_size == 0) return StepResult();
+    detach_mapping();
+    if (gradients.size() != dense_layers.size()) {
+        gradients = make_gradient_buffers();
+    }
+    for (DenseLayer<T>& g : gradients) {
+        std::fill(g.params.begin(), g.params.end(), T(0));
+    }
+
+    if (!quantization_aware) {
+        StepResult result = compute_gradients(inputs, targets, batch_size, gradients, num_threads);
+        apply_gradients(gradients, T(1) / batch_size);
+        return result;
+    }
+
+    // The gradient taken through the fake-quantized weights updates the
+    // full-precision weights, which are re-rounded before the next step
+    if (activation_ranges.size() != dense_layers.size()) {
+        activation_ranges.assign(dense_layers.size(), ActivationRange());
+    }
+    refresh_fake_quant_layers();
+    StepResult result = compute_gradients(inputs, targets, batch_size, gradients, num_threads,
+                                          &activation_ranges);
+    apply_gradients(gradients, T(1) / batch_size);
+    return result;
+}
+
+template<typename T>
+void NeuralNetwork<T>::refresh_fake_quant_layers() {
+    if (fake_quant_layers.size() != dense_layers.size()) {
+        fake_quant_layers = make_gradient_buffers();
+    }
+    for (size_t layer = 0; layer < dense_layers.size(); layer++) {
+        const DenseLayer<T>& dl = dense_layers[layer];
+        DenseLayer<T>& fq = fake_quant_layers[layer];
+        for (int j = 0; j < dl.outputs; j++) {
+            fake_quantize_weights(dl.row(j), dl.inputs, fq.row(j));
         }
+        std::copy(dl.biases(), dl.biases() + dl.outputs, fq.biases());
     }
 }
 
-void NeuralNetwork::train_batch(const std::vector<std::vector<double>>& inputs, 
-                                 const std::vector<std::vector<double>>& targets, 
-                                 int epochs) {
+template<typename T>
+void NeuralNetwork<T>::set_quantization_aware(bool enabled) {
+    quantization_aware = enabled;
+    if (!enabled) {
+        fake_quant_layers.clear();
+    }
+}
+
+template<typename T>
+double NeuralNetwork<T>::train(const std::vector<T>& input, const std::vector<T>& target) {
+    return train_step(input.data(), target.data(), 1).loss;
+}
+
+template<typename T>
+void NeuralNetwork<T>::train_batch(const std::vector<std::vector<T>>& inputs, 
+                                    const std::vector<std::vector<T>>& targets, 
+                                    int epochs, int batch_size) {
+    const size_t batch = std::max(1, batch_size);
+
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::vector<T> x_batch;
+    std::vector<T> y_batch;
+
     for (int epoch = 0; epoch < epochs; epoch++) {
-        double total_loss = 0.0;
+        StepResult epoch_result;
+        std::shuffle(order.begin(), order.end(), gen);
         
-        for (size_t i = 0; i < inputs.size(); i++) {
-            train(inputs[i], targets[i]);
-            
-            auto output = forward(inputs[i]);
-            for (size_t j = 0; j < output.size(); j++) {
-                total_loss += -targets[i][j] * log(output[j] + 1e-10);
-            }
+        for (size_t start = 0; start < inputs.size(); start += batch) {
+            size_t count = std::min(batch, inputs.size() - start);
+            gather_rows(inputs, order, start, count, x_batch);
+            gather_rows(targets, order, start, count, y_batch);
+
+            epoch_result += train_step(x_batch.data(), y_batch.data(), count);
         }
         
         if ((epoch + 1) % 10 == 0) {
-            std::cout << "Epoch " << epoch + 1 << "/" << epochs 
-                      << " - Loss: " << total_loss / inputs.size() << std::endl;
+            report_epoch(epoch + 1, epochs, epoch_result.loss, epoch_result.correct, inputs.size());
         }
     }
 }
 
-void NeuralNetwork::save(const std::string& filename) {
-    std::ofstream file(filename, std::ios::binary);
-    
-    size_t num_layers = layers.size();
-    file.write((char*)&num_layers, sizeof(size_t));
-    file.write((char*)layers.data(), layers.size() * sizeof(int));
-    file.write((char*)&learning_rate, sizeof(double));
-    
-    for (size_t i = 0; i < weights.size(); i++) {
-        for (size_t j = 0; j < weights[i].size(); j++) {
-            file.write((char*)weights[i][j].data(), weights[i][j].size() * sizeof(double));
+template<typename T>
+void NeuralNetwork<T>::save(const std::string& filename) {
+    ModelInfo info;
+    info.dtype = scalar_type;
+    info.activation = activation->getType();
+    info.layer_sizes = layers;
+    info.class_names = class_names;
+    info.activation_ranges = activation_ranges;
+    info.learning_rate = learning_rate;
+
+    // Every layer block is already laid out as the file stores it
+    std::vector<const void*> blocks;
+    for (const DenseLayer<T>& dl : dense_layers) {
+        blocks.push_back(dl.data());
+    }
+
+    if (write_model_file(filename, info, blocks)) {
+        std::cout << "Model saved to " << filename << std::endl;
+    }
+}
+
+template<typename T>
+void NeuralNetwork<T>::adopt_model_file(std::shared_ptr<const MappedModelFile> file,
+                                        bool keep_mapping) {
+    const ModelInfo& info = file->info();
+    layers = info.layer_sizes;
+    learning_rate = info.learning_rate;
+    class_names = info.class_names;
+    activation_ranges = info.activation_ranges;
+    if (!activation || activation->getType() != info.activation) {
+        activation = ActivationFactory::create<T>(info.activation);
+    }
+
+    keep_mapping = keep_mapping && info.dtype == scalar_type;
+    dense_layers.clear();
+    gradients.clear();
+    fake_quant_layers.clear();
+
+    for (size_t i = 0; i < layers.size() - 1; i++) {
+        if (keep_mapping) {
+            const T* block = static_cast<const T*>(file->layer_block(i));
+            dense_layers.push_back(DenseLayer<T>::view(layers[i], layers[i + 1], block));
+            continue;
+        }
+
+        DenseLayer<T> dl(layers[i], layers[i + 1]);
+        if (info.dtype == ScalarType::FLOAT32) {
+            copy_block(static_cast<const float*>(file->layer_block(i)), dl);
+        } else {
+            copy_block(static_cast<const double*>(file->layer_block(i)), dl);
         }
-        file.write((char*)biases[i].data(), biases[i].size() * sizeof(double));
+        if (keep_column_major) {
+            dl.sync_column_major();
+        }
+        dense_layers.push_back(std::move(dl));
+    }
+
+    if (keep_mapping) {
+        mapping = std::move(file);
+        if (keep_column_major) {
+            for (DenseLayer<T>& dl : dense_layers) dl.sync_column_major();
+        }
+    } else {
+        mapping.reset();
     }
-    
-    file.close();
-    std::cout << "Model saved to " << filename << std::endl;
 }
 
-void NeuralNetwork::load(const std::string& filename) {
+template<typename T>
+bool NeuralNetwork<T>::load(const std::string& filename) {
+    if (!is_model_file(filename)) {
+        return load_legacy(filename);
+    }
+
+    // Every byte is copied out anyway, so the checksum costs little here
+    std::shared_ptr<const MappedModelFile> file = MappedModelFile::open(filename, true);
+    if (!file) return false;
+    ScalarType stored = file->info().dtype;
+    adopt_model_file(file, false);
+    thread_workspace().reserve(workspace_bytes(1));
+
+    std::cout << "Model loaded from " << filename;
+    if (stored != scalar_type) {
+        std::cout << " (" << scalar_type_name(stored) << " converted to "
+                  << scalar_type_name(scalar_type) << ")";
+    }
+    if (!activation_ranges.empty()) {
+        std::cout << " with learned activation ranges";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+// Formats written before the self-describing file: an optional precision
+// header, the layer table and packed parameters, then (since
+// quantization-aware training) the tagged activation ranges
+template<typename T>
+bool NeuralNetwork<T>::load_legacy(const std::string& filename) {
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Could not open model file: " << filename << std::endl;
-        return;
+        return false;
     }
     
-    size_t num_layers;
-    file.read((char*)&num_layers, sizeof(size_t));
-    layers.resize(num_layers);
-    file.read((char*)layers.data(), layers.size() * sizeof(int));
-    file.read((char*)&learning_rate, sizeof(double));
+    // Files without the precision header are legacy double models
+    ScalarType stored = ScalarType::FLOAT64;
+    uint32_t magic = 0;
+    file.read((char*)&magic, sizeof(uint32_t));
+    if (magic == MODEL_MAGIC) {
+        uint32_t precision = 0;
+        file.read((char*)&precision, sizeof(uint32_t));
+        stored = static_cast<ScalarType>(precision);
+        if (stored != ScalarType::FLOAT32 && stored != ScalarType::FLOAT64) {
+            std::cerr << "Unsupported model precision in " << filename << std::endl;
+            return false;
+        }
+    } else {
+        file.seekg(0);
+    }
     
-    weights.clear();
-    biases.clear();
+    // Sizes come from the file, so bound every layer by what is left of it
+    // before allocating, and replace the network only once all of it read
+    const std::streamoff header_end = file.tellg();
+    file.seekg(0, std::ios::end);
+    size_t remaining = static_cast<size_t>(std::max<std::streamoff>(0, file.tellg() - header_end));
+    file.seekg(header_end);
+
+    size_t num_layers = 0;
+    file.read((char*)&num_layers, sizeof(size_t));
+    if (!file || num_layers < 2 || num_layers > 1024) {
+        std::cerr << "Not a model file: " << filename << std::endl;
+        return false;
+    }
+    std::vector<int> sizes(num_layers);
+    double lr = 0.01;
+    file.read((char*)sizes.data(), sizes.size() * sizeof(int));
+    file.read((char*)&lr, sizeof(double));
+    bool valid = static_cast<bool>(file);
+    if (valid) remaining -= sizeof(size_t) + sizes.size() * sizeof(int) + sizeof(double);
+    for (int size : sizes) valid = valid && size > 0;
+
+    const size_t element = static_cast<size_t>(stored);
+    std::vector<DenseLayer<T>> loaded;
+    for (size_t i = 0; valid && i + 1 < sizes.size(); i++) {
+        size_t count = static_cast<size_t>(sizes[i]) * sizes[i + 1] + sizes[i + 1];
+        if (count > remaining / element) {
+            valid = false;
+            break;
+        }
+        remaining -= count * element;
+
+        DenseLayer<T> dl(sizes[i], sizes[i + 1]);
+        if (stored == ScalarType::FLOAT32) {
+            read_converted<float>(file, dl.weights(), dl.weight_count());
+            read_converted<float>(file, dl.biases(), dl.outputs);
+        } else {
+            read_converted<double>(file, dl.weights(), dl.weight_count());
+            read_converted<double>(file, dl.biases(), dl.outputs);
+        }
+        if (!file) {
+            valid = false;
+            break;
+        }
+        if (keep_column_major) {
+            dl.sync_column_major();
+        }
+        loaded.push_back(std::move(dl));
+    }
+    if (!valid) {
+        std::cerr << "Corrupt or truncated model file: " << filename << std::endl;
+        return false;
+    }
     
-    for (size_t i = 0; i < layers.size() - 1; i++) {
-        std::vector<std::vector<double>> layer_weights;
-        std::vector<double> layer_biases(layers[i + 1]);
-        
-        for (int j = 0; j < layers[i + 1]; j++) {
-            std::vector<double> neuron_weights(layers[i]);
-            file.read((char*)neuron_weights.data(), neuron_weights.size() * sizeof(double));
-            layer_weights.push_back(neuron_weights);
+    // Files written before quantization-aware training end here
+    std::vector<ActivationRange> ranges;
+    uint32_t tag = 0;
+    size_t count = 0;
+    if (file.read((char*)&tag, sizeof(uint32_t)) && tag == RANGES_TAG &&
+        file.read((char*)&count, sizeof(size_t)) && count == loaded.size()) {
+        ranges.resize(count);
+        for (ActivationRange& range : ranges) {
+            file.read((char*)&range.min, sizeof(float));
+            file.read((char*)&range.max, sizeof(float));
+            range.observed = true;
         }
-        file.read((char*)layer_biases.data(), layer_biases.size() * sizeof(double));
-        
-        weights.push_back(layer_weights);
-        biases.push_back(layer_biases);
+        if (!file) ranges.clear();
     }
+
+    layers = std::move(sizes);
+    learning_rate = lr;
+    if (!activation) {
+        activation = ActivationFactory::create<T>(ActivationType::SIGMOID);
+    }
+    mapping.reset();
+    dense_layers = std::move(loaded);
+    gradients.clear();
+    activation_ranges = std::move(ranges);
+    fake_quant_layers.clear();
+    thread_workspace().reserve(workspace_bytes(1));
     
     file.close();
-    std::cout << "Model loaded from " << filename << std::endl;
+    std::cout << "Model loaded from " << filename << " (legacy format";
+    if (stored != scalar_type) {
+        std::cout << ", " << scalar_type_name(stored) << " converted to "
+                  << scalar_type_name(scalar_type);
+    }
+    std::cout << ")" << std::endl;
+    return true;
+}
+
+template<typename T>
+std::unique_ptr<NeuralNetwork<T>> NeuralNetwork<T>::from_file(const std::string& filename,
+                                                              bool memory_map) {
+    std::unique_ptr<NeuralNetwork<T>> nn(new NeuralNetwork<T>());
+    if (!memory_map || !is_model_file(filename)) {
+        if (!nn->load(filename)) return nullptr;
+        return nn;
+    }
+
+    std::shared_ptr<const MappedModelFile> file = MappedModelFile::open(filename);
+    if (!file) return nullptr;
+    size_t bytes = file->size_bytes();
+    nn->adopt_model_file(file, true);
+    thread_workspace().reserve(nn->workspace_bytes(1));
+
+    std::cout << "Model " << (nn->is_memory_mapped() ? "mapped" : "loaded") << " from "
+              << filename << " (" << bytes / 1024.0 << " KiB)" << std::endl;
+    return nn;
+}
+
+template<typename T>
+void NeuralNetwork<T>::detach_mapping() {
+    if (!mapping) return;
+    for (DenseLayer<T>& dl : dense_layers) {
+        dl.materialize();
+    }
+    mapping.reset();
 }
 
-int NeuralNetwork::predict_class(const std::vector<double>& input) {
+template<typename T>
+int NeuralNetwork<T>::predict_class(const std::vector<T>& input) const {
     auto output = forward(input);
     return std::max_element(output.begin(), output.end()) - output.begin();
 }
 
-ActivationType NeuralNetwork::getActivationType() const {
+template<typename T>
+size_t NeuralNetwork<T>::workspace_peak_bytes() const {
+    return thread_workspace().peak_bytes();
+}
+
+template<typename T>
+ActivationType NeuralNetwork<T>::getActivationType() const {
     return activation->getType();
 }
 
+template<typename T>
+void NeuralNetwork<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+}
+
+template<typename T>
+void NeuralNetwork<T>::set_column_major_copy(bool enabled) {
+    keep_column_major = enabled;
+    for (DenseLayer<T>& dl : dense_layers) {
+        if (enabled) {
+            dl.sync_column_major();
+        } else {
+            dl.drop_column_major();
+        }
+    }
+}
+
 // Parallel training implementation using std::thread
-void NeuralNetwork::train_batch_parallel(const std::vector<std::vector<double>>& inputs,
-                                        const std::vector<std::vector<double>>& targets,
-                                        int epochs, int num_threads) {
-    for (int epoch = 0; epoch < epochs; epoch++) {
-        double total_loss = 0.0;
-        std::vector<std::thread> threads;
-        std::vector<double> thread_losses(num_threads, 0.0);
+template<typename T>
+TrainingStats NeuralNetwork<T>::train_batch_parallel(const std::vector<std::vector<T>>& inputs,
+                                                    const std::vector<std::vector<T>>& targets,
+                                                    int epochs, int num_threads, int batch_size) {
+    const size_t workers = std::max(1, num_threads);
+    const size_t batch = std::max<size_t>(workers, std::max(1, batch_size));
+    detach_mapping();
 
-        // Divide work among threads
-        size_t batch_per_thread = inputs.size() / num_threads;
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    // One private gradient buffer per worker; worker 0's receives the total
+    std::vector<std::vector<DenseLayer<T>>> thread_grads(workers);
+    for (auto& grads : thread_grads) {
+        grads = make_gradient_buffers();
+    }
+    std::vector<StepResult> thread_results(workers);
+    std::vector<size_t> thread_peaks(workers, 0);
+    Barrier barrier(workers);
+    auto start_time = std::chrono::steady_clock::now();
+
+    auto worker = [&](size_t t) {
+        std::vector<T> x_slice;
+        std::vector<T> y_slice;
+        std::vector<DenseLayer<T>>& grads = thread_grads[t];
 
-        for (int t = 0; t < num_threads; t++) {
-            size_t start_idx = t * batch_per_thread;
-            size_t end_idx = (t == num_threads - 1) ? inputs.size() : (t + 1) * batch_per_thread;
+        for (int epoch = 0; epoch < epochs; epoch++) {
+            if (t == 0) {
+                std::shuffle(order.begin(), order.end(), gen);
+            }
+            barrier.arrive_and_wait();
+            StepResult local_result;
 
-            threads.emplace_back([this, &inputs, &targets, &thread_losses, t, start_idx, end_idx]() {
-                double local_loss = 0.0;
+            for (size_t start = 0; start < inputs.size(); start += batch) {
+                // This worker's contiguous slice of the batch
+                size_t count = std::min(batch, inputs.size() - start);
+                size_t lo = start + count * t / workers;
+                size_t hi = start + count * (t + 1) / workers;
 
-                for (size_t i = start_idx; i < end_idx; i++) {
-                    // Lock for thread-safe training
-                    {
-                        std::lock_guard<std::mutex> lock(training_mutex);
-                        train(inputs[i], targets[i]);
+                for (DenseLayer<T>& g : grads) {
+                    std::fill(g.params.begin(), g.params.end(), T(0));
+                }
+                if (hi > lo) {
+                    gather_rows(inputs, order, lo, hi - lo, x_slice);
+                    gather_rows(targets, order, lo, hi - lo, y_slice);
+                    local_result += compute_gradients(x_slice.data(), y_slice.data(), hi - lo, grads, 1);
+                }
+                barrier.arrive_and_wait();
+
+                // Tree reduction: log2(workers) rounds of pairwise sums
+                for (size_t stride = 1; stride < workers; stride *= 2) {
+                    if (t % (2 * stride) == 0 && t + stride < workers) {
+                        const std::vector<DenseLayer<T>>& other = thread_grads[t + stride];
+                        for (size_t layer = 0; layer < grads.size(); layer++) {
+                            simd<T>().axpy(T(1), other[layer].params.data(), grads[layer].params.data(),
+                                           grads[layer].params.size());
+                        }
                     }
+                    barrier.arrive_and_wait();
+                }
+
+                // Every worker applies the summed update to its share of each layer
+                const std::vector<DenseLayer<T>>& total = thread_grads[0];
+                for (size_t layer = 0; layer < dense_layers.size(); layer++) {
+                    AlignedVector<T>& params = dense_layers[layer].params;
+                    size_t begin = params.size() * t / workers;
+                    size_t end = params.size() * (t + 1) / workers;
+                    simd<T>().axpy(static_cast<T>(-learning_rate / count),
+                                   total[layer].params.data() + begin,
+                                   params.data() + begin, end - begin);
+                }
+                barrier.arrive_and_wait();
 
-                    // Calculate loss without lock
-                    auto output = forward(inputs[i]);
-                    for (size_t j = 0; j < output.size(); j++) {
-                        local_loss += -targets[i][j] * log(output[j] + 1e-10);
+                if (keep_column_major) {
+                    if (t == 0) {
+                        for (DenseLayer<T>& dl : dense_layers) {
+                            dl.sync_column_major();
+                        }
                     }
+                    barrier.arrive_and_wait();
                 }
+            }
+            thread_results[t] = local_result;
+            barrier.arrive_and_wait();
 
-                thread_losses[t] = local_loss;
-            });
+            if (t == 0 && (epoch + 1) % 10 == 0) {
+                StepResult epoch_result;
+                for (const StepResult& r : thread_results) {
+                    epoch_result += r;
+                }
+                report_epoch(epoch + 1, epochs, epoch_result.loss, epoch_result.correct, inputs.size());
+            }
         }
+        thread_peaks[t] = thread_workspace().peak_bytes();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+
+    // Wait for all threads to complete
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    TrainingStats stats;
+    stats.samples = inputs.size() * std::max(0, epochs);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    stats.samples_per_second = stats.seconds > 0.0 ? stats.samples / stats.seconds : 0.0;
+    StepResult last_epoch;
+    for (const StepResult& r : thread_results) {
+        last_epoch += r;
+    }
+    stats.final_loss = last_epoch.loss / std::max<size_t>(1, inputs.size());
+    stats.final_accuracy = static_cast<double>(last_epoch.correct) / std::max<size_t>(1, inputs.size());
+    stats.workspace_peak_bytes = *std::max_element(thread_peaks.begin(), thread_peaks.end());
+    report_throughput("Synchronous data-parallel training", stats);
+    return stats;
+}
+
+template<typename T>
+TrainingStats NeuralNetwork<T>::train_hogwild(const std::vector<std::vector<T>>& inputs,
+                                              const std::vector<std::vector<T>>& targets,
+                                              int epochs, int num_threads, int batch_size) {
+    const size_t workers = std::max(1, num_threads);
+    const size_t batch = std::max(1, batch_size);
+    const size_t num_epochs = std::max(0, epochs);
+    detach_mapping();
+
+    // A column-major copy could not be kept consistent without locking, so
+    // backprop reads the row-major weights and the copy is rebuilt afterwards
+    for (DenseLayer<T>& dl : dense_layers) {
+        dl.drop_column_major();
+    }
 
-        // Wait for all threads to complete
-        for (auto& thread : threads) {
-            thread.join();
+    // Loss per (epoch, worker), summed once all workers are done
+    std::vector<StepResult> epoch_results(num_epochs * workers);
+    std::vector<size_t> thread_peaks(workers, 0);
+    std::random_device rd;
+    std::vector<unsigned> seeds(workers);
+    for (unsigned& seed : seeds) {
+        seed = rd();
+    }
+    auto start_time = std::chrono::steady_clock::now();
+
+    auto worker = [&](size_t t) {
+        // This worker's shard, reshuffled every epoch from its own generator
+        std::vector<size_t> shard;
+        for (size_t i = t; i < inputs.size(); i += workers) {
+            shard.push_back(i);
         }
+        std::mt19937 gen(seeds[t]);
+        std::vector<DenseLayer<T>> grads = make_gradient_buffers();
+        std::vector<T> x_batch;
+        std::vector<T> y_batch;
 
-        // Aggregate losses
-        for (double loss : thread_losses) {
-            total_loss += loss;
+        for (size_t epoch = 0; epoch < num_epochs; epoch++) {
+            std::shuffle(shard.begin(), shard.end(), gen);
+            StepResult local_result;
+
+            for (size_t start = 0; start < shard.size(); start += batch) {
+                size_t count = std::min(batch, shard.size() - start);
+                gather_rows(inputs, shard, start, count, x_batch);
+                gather_rows(targets, shard, start, count, y_batch);
+
+                for (DenseLayer<T>& g : grads) {
+                    std::fill(g.params.begin(), g.params.end(), T(0));
+                }
+                local_result += compute_gradients(x_batch.data(), y_batch.data(), count, grads, 1);
+
+                // Lock-free update of the shared parameter blocks
+                for (size_t layer = 0; layer < dense_layers.size(); layer++) {
+                    AlignedVector<T>& params = dense_layers[layer].params;
+                    simd<T>().axpy(static_cast<T>(-learning_rate / count),
+                                   grads[layer].params.data(), params.data(), params.size());
+                }
+            }
+            epoch_results[epoch * workers + t] = local_result;
         }
+        thread_peaks[t] = thread_workspace().peak_bytes();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
 
+    TrainingStats stats;
+    stats.samples = inputs.size() * num_epochs;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    stats.samples_per_second = stats.seconds > 0.0 ? stats.samples / stats.seconds : 0.0;
+    stats.workspace_peak_bytes = *std::max_element(thread_peaks.begin(), thread_peaks.end());
+
+    for (size_t epoch = 0; epoch < num_epochs; epoch++) {
+        StepResult epoch_result;
+        for (size_t t = 0; t < workers; t++) {
+            epoch_result += epoch_results[epoch * workers + t];
+        }
         if ((epoch + 1) % 10 == 0) {
-            std::cout << "Epoch " << epoch + 1 << "/" << epochs
-                      << " - Loss: " << total_loss / inputs.size() << std::endl;
+            report_epoch(epoch + 1, epochs, epoch_result.loss, epoch_result.correct, inputs.size());
+        }
+        stats.final_loss = epoch_result.loss / std::max<size_t>(1, inputs.size());
+        stats.final_accuracy = static_cast<double>(epoch_result.correct) / std::max<size_t>(1, inputs.size());
+    }
+
+    if (keep_column_major) {
+        for (DenseLayer<T>& dl : dense_layers) {
+            dl.sync_column_major();
         }
     }
+    report_throughput("Hogwild asynchronous training", stats);
+    return stats;
 }
+
+template class NeuralNetwork<float>;
+template class NeuralNetwork<double>;
@@ -0,0 +1,365 @@
+#include "quantized_network.h"
+#include "quantization.h"
+#include "fast_math.h"
+#include "gemm.h"
+#include "workspace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t QUANTIZED_MAGIC = 0x514E4E43;  // "CNNQ"
+
+void set_input_params(const QuantParams& p, QuantizedLayer& ql) {
+    ql.input_scale = p.scale;
+    ql.input_zero_point = p.zero_point;
+}
+
+// Symmetric per-output-channel weight quantization of one float layer
+void quantize_weights(const DenseLayer<float>& dl, QuantizedLayer& ql) {
+    ql.inputs = dl.inputs;
+    ql.outputs = dl.outputs;
+    ql.weights.assign(dl.weight_count(), 0);
+    ql.weight_scales.assign(dl.outputs, 1.0f);
+    ql.row_sums.assign(dl.outputs, 0);
+    ql.biases.assign(dl.biases(), dl.biases() + dl.outputs);
+
+    for (int o = 0; o < dl.outputs; o++) {
+        const float* w = dl.row(o);
+        float scale = weight_scale(w, dl.inputs);
+        ql.weight_scales[o] = scale;
+
+        int8_t* q = ql.weights.data() + static_cast<size_t>(o) * dl.inputs;
+        int32_t sum = 0;
+        for (int i = 0; i < dl.inputs; i++) {
+            q[i] = quantize_weight(w[i], scale);
+            sum += q[i];
+        }
+        ql.row_sums[o] = sum;
+    }
+}
+
+size_t widest_layer(const std::vector<QuantizedLayer>& layers) {
+    size_t widest = 0;
+    for (const QuantizedLayer& ql : layers) {
+        widest = std::max(widest, static_cast<size_t>(std::max(ql.inputs, ql.outputs)));
+    }
+    return widest;
+}
+
+void compute_row_sums(QuantizedLayer& ql) {
+    ql.row_sums.assign(ql.outputs, 0);
+    for (int o = 0; o < ql.outputs; o++) {
+        const int8_t* q = ql.weights.data() + static_cast<size_t>(o) * ql.inputs;
+        for (int i = 0; i < ql.inputs; i++) ql.row_sums[o] += q[i];
+    }
+}
+
+void quantize_input(const float* x, size_t n, const QuantizedLayer& ql, uint8_t* q) {
+    const float inv_scale = 1.0f / ql.input_scale;
+    for (size_t i = 0; i < n; i++) {
+        q[i] = static_cast<uint8_t>(quantize_activation(x[i], inv_scale, ql.input_zero_point));
+    }
+}
+
+template<typename T>
+void write_value(std::ostream& file, const T& value) {
+    file.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+void read_value(std::ifstream& file, T& value) {
+    file.read((char*)&value, sizeof(T));
+}
+
+} // namespace
+
+QuantizedNetwork QuantizedNetwork::quantize(const NeuralNetwork<float>& net,
+                                            const std::vector<std::vector<float>>& calibration) {
+    const std::vector<DenseLayer<float>>& dense = net.get_layers();
+    QuantizedNetwork qnet;
+    qnet.set_activation(net.getActivationType());
+    qnet.layers.resize(dense.size());
+    for (size_t l = 0; l < dense.size(); l++) {
+        quantize_weights(dense[l], qnet.layers[l]);
+    }
+
+    // Ranges learned by quantization-aware training replace calibration
+    const std::vector<ActivationRange>& learned = net.get_activation_ranges();
+    if (learned.size() == dense.size()) {
+        for (size_t l = 0; l < dense.size(); l++) {
+            set_input_params(learned[l].params(), qnet.layers[l]);
+        }
+        return qnet;
+    }
+
+    // Run the float network over the calibration set layer by layer and
+    // record the range of every layer's input
+    size_t n = calibration.size();
+    std::vector<float> current;
+    for (const std::vector<float>& sample : calibration) {
+        current.insert(current.end(), sample.begin(), sample.end());
+    }
+
+    std::vector<float> next;
+    for (size_t l = 0; l < dense.size(); l++) {
+        const DenseLayer<float>& dl = dense[l];
+        if (current.empty()) {
+            // Without calibration data assume inputs in [0, 1]
+            set_input_params(activation_quant_params(0.0f, 1.0f), qnet.layers[l]);
+        } else {
+            auto range = std::minmax_element(current.begin(), current.end());
+            set_input_params(activation_quant_params(*range.first, *range.second), qnet.layers[l]);
+        }
+        if (l + 1 == dense.size() || n == 0) continue;
+
+        next.assign(n * dl.outputs, 0.0f);
+        gemm(Transpose::NO, Transpose::YES, n, dl.outputs, dl.inputs, 1.0f,
+             current.data(), dl.inputs, dl.weights(), dl.inputs, 0.0f, next.data(), dl.outputs);
+        simd<float>().bias_add(next.data(), dl.biases(), n, dl.outputs);
+        qnet.hidden.activate(next.data(), next.size());
+        current.swap(next);
+    }
+
+    return qnet;
+}
+
+void QuantizedNetwork::set_activation(ActivationType type) {
+    activation = type;
+    hidden = ActivationFactory::create<float>(type)->kernels();
+}
+
+size_t QuantizedNetwork::workspace_bytes() const {
+    size_t widest = widest_layer(layers);
+    return Workspace::bytes_for<uint8_t>(widest) + Workspace::bytes_for<int32_t>(widest)
+           + 2 * Workspace::bytes_for<float>(widest);
+}
+
+void QuantizedNetwork::forward_into(const float* inputs, size_t n, float* out) const {
+    const Int8Kernels& kernels = int8_kernels();
+    Workspace& ws = thread_workspace();
+    ws.reserve(workspace_bytes());
+    Workspace::Scope scope(ws);
+
+    size_t widest = widest_layer(layers);
+    uint8_t* q = ws.alloc<uint8_t>(widest);
+    int32_t* acc = ws.alloc<int32_t>(widest);
+    float* buffers[2] = {ws.alloc<float>(widest), ws.alloc<float>(widest)};
+
+    // One row at a time: every layer's int8 weights stay cache resident, so
+    // the GEMV re-reads them from L2 rather than memory
+    size_t in_size = input_size();
+    size_t out_size = output_size();
+    for (size_t r = 0; r < n; r++) {
+        const float* current = inputs + r * in_size;
+        for (size_t l = 0; l < layers.size(); l++) {
+            const QuantizedLayer& ql = layers[l];
+            bool last = (l + 1 == layers.size());
+            float* next = last ? out + r * out_size : buffers[l % 2];
+
+            quantize_input(current, ql.inputs, ql, q);
+            kernels.gemv(ql.weights.data(), ql.inputs, q, acc, ql.outputs, ql.inputs);
+
+            // sum(w * x) = in_scale * w_scale * (acc - zero_point * sum(q_w))
+            for (int o = 0; o < ql.outputs; o++) {
+                int32_t centered = acc[o] - ql.input_zero_point * ql.row_sums[o];
+                next[o] = ql.input_scale * ql.weight_scales[o] * centered + ql.biases[o];
+            }
+
+            if (!last) {
+                hidden.activate(next, ql.outputs);
+            }
+            current = next;
+        }
+        softmax_rows(out + r * out_size, 1, out_size);
+    }
+}
+
+std::vector<float> QuantizedNetwork::forward_batch(const float* inputs, size_t batch_size) const {
+    std::vector<float> probs(batch_size * output_size());
+    forward_into(inputs, batch_size, probs.data());
+    return probs;
+}
+
+std::vector<float> QuantizedNetwork::forward(const std::vector<float>& input) const {
+    if (input.size() != input_size()) {
+        throw std::invalid_argument("Input size does not match the quantized network");
+    }
+    return forward_batch(input.data(), 1);
+}
+
+int QuantizedNetwork::predict_class(const std::vector<float>& input) const {
+    auto output = forward(input);
+    return std::max_element(output.begin(), output.end()) - output.begin();
+}
+
+size_t QuantizedNetwork::weight_bytes() const {
+    size_t bytes = 0;
+    for (const QuantizedLayer& ql : layers) bytes += ql.weights.size();
+    return bytes;
+}
+
+bool QuantizedNetwork::save(const std::string& filename) const {
+    std::ostringstream file;
+
+    write_value(file, QUANTIZED_MAGIC);
+    write_value(file, static_cast<uint32_t>(layers.size()));
+    for (const QuantizedLayer& ql : layers) {
+        write_value(file, static_cast<int32_t>(ql.inputs));
+        write_value(file, static_cast<int32_t>(ql.outputs));
+        write_value(file, ql.input_scale);
+        write_value(file, ql.input_zero_point);
+        file.write((const char*)ql.weight_scales.data(), ql.outputs * sizeof(float));
+        file.write((const char*)ql.biases.data(), ql.outputs * sizeof(float));
+        file.write((const char*)ql.weights.data(), ql.weights.size());
+    }
+    write_value(file, static_cast<uint32_t>(activation));
+
+    const std::string bytes = file.str();
+    if (!write_file_atomically(filename, bytes.data(), bytes.size())) {
+        std::cerr << "Could not write quantized model file: " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Quantized model saved to " << filename << std::endl;
+    return true;
+}
+
+bool QuantizedNetwork::load(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open quantized model file: " << filename << std::endl;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t num_layers = 0;
+    read_value(file, magic);
+    if (magic != QUANTIZED_MAGIC) {
+        std::cerr << "Not a quantized model: " << filename << std::endl;
+        return false;
+    }
+    read_value(file, num_layers);
+
+    // Sizes come from the file, so check every record fits in what is left
+    // of it before allocating, and that each layer feeds the next
+    const std::streamoff header_end = file.tellg();
+    file.seekg(0, std::ios::end);
+    size_t remaining = static_cast<size_t>(std::max<std::streamoff>(0, file.tellg() - header_end));
+    file.seekg(header_end);
+    const size_t layer_header = 2 * sizeof(int32_t) + sizeof(float) + sizeof(int32_t);
+    if (!file || num_layers == 0 || num_layers > remaining / layer_header) {
+        std::cerr << "Corrupt quantized model: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<QuantizedLayer> loaded;
+    for (uint32_t l = 0; l < num_layers; l++) {
+        QuantizedLayer ql;
+        int32_t inputs = 0, outputs = 0;
+        read_value(file, inputs);
+        read_value(file, outputs);
+        read_value(file, ql.input_scale);
+        read_value(file, ql.input_zero_point);
+        remaining -= layer_header;
+        const size_t body = static_cast<size_t>(std::max(outputs, 0)) * 2 * sizeof(float) +
+                            static_cast<size_t>(std::max(inputs, 0)) * static_cast<size_t>(std::max(outputs, 0));
+        if (!file || inputs <= 0 || outputs <= 0 || body > remaining ||
+            (!loaded.empty() && loaded.back().outputs != inputs)) {
+            std::cerr << "Corrupt quantized model: " << filename << std::endl;
+            return false;
+        }
+        remaining -= body;
+        ql.inputs = inputs;
+        ql.outputs = outputs;
+        ql.weight_scales.resize(outputs);
+        ql.biases.resize(outputs);
+        ql.weights.resize(static_cast<size_t>(inputs) * outputs);
+        file.read((char*)ql.weight_scales.data(), outputs * sizeof(float));
+        file.read((char*)ql.biases.data(), outputs * sizeof(float));
+        file.read((char*)ql.weights.data(), ql.weights.size());
+        compute_row_sums(ql);
+        loaded.push_back(std::move(ql));
+    }
+    if (!file) {
+        std::cerr << "Truncated quantized model: " << filename << std::endl;
+        return false;
+    }
+
+    // Files written before the activation was recorded end here (sigmoid)
+    uint32_t stored_activation = static_cast<uint32_t>(ActivationType::SIGMOID);
+    read_value(file, stored_activation);
+    if (!is_activation_type(stored_activation)) {
+        std::cerr << "Corrupt quantized model: " << filename << std::endl;
+        return false;
+    }
+
+    layers = std::move(loaded);
+    set_activation(static_cast<ActivationType>(stored_activation));
+    std::cout << "Quantized model loaded from " << filename << std::endl;
+    return true;
+}
+
+QuantizationReport compare_quantized(NeuralNetwork<float>& net, const QuantizedNetwork& qnet,
+                                     const std::vector<std::vector<float>>& inputs,
+                                     const std::vector<int>& labels) {
+    QuantizationReport report;
+    report.samples = inputs.size();
+    report.int8_weight_bytes = qnet.weight_bytes();
+    for (const DenseLayer<float>& dl : net.get_layers()) {
+        report.fp32_weight_bytes += dl.weight_count() * sizeof(float);
+    }
+    if (inputs.empty()) return report;
+
+    std::vector<float> batch;
+    for (const std::vector<float>& sample : inputs) {
+        batch.insert(batch.end(), sample.begin(), sample.end());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> fp32 = net.forward_batch(batch.data(), inputs.size());
+    auto mid = std::chrono::steady_clock::now();
+    std::vector<float> int8 = qnet.forward_batch(batch.data(), inputs.size());
+    auto end = std::chrono::steady_clock::now();
+    report.fp32_seconds = std::chrono::duration<double>(mid - start).count();
+    report.int8_seconds = std::chrono::duration<double>(end - mid).count();
+
+    size_t classes = qnet.output_size();
+    size_t fp32_correct = 0, int8_correct = 0, agree = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const float* p = fp32.data() + i * classes;
+        const float* q = int8.data() + i * classes;
+        int fp32_class = std::max_element(p, p + classes) - p;
+        int int8_class = std::max_element(q, q + classes) - q;
+        if (fp32_class == labels[i]) fp32_correct++;
+        if (int8_class == labels[i]) int8_correct++;
+        if (fp32_class == int8_class) agree++;
+        for (size_t c = 0; c < classes; c++) {
+            report.max_prob_error = std::max(report.max_prob_error,
+                                             static_cast<double>(std::fabs(p[c] - q[c])));
+        }
+    }
+
+    double n = static_cast<double>(inputs.size());
+    report.fp32_accuracy = fp32_correct / n;
+    report.int8_accuracy = int8_correct / n;
+    report.agreement = agree / n;
+    return report;
+}
+
+void print_quantization_report(const QuantizationReport& report) {
+    std::cout << "INT8 quantization report (" << report.samples << " samples, "
+              << int8_kernels().name << " kernels)" << std::endl;
+    std::cout << "  Accuracy fp32: " << 100.0 * report.fp32_accuracy << "%"
+              << "  int8: " << 100.0 * report.int8_accuracy << "%" << std::endl;
+    std::cout << "  Top-1 agreement: " << 100.0 * report.agreement << "%"
+              << "  max probability error: " << report.max_prob_error << std::endl;
+    std::cout << "  Weights fp32: " << report.fp32_weight_bytes / 1024.0 << " KiB"
+              << "  int8: " << report.int8_weight_bytes / 1024.0 << " KiB" << std::endl;
+    std::cout << "  Inference fp32: " << report.fp32_seconds * 1000.0 << " ms"
+              << "  int8: " << report.int8_seconds * 1000.0 << " ms" << std::endl;
+}
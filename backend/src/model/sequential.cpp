@@ -0,0 +1,523 @@
+#include "sequential.h"
+#include "fast_math.h"
+#include "training_helpers.h"
+#include "workspace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Output bytes a fused step produces per tile before running its epilogue,
+// so the epilogue finds the tile still in cache
+constexpr size_t FUSED_TILE_BYTES = 64 * 1024;
+
+// Layers whose forward pass leaves the data as it is: a plan skips them
+bool is_identity(LayerKind kind, bool training) {
+    return kind == LayerKind::FLATTEN || (!training && kind == LayerKind::DROPOUT);
+}
+
+template<typename V>
+void write_value(std::ostream& file, const V& value) {
+    file.write((const char*)&value, sizeof(V));
+}
+
+template<typename V>
+bool read_value(std::istream& file, V& value) {
+    return static_cast<bool>(file.read((char*)&value, sizeof(V)));
+}
+
+} // namespace
+
+template<typename T>
+size_t ExecutionPlan<T>::workspace_bytes(size_t n) const {
+    size_t bytes = 2 * Workspace::bytes_for<T>(n * widest) + layer_scratch;
+    if (training) {
+        bytes += Workspace::bytes_for<T*>(steps.size());
+        for (const PlanStep<T>& step : steps) {
+            bytes += Workspace::bytes_for<T>(n * step.output_width);
+        }
+    }
+    return bytes;
+}
+
+template<typename T>
+Sequential<T>::Sequential(const Shape& input, double lr)
+    : input_shape(input), learning_rate(lr) {
+    if (input.size() == 0) {
+        throw std::invalid_argument("Sequential network needs a non-empty input shape");
+    }
+}
+
+template<typename T>
+Sequential<T>& Sequential<T>::add(std::unique_ptr<Layer<T>> layer) {
+    if (!layer) throw std::invalid_argument("Cannot add a null layer");
+    output_shapes.push_back(layer->build(output_shape()));
+    layer->set_num_threads(num_threads);
+    layers.push_back(std::move(layer));
+
+    // The architecture changed: resolve the plans once, here
+    inference_plan = build_plan(false);
+    training_plan = build_plan(true);
+    gradients.clear();
+    return *this;
+}
+
+template<typename T>
+ExecutionPlan<T> Sequential<T>::build_plan(bool training) const {
+    ExecutionPlan<T> plan;
+    plan.training = training;
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        Layer<T>* layer = layers[i].get();
+        if (is_identity(layer->kind(), training)) continue;
+
+        PlanStep<T> step;
+        step.layer = layer;
+        step.first_layer = i;
+        step.input_width = (i == 0 ? input_shape : output_shapes[i - 1]).size();
+        step.output_width = output_shapes[i].size();
+        // Training keeps every step's output for backprop, so nothing runs in place
+        step.in_place = !training && layer->in_place();
+
+        // Fold the next element-wise layer into a Dense or convolution step,
+        // looking past the layers the plan leaves out
+        size_t next = i + 1;
+        while (next < layers.size() && is_identity(layers[next]->kind(), training)) {
+            next++;
+        }
+        bool fusable = layer->kind() == LayerKind::DENSE || layer->kind() == LayerKind::CONV2D ||
+                       layer->kind() == LayerKind::DEPTHWISE_CONV2D;
+        if (fusable && next < layers.size()) {
+            Layer<T>* following = layers[next].get();
+            if (following->kind() == LayerKind::ACTIVATION) {
+                step.epilogue = Epilogue::ACTIVATION;
+                step.activation = static_cast<const Activation<T>*>(following)->kernels();
+            } else if (following->kind() == LayerKind::SOFTMAX) {
+                step.epilogue = Epilogue::SOFTMAX;
+            }
+            if (step.epilogue != Epilogue::NONE) {
+                step.fused = following;
+                i = next;
+            }
+        }
+
+        plan.widest = std::max({plan.widest, step.input_width, step.output_width});
+        plan.layer_scratch = std::max(plan.layer_scratch, layer->workspace_bytes());
+        plan.steps.push_back(step);
+    }
+    return plan;
+}
+
+template<typename T>
+void Sequential<T>::run_step(const PlanStep<T>& step, const T* in, T* out, size_t n,
+                             bool training) const {
+    if (step.epilogue == Epilogue::NONE) {
+        step.layer->forward(in, out, n, training);
+        return;
+    }
+    // Enough rows per tile to keep every thread of the layer busy
+    const size_t tile = std::max<size_t>(FUSED_TILE_BYTES / (step.output_width * sizeof(T)),
+                                         static_cast<size_t>(num_threads));
+    for (size_t r0 = 0; r0 < n; r0 += tile) {
+        size_t rows = std::min(tile, n - r0);
+        T* block = out + r0 * step.output_width;
+        step.layer->forward(in + r0 * step.input_width, block, rows, training);
+        if (step.epilogue == Epilogue::ACTIVATION) {
+            step.activation.activate(block, rows * step.output_width);
+        } else {
+            softmax_rows(block, rows, step.output_width);
+        }
+    }
+}
+
+template<typename T>
+void Sequential<T>::forward_into(const T* inputs, size_t n, T* out) const {
+    const ExecutionPlan<T>& plan = inference_plan;
+    if (plan.steps.empty()) {
+        std::copy(inputs, inputs + n * input_size(), out);
+        return;
+    }
+
+    Workspace& ws = thread_workspace();
+    ws.reserve(plan.workspace_bytes(n));
+    Workspace::Scope scope(ws);
+    T* buffers[2] = {ws.alloc<T>(n * plan.widest), ws.alloc<T>(n * plan.widest)};
+
+    // Ping-pong between the two buffers; in-place steps stay where they are
+    const T* current = inputs;
+    int current_buffer = -1;
+    for (size_t s = 0; s < plan.steps.size(); s++) {
+        const PlanStep<T>& step = plan.steps[s];
+        T* target;
+        if (s == plan.steps.size() - 1) {
+            target = out;
+        } else if (step.in_place && current_buffer >= 0) {
+            target = buffers[current_buffer];
+        } else {
+            current_buffer = (current_buffer == 0) ? 1 : 0;
+            target = buffers[current_buffer];
+        }
+        run_step(step, current, target, n, false);
+        current = target;
+    }
+}
+
+template<typename T>
+std::vector<T> Sequential<T>::forward_batch(const T* inputs, size_t batch_size) const {
+    std::vector<T> result(batch_size * output_size());
+    forward_into(inputs, batch_size, result.data());
+    return result;
+}
+
+template<typename T>
+std::vector<T> Sequential<T>::forward(const std::vector<T>& input) const {
+    if (input.size() != input_size()) {
+        throw std::invalid_argument("Input size does not match the network's input shape");
+    }
+    return forward_batch(input.data(), 1);
+}
+
+template<typename T>
+int Sequential<T>::predict_class(const std::vector<T>& input) const {
+    std::vector<T> output = forward(input);
+    return std::max_element(output.begin(), output.end()) - output.begin();
+}
+
+template<typename T>
+StepResult Sequential<T>::train_step(const T* inputs, const T* targets, size_t batch_size) {
+    if (batch_size == 0) return StepResult();
+    if (layers.empty() || layers.back()->kind() != LayerKind::SOFTMAX) {
+        throw std::logic_error("Training needs a network that ends in Softmax");
+    }
+    const ExecutionPlan<T>& plan = training_plan;
+    const size_t n = batch_size;
+    const size_t classes = output_size();
+    const size_t last = plan.steps.size() - 1;
+
+    if (gradients.size() != layers.size()) {
+        gradients.clear();
+        for (const auto& layer : layers) {
+            gradients.emplace_back(layer->parameter_count(), T());
+        }
+    }
+    for (AlignedVector<T>& g : gradients) {
+        std::fill(g.begin(), g.end(), T(0));
+    }
+
+    Workspace& ws = thread_workspace();
+    ws.reserve(plan.workspace_bytes(n));
+    Workspace::Scope scope(ws);
+
+    // Forward pass, keeping every step's output
+    T** outputs = ws.alloc<T*>(plan.steps.size());
+    const T* current = inputs;
+    for (size_t s = 0; s < plan.steps.size(); s++) {
+        outputs[s] = ws.alloc<T>(n * plan.steps[s].output_width);
+        run_step(plan.steps[s], current, outputs[s], n, true);
+        current = outputs[s];
+    }
+
+    StepResult result;
+    const T* probs = outputs[last];
+    for (size_t r = 0; r < n; r++) {
+        const T* p = probs + r * classes;
+        const T* y = targets + r * classes;
+        for (size_t j = 0; j < classes; j++) {
+            result.loss += -y[j] * log(p[j] + 1e-10);
+        }
+        if (std::max_element(p, p + classes) - p == std::max_element(y, y + classes) - y) {
+            result.correct++;
+        }
+    }
+
+    // Softmax + cross-entropy: the gradient at the softmax input is p - y
+    T* grad = ws.alloc<T>(n * plan.widest);
+    T* spare = ws.alloc<T>(n * plan.widest);
+    for (size_t i = 0; i < n * classes; i++) {
+        grad[i] = probs[i] - targets[i];
+    }
+
+    for (size_t s = plan.steps.size(); s-- > 0;) {
+        const PlanStep<T>& step = plan.steps[s];
+        const T* in = (s == 0) ? inputs : outputs[s - 1];
+        const T* out = outputs[s];
+
+        if (s == last && step.epilogue == Epilogue::NONE) {
+            // The standalone output softmax is already accounted for
+            continue;
+        }
+        if (step.epilogue == Epilogue::ACTIVATION) {
+            step.activation.derivative(out, grad, n * step.output_width);
+        } else if (step.epilogue == Epilogue::SOFTMAX && s != last) {
+            step.fused->backward(out, out, grad, grad, n, nullptr);
+        }
+
+        Layer<T>* layer = step.layer;
+        if (s == 0 && layer->parameter_count() == 0) break;
+        T* param_grads = gradients[step.first_layer].empty() ? nullptr
+                         : gradients[step.first_layer].data();
+        T* grad_in = (s == 0) ? nullptr : layer->in_place() ? grad : spare;
+        layer->backward(in, out, grad, grad_in, n, param_grads);
+        if (grad_in == spare) std::swap(grad, spare);
+    }
+
+    // Mean gradient step on every layer that has parameters
+    const T scale = static_cast<T>(-learning_rate / n);
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (gradients[i].empty()) continue;
+        simd<T>().axpy(scale, gradients[i].data(), layers[i]->parameters(), gradients[i].size());
+    }
+    return result;
+}
+
+template<typename T>
+void Sequential<T>::train_batch(const std::vector<std::vector<T>>& inputs,
+                                const std::vector<std::vector<T>>& targets,
+                                int epochs, int batch_size) {
+    const size_t batch = std::max(1, batch_size);
+
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    std::vector<T> x_batch;
+    std::vector<T> y_batch;
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        StepResult epoch_result;
+        std::shuffle(order.begin(), order.end(), gen);
+
+        for (size_t start = 0; start < inputs.size(); start += batch) {
+            size_t count = std::min(batch, inputs.size() - start);
+            gather_rows(inputs, order, start, count, x_batch);
+            gather_rows(targets, order, start, count, y_batch);
+
+            epoch_result += train_step(x_batch.data(), y_batch.data(), count);
+        }
+
+        if ((epoch + 1) % 10 == 0) {
+            report_epoch(epoch + 1, epochs, epoch_result.loss, epoch_result.correct, inputs.size());
+        }
+    }
+}
+
+template<typename T>
+size_t Sequential<T>::output_size() const {
+    return output_shape().size();
+}
+
+template<typename T>
+size_t Sequential<T>::parameter_count() const {
+    size_t count = 0;
+    for (const auto& layer : layers) {
+        count += layer->parameter_count();
+    }
+    return count;
+}
+
+template<typename T>
+std::string Sequential<T>::summary() const {
+    std::ostringstream os;
+    os << "Input " << input_shape.str() << std::endl;
+    for (size_t i = 0; i < layers.size(); i++) {
+        os << "  " << layers[i]->describe() << " -> " << output_shapes[i].str() << std::endl;
+    }
+    os << "Parameters: " << parameter_count() << std::endl;
+    os << "Inference plan: " << inference_plan.steps.size() << " steps" << std::endl;
+    for (const PlanStep<T>& step : inference_plan.steps) {
+        os << "  " << step.layer->describe();
+        if (step.fused != nullptr) os << " + " << step.fused->describe();
+        if (step.in_place) os << " (in place)";
+        os << std::endl;
+    }
+    return os.str();
+}
+
+template<typename T>
+void Sequential<T>::set_num_threads(int threads) {
+    num_threads = std::max(1, threads);
+    for (const auto& layer : layers) {
+        layer->set_num_threads(num_threads);
+    }
+}
+
+template<typename T>
+bool Sequential<T>::save(const std::string& filename) const {
+    std::ostringstream file;
+    write_value(file, GRAPH_FILE_MAGIC);
+    write_value(file, GRAPH_FILE_VERSION);
+    write_value(file, static_cast<uint32_t>(scalar_type));
+    write_value(file, static_cast<int32_t>(input_shape.channels));
+    write_value(file, static_cast<int32_t>(input_shape.height));
+    write_value(file, static_cast<int32_t>(input_shape.width));
+    write_value(file, learning_rate);
+
+    write_value(file, static_cast<uint32_t>(layers.size()));
+    for (const auto& layer : layers) {
+        LayerConfig c = layer->config();
+        write_value(file, static_cast<uint32_t>(c.kind));
+        for (int32_t arg : c.args) write_value(file, arg);
+        write_value(file, c.rate);
+        uint64_t count = layer->parameter_count();
+        write_value(file, count);
+        file.write((const char*)layer->parameters(), count * sizeof(T));
+    }
+
+    write_value(file, static_cast<uint32_t>(class_names.size()));
+    for (const std::string& name : class_names) {
+        write_value(file, static_cast<uint32_t>(name.size()));
+        file.write(name.data(), name.size());
+    }
+
+    std::string bytes = file.str();
+    uint64_t checksum = fnv1a_checksum(bytes.data(), bytes.size());
+    bytes.append((const char*)&checksum, sizeof(checksum));
+    if (!write_file_atomically(filename, bytes.data(), bytes.size())) {
+        std::cerr << "Could not write model file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template<typename T>
+std::unique_ptr<Sequential<T>> Sequential<T>::from_file(const std::string& filename) {
+    std::ifstream stored(filename, std::ios::binary);
+    if (!stored.is_open()) {
+        std::cerr << "Could not open model file: " << filename << std::endl;
+        return nullptr;
+    }
+    // The parameters are copied out anyway, so read the whole file and check
+    // it before parsing
+    std::string bytes((std::istreambuf_iterator<char>(stored)), std::istreambuf_iterator<char>());
+    std::istringstream file(bytes);
+
+    uint32_t magic = 0, version = 0, dtype = 0;
+    int32_t channels = 0, height = 0, width = 0;
+    double lr = 0.0;
+    uint32_t num_layers = 0;
+    if (!read_value(file, magic) || magic != GRAPH_FILE_MAGIC || !read_value(file, version)) {
+        std::cerr << "Not a layer-graph model file: " << filename << std::endl;
+        return nullptr;
+    }
+    if (version != GRAPH_FILE_VERSION && version != 1) {
+        std::cerr << "Unsupported model file version " << version << ": " << filename << std::endl;
+        return nullptr;
+    }
+    // Version 1 files end without the checksum
+    if (version == GRAPH_FILE_VERSION) {
+        // The magic and version were read, so the trailer's 8 bytes exist
+        uint64_t checksum = 0;
+        size_t body = bytes.size() - sizeof(checksum);
+        std::memcpy(&checksum, bytes.data() + body, sizeof(checksum));
+        if (fnv1a_checksum(bytes.data(), body) != checksum) {
+            std::cerr << "Model file checksum mismatch: " << filename << std::endl;
+            return nullptr;
+        }
+    }
+    read_value(file, dtype);
+    if (dtype != static_cast<uint32_t>(scalar_type)) {
+        std::cerr << "Model file is stored as " << scalar_type_name(static_cast<ScalarType>(dtype))
+                  << ", not " << scalar_type_name(scalar_type) << ": " << filename << std::endl;
+        return nullptr;
+    }
+    read_value(file, channels);
+    read_value(file, height);
+    read_value(file, width);
+    read_value(file, lr);
+    if (!read_value(file, num_layers)) {
+        std::cerr << "Corrupt model file: " << filename << std::endl;
+        return nullptr;
+    }
+
+    try {
+        auto net = std::make_unique<Sequential>(Shape{channels, height, width}, lr);
+        for (uint32_t i = 0; i < num_layers; i++) {
+            LayerConfig c;
+            uint32_t kind = 0;
+            uint64_t count = 0;
+            read_value(file, kind);
+            c.kind = static_cast<LayerKind>(kind);
+            for (int32_t& arg : c.args) read_value(file, arg);
+            read_value(file, c.rate);
+            if (!read_value(file, count)) {
+                throw std::invalid_argument("truncated layer table");
+            }
+
+            net->add(LayerFactory::create<T>(c));
+            Layer<T>& layer = *net->layers.back();
+            if (count != layer.parameter_count()) {
+                throw std::invalid_argument("parameter count does not match the layer");
+            }
+            file.read((char*)layer.parameters(), count * sizeof(T));
+        }
+
+        uint32_t num_classes = 0;
+        read_value(file, num_classes);
+        for (uint32_t i = 0; file && i < num_classes; i++) {
+            uint32_t length = 0;
+            read_value(file, length);
+            std::string name(length, '\0');
+            file.read(&name[0], length);
+            net->class_names.push_back(name);
+        }
+        if (!file) {
+            throw std::invalid_argument("truncated file");
+        }
+        return net;
+    } catch (const std::exception& e) {
+        std::cerr << "Corrupt model file (" << e.what() << "): " << filename << std::endl;
+        return nullptr;
+    }
+}
+
+bool is_graph_model_file(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    uint32_t magic = 0;
+    return read_value(file, magic) && magic == GRAPH_FILE_MAGIC;
+}
+
+template<typename T>
+std::unique_ptr<Layer<T>> LayerFactory::create(const LayerConfig& c) {
+    switch (c.kind) {
+        case LayerKind::DENSE:
+            return std::make_unique<Dense<T>>(c.args[0]);
+        case LayerKind::ACTIVATION:
+            if (!is_activation_type(static_cast<uint32_t>(c.args[0]))) {
+                throw std::invalid_argument("unknown activation");
+            }
+            return std::make_unique<Activation<T>>(static_cast<ActivationType>(c.args[0]));
+        case LayerKind::SOFTMAX:
+            return std::make_unique<Softmax<T>>();
+        case LayerKind::DROPOUT:
+            return std::make_unique<Dropout<T>>(c.rate);
+        case LayerKind::CONV2D:
+            return std::make_unique<Conv2D<T>>(c.args[0], c.args[1], c.args[2], c.args[3]);
+        case LayerKind::MAX_POOL2D:
+            return std::make_unique<MaxPool2D<T>>(c.args[0], c.args[1]);
+        case LayerKind::AVG_POOL2D:
+            return std::make_unique<AvgPool2D<T>>(c.args[0], c.args[1]);
+        case LayerKind::FLATTEN:
+            return std::make_unique<Flatten<T>>();
+        case LayerKind::DEPTHWISE_CONV2D:
+            return std::make_unique<DepthwiseConv2D<T>>(c.args[0], c.args[1], c.args[2]);
+        case LayerKind::GLOBAL_AVG_POOL2D:
+            return std::make_unique<GlobalAvgPool2D<T>>();
+        default:
+            throw std::invalid_argument("unknown layer kind " + std::to_string(static_cast<int>(c.kind)));
+    }
+}
+
+template std::unique_ptr<Layer<float>> LayerFactory::create<float>(const LayerConfig& config);
+template std::unique_ptr<Layer<double>> LayerFactory::create<double>(const LayerConfig& config);
+template struct ExecutionPlan<float>;
+template struct ExecutionPlan<double>;
+template class Sequential<float>;
+template class Sequential<double>;
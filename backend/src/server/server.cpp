@@ -1,114 +1,551 @@
 #include "neural_network.h"
+#include "quantized_network.h"
+#include "sequential.h"
+#include "simd_kernels.h"
+#include "fast_math.h"
+#include "micro_batcher.h"
+#include "model_registry.h"
+#include "thread_pool.h"
 #include <opencv2/opencv.hpp>
 #include <microhttpd.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
 #include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
 
-std::vector<std::string> class_names;
-NeuralNetwork* nn = nullptr;
-int IMG_SIZE = 32;
+// Size and modification time of a file, to notice it being replaced
+struct FileStamp {
+    off_t size = -1;
+    int64_t mtime_ns = 0;
 
-std::vector<double> image_to_vector(const cv::Mat& img) {
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+FileStamp stamp_file(const std::string& filename) {
+    FileStamp stamp;
+    struct stat info;
+    if (!filename.empty() && stat(filename.c_str(), &info) == 0) {
+        stamp.size = info.st_size;
+        stamp.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+    return stamp;
+}
+
+// Where models are loaded from; a reload reads the same files again
+struct ModelSource {
+    std::string model_file;
+    std::string classes_file;
+    std::string int8_model_file;
+    MicroBatcher::Options batching;
+};
+
+std::vector<FileStamp> stamp_sources(const ModelSource& source) {
+    return {stamp_file(source.model_file), stamp_file(source.classes_file),
+            stamp_file(source.int8_model_file)};
+}
+
+// Everything one loaded model needs to serve requests. A reload builds a
+// new one; every request holds a reference to the one it started on, so
+// it finishes there even if the model is swapped meanwhile.
+struct ServedModel {
+    std::unique_ptr<NeuralNetwork<>> nn;
+    // Set instead of nn when the model file holds a layer graph (e.g. a CNN)
+    std::unique_ptr<Sequential<>> graph;
+    // Optional INT8 copy of the model; /classify uses it when loaded
+    std::unique_ptr<QuantizedNetwork> qnet;
+    std::vector<std::string> class_names;
+    int img_size = 32;  // taken from the model's input size
+    size_t output_size = 0;
+    uint64_t version = 0;
+    // The files it was loaded from, and how they looked beforehand, so the
+    // reload thread notices them change
+    std::string name;
+    ModelSource source;
+    std::vector<FileStamp> stamps;
+    // Bytes it keeps resident, counted against the registry's budget: the
+    // model files it maps, or the parameters of a graph read onto the heap
+    size_t bytes = 0;
+    // Queues /classify requests into batched forward passes. Declared last,
+    // so it is destroyed first: the batches still queued run on this model
+    // before its networks go away.
+    std::unique_ptr<MicroBatcher> batcher;
+
+    // n preprocessed images -> n rows of class probabilities; every model's
+    // batched forward pass keeps its activations in the calling thread's
+    // arena, so the batcher's workers may run it at once
+    void classify_batch(const float* inputs, size_t n, float* outputs) const {
+        std::vector<float> probs = qnet != nullptr ? qnet->forward_batch(inputs, n)
+                                 : graph != nullptr ? graph->forward_batch(inputs, n)
+                                 : nn->forward_batch(inputs, n);
+        // load_model only accepts networks whose output matches output_size
+        assert(probs.size() == n * output_size);
+        std::copy(probs.begin(), probs.end(), outputs);
+    }
+};
+
+// Where models are found: the default model from its own files, every
+// other one by name next to it as <name>.bin, with <name>.classes.txt for
+// files without class names and <name>.int8.bin when INT8 serving is on
+struct ModelCatalog {
+    std::string default_name;
+    ModelSource default_source;
+    std::string directory;
+    bool int8 = false;
+
+    ModelSource source_for(const std::string& name) const {
+        if (name == default_name) return default_source;
+        ModelSource source;
+        source.model_file = directory + "/" + name + ".bin";
+        source.classes_file = directory + "/" + name + ".classes.txt";
+        if (int8) source.int8_model_file = directory + "/" + name + ".int8.bin";
+        source.batching = default_source.batching;
+        return source;
+    }
+};
+ModelCatalog catalog;
+
+// The models /classify serves, loaded on first use and evicted least
+// recently used first beyond the memory budget. Requests look them up
+// without taking a lock; the reload thread replaces them.
+std::unique_ptr<ModelRegistry<ServedModel>> models;
+// Decodes uploads off the HTTP threads and hands them to the batcher
+std::unique_ptr<ThreadPool> compute_pool;
+
+// Reload triggers: SIGHUP, POST /admin/reload (loopback clients only) and
+// changes to the model files
+std::atomic<bool> hangup_received{false};  // lock-free, so safe to set from the handler
+std::mutex reload_mutex;
+std::condition_variable reload_cv;
+bool reload_requested = false;
+bool reload_stopping = false;
+
+std::vector<float> image_to_vector(const cv::Mat& img, int img_size) {
     cv::Mat resized, gray;
-    cv::resize(img, resized, cv::Size(IMG_SIZE, IMG_SIZE));
+    cv::resize(img, resized, cv::Size(img_size, img_size));
     cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
-    
-    std::vector<double> vec;
+
+    std::vector<float> vec;
     for (int i = 0; i < gray.rows; i++) {
         for (int j = 0; j < gray.cols; j++) {
-            vec.push_back(gray.at<uchar>(i, j) / 255.0);
+            vec.push_back(gray.at<uchar>(i, j) / 255.0f);
         }
     }
     return vec;
 }
 
-std::string create_json_response(const std::vector<double>& probs) {
+std::string create_json_response(const std::vector<float>& probs,
+                                 const std::vector<std::string>& class_names) {
     std::stringstream ss;
     ss << "{\"predictions\":[";
-    
-    std::vector<std::pair<double, int>> indexed_probs;
+
+    std::vector<std::pair<float, int>> indexed_probs;
     for (size_t i = 0; i < probs.size(); i++) {
         indexed_probs.push_back({probs[i], i});
     }
-    std::sort(indexed_probs.begin(), indexed_probs.end(), 
+    std::sort(indexed_probs.begin(), indexed_probs.end(),
               [](const auto& a, const auto& b) { return a.first > b.first; });
-    
+
     for (size_t i = 0; i < std::min(size_t(5), indexed_probs.size()); i++) {
         if (i > 0) ss << ",";
         ss << "{\"className\":\"" << class_names[indexed_probs[i].second] << "\","
            << "\"confidence\":" << indexed_probs[i].first << ","
            << "\"classId\":" << indexed_probs[i].second << "}";
     }
-    
+
     ss << "]}";
     return ss.str();
 }
 
+// Load, check and warm up a model; nullptr with a message on std::cerr if
+// the files cannot be served. The model file describes its own
+// architecture; its pages are mapped read-only and shared with any other
+// server on the same file.
+std::shared_ptr<ServedModel> load_model(const std::string& name, const ModelSource& source,
+                                        uint64_t version) {
+    auto model = std::make_shared<ServedModel>();
+    model->version = version;
+    model->name = name;
+    model->source = source;
+    // Stamped before reading, so a change made during the load is seen later
+    model->stamps = stamp_sources(source);
+    if (is_graph_model_file(source.model_file)) {
+        model->graph = Sequential<>::from_file(source.model_file);
+        if (!model->graph) {
+            return nullptr;
+        }
+        Shape input = model->graph->get_input_shape();
+        if (input.channels != 1 || input.height != input.width) {
+            std::cerr << "Model input " << input.str() << " is not a square grayscale image" << std::endl;
+            return nullptr;
+        }
+        model->img_size = input.height;
+        model->output_size = model->graph->output_size();
+        model->class_names = model->graph->get_class_names();
+        std::cout << model->graph->summary() << std::endl;
+    } else {
+        model->nn = NeuralNetwork<>::from_file(source.model_file);
+        if (!model->nn) {
+            return nullptr;
+        }
+
+        int input_size = model->nn->get_layer_sizes().front();
+        model->img_size = static_cast<int>(std::lround(std::sqrt(input_size)));
+        if (model->img_size * model->img_size != input_size) {
+            std::cerr << "Model input size " << input_size << " is not a square image" << std::endl;
+            return nullptr;
+        }
+        model->output_size = model->nn->get_layer_sizes().back();
+        model->class_names = model->nn->get_class_names();
+    }
+
+    // Older model files carry no class names; read them from the classes file
+    if (model->class_names.empty()) {
+        std::ifstream cf(source.classes_file);
+        if (!cf.is_open()) {
+            std::cerr << "Could not open classes file: " << source.classes_file << std::endl;
+            return nullptr;
+        }
+
+        std::string line;
+        while (std::getline(cf, line)) {
+            model->class_names.push_back(line);
+        }
+        cf.close();
+    }
+    if (model->class_names.size() != model->output_size) {
+        std::cerr << "Model has " << model->output_size << " outputs but "
+                  << model->class_names.size() << " class names" << std::endl;
+        return nullptr;
+    }
+
+    std::cout << "Loaded " << name << ": " << model->class_names.size() << " classes, input "
+              << model->img_size << "x" << model->img_size << std::endl;
+
+    if (!source.int8_model_file.empty() && model->graph != nullptr) {
+        std::cerr << "INT8 models cover dense networks only; serving the graph in float" << std::endl;
+    } else if (!source.int8_model_file.empty()) {
+        model->qnet = std::make_unique<QuantizedNetwork>();
+        const size_t input_size = static_cast<size_t>(model->img_size) * model->img_size;
+        if (!model->qnet->load(source.int8_model_file)) {
+            model->qnet.reset();
+        } else if (model->qnet->input_size() != input_size ||
+                   model->qnet->output_size() != model->output_size) {
+            // A stale INT8 copy left over from an older model
+            std::cerr << "INT8 model " << source.int8_model_file << " is "
+                      << model->qnet->input_size() << " -> " << model->qnet->output_size()
+                      << " but the model is " << input_size << " -> " << model->output_size
+                      << "; serving in float" << std::endl;
+            model->qnet.reset();
+        } else {
+            std::cout << "Serving INT8 model (" << int8_kernels().name << " kernels)" << std::endl;
+        }
+    }
+    model->bytes = model->graph != nullptr ? model->graph->parameter_count() * sizeof(float)
+                   : static_cast<size_t>(std::max<off_t>(0, model->stamps[0].size));
+    if (model->qnet != nullptr) model->bytes += static_cast<size_t>(std::max<off_t>(0, model->stamps[2].size));
+
+    // Every inference thread runs its own full-size batch before the model
+    // is served, so its workspace arena is sized before the first request
+    const ServedModel* m = model.get();
+    const size_t input_size = static_cast<size_t>(m->img_size) * m->img_size;
+    MicroBatcher::Options batching = source.batching;
+    batching.warmup = [m, input_size, max_batch = batching.max_batch]() {
+        std::vector<float> inputs(max_batch * input_size, 0.0f), outputs(max_batch * m->output_size);
+        m->classify_batch(inputs.data(), max_batch, outputs.data());
+    };
+    try {
+        model->batcher = std::make_unique<MicroBatcher>(
+            input_size, m->output_size,
+            [m](const float* inputs, size_t n, float* outputs) { m->classify_batch(inputs, n, outputs); },
+            batching);
+    } catch (const std::exception& e) {
+        // e.g. a max_batch too large to warm up
+        std::cerr << "Could not warm up " << name << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+    return model;
+}
+
+static void handle_hangup(int) {
+    hangup_received = true;
+}
+
+void request_reload() {
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        reload_requested = true;
+    }
+    reload_cv.notify_one();
+}
+
+// Background reloads: a new copy of a model loads and warms up here while
+// the old one keeps serving, then the registry swaps it in. A model that
+// fails to load leaves the old one in place. Only resident models are
+// watched; the others are read afresh on first use anyway. File changes are
+// picked up once the files have looked the same for a whole poll, so a copy
+// still in progress is not loaded.
+void reload_loop() {
+    std::unordered_map<std::string, std::vector<FileStamp>> seen;
+    // Files a reload failed on are not retried until they change again
+    std::unordered_map<std::string, std::vector<FileStamp>> failed;
+
+    std::unique_lock<std::mutex> lock(reload_mutex);
+    while (!reload_stopping) {
+        reload_cv.wait_for(lock, std::chrono::seconds(1),
+                           [&]() { return reload_requested || reload_stopping; });
+        if (reload_stopping) break;
+        const bool reload_all = reload_requested || hangup_received;
+        reload_requested = false;
+        hangup_received = false;
+        lock.unlock();
+
+        std::unordered_map<std::string, std::vector<FileStamp>> now;
+        for (const auto& resident : models->resident()) {
+            const ServedModel& old = *resident.second;
+            std::vector<FileStamp> stamps = stamp_sources(old.source);
+            auto last = seen.find(old.name);
+            bool files_changed = stamps != old.stamps && last != seen.end() && stamps == last->second &&
+                                 (failed.count(old.name) == 0 || failed[old.name] != stamps);
+            now[old.name] = stamps;
+            if (!reload_all && !files_changed) continue;
+
+            std::cout << "Reloading " << old.name << " from " << old.source.model_file << "..." << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<ServedModel> model = load_model(old.name, old.source, old.version + 1);
+            if (model == nullptr) {
+                std::cerr << "Reload failed; still serving " << old.name << " version " << old.version << std::endl;
+                failed[old.name] = stamps;
+                continue;
+            }
+            failed.erase(old.name);
+            uint64_t version = model->version;
+            // Evicted or replaced while loading: it loads afresh on its next
+            // use instead
+            if (!models->replace_if(old.name, resident.second, std::move(model))) continue;
+            double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Serving " << old.name << " version " << version << " (loaded in " << ms << " ms)" << std::endl;
+        }
+        seen = std::move(now);
+        lock.lock();
+    }
+}
+
+// A /classify request is suspended while the compute pool and the batcher
+// work on it; they fill in the response and resume the connection
 struct ConnectionInfo {
     std::string data;
-    bool processing = false;
+    bool submitted = false;
+    unsigned int status = MHD_HTTP_OK;
+    std::string response;
 };
 
+static void finish_request(struct MHD_Connection *connection, ConnectionInfo *con_info,
+                           unsigned int status, std::string response) {
+    con_info->status = status;
+    con_info->response = std::move(response);
+    MHD_resume_connection(connection);
+}
+
+// Runs on the compute pool: decode and preprocess the upload, then queue it
+// for the next batch of its model, whose worker resumes the connection with
+// the result
+static void classify_upload(struct MHD_Connection *connection, ConnectionInfo *con_info,
+                            ServedModel& model) {
+    std::vector<float> vec;
+    try {
+        std::vector<unsigned char> img_data(con_info->data.begin(), con_info->data.end());
+        cv::Mat img = cv::imdecode(img_data, cv::IMREAD_COLOR);
+        if (!img.empty()) vec = image_to_vector(img, model.img_size);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to decode upload: " << e.what() << std::endl;
+    }
+    if (vec.empty()) {
+        finish_request(connection, con_info, MHD_HTTP_BAD_REQUEST,
+                       "{\"error\":\"Failed to process image\"}");
+        return;
+    }
+
+    // The batcher is destroyed before the rest of its model, so the model
+    // outlives every callback it runs
+    const ServedModel* m = &model;
+    model.batcher->submit(std::move(vec), [connection, con_info, m](std::vector<float> probs,
+                                                                    std::exception_ptr error) {
+        if (!error) {
+            finish_request(connection, con_info, MHD_HTTP_OK,
+                           create_json_response(probs, m->class_names));
+            return;
+        }
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            std::cerr << "Inference failed: " << e.what() << std::endl;
+        }
+        finish_request(connection, con_info, MHD_HTTP_INTERNAL_SERVER_ERROR,
+                       "{\"error\":\"Inference failed\"}");
+    });
+}
+
+// Model names arrive in URLs and headers and become file names, so only
+// plain names are accepted
+static bool valid_model_name(const std::string& name) {
+    if (name.empty() || name.size() > 64) return false;
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+
+// /classify/<name> selects a model, otherwise the X-Model header does,
+// otherwise the default model serves
+static std::string requested_model(struct MHD_Connection *connection, const char *url) {
+    if (strncmp(url, "/classify/", 10) == 0) return url + 10;
+    const char *header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "X-Model");
+    if (header != nullptr && *header != '\0') return header;
+    return catalog.default_name;
+}
+
+// Whether the request came from this machine. /admin/reload has no
+// credentials, so only local clients (operators, deploy scripts) may use it.
+static bool is_loopback_client(struct MHD_Connection *connection) {
+    const union MHD_ConnectionInfo *info =
+        MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    if (info == nullptr || info->client_addr == nullptr) return false;
+    const struct sockaddr *addr = info->client_addr;
+    if (addr->sa_family == AF_INET) {
+        const auto *in = reinterpret_cast<const struct sockaddr_in*>(addr);
+        return (ntohl(in->sin_addr.s_addr) >> 24) == 127;
+    }
+    if (addr->sa_family == AF_INET6) {
+        const struct in6_addr& in6 = reinterpret_cast<const struct sockaddr_in6*>(addr)->sin6_addr;
+        return IN6_IS_ADDR_LOOPBACK(&in6) || (IN6_IS_ADDR_V4MAPPED(&in6) && in6.s6_addr[12] == 127);
+    }
+    return false;
+}
+
+static MHD_Result send_json(struct MHD_Connection *connection, unsigned int status,
+                            const std::string& response) {
+    auto *resp = MHD_create_response_from_buffer(response.length(),
+                                                  (void*)response.c_str(),
+                                                  MHD_RESPMEM_MUST_COPY);
+    MHD_add_response_header(resp, "Content-Type", "application/json");
+    MHD_add_response_header(resp, "Access-Control-Allow-Origin", "*");
+    MHD_Result ret = static_cast<MHD_Result>(MHD_queue_response(connection, status, resp));
+    MHD_destroy_response(resp);
+    return ret;
+}
+
 static MHD_Result answer_to_connection(void *cls, struct MHD_Connection *connection,
                                        const char *url, const char *method,
                                        const char *version, const char *upload_data,
                                        size_t *upload_data_size, void **con_cls) {
-    
+
     if (*con_cls == nullptr) {
         auto *con_info = new ConnectionInfo();
         *con_cls = con_info;
         return MHD_YES;
     }
-    
+
     auto *con_info = static_cast<ConnectionInfo*>(*con_cls);
-    
-    if (strcmp(method, "POST") == 0 && strcmp(url, "/classify") == 0) {
+
+    if (strcmp(method, "POST") == 0 &&
+        (strcmp(url, "/classify") == 0 || strncmp(url, "/classify/", 10) == 0)) {
         if (*upload_data_size != 0) {
             con_info->data.append(upload_data, *upload_data_size);
             *upload_data_size = 0;
             return MHD_YES;
         }
-        
-        std::vector<unsigned char> img_data(con_info->data.begin(), con_info->data.end());
-        cv::Mat img = cv::imdecode(img_data, cv::IMREAD_COLOR);
-        
-        std::string response;
-        int status = MHD_HTTP_OK;
-        
-        if (img.empty() || nn == nullptr) {
-            response = "{\"error\":\"Failed to process image\"}";
-            status = MHD_HTTP_BAD_REQUEST;
-        } else {
-            auto vec = image_to_vector(img);
-            auto probs = nn->forward(vec);
-            response = create_json_response(probs);
-        }
-        
-        auto *resp = MHD_create_response_from_buffer(response.length(),
-                                                      (void*)response.c_str(),
-                                                      MHD_RESPMEM_MUST_COPY);
-        MHD_add_response_header(resp, "Content-Type", "application/json");
-        MHD_add_response_header(resp, "Access-Control-Allow-Origin", "*");
-        MHD_Result ret = static_cast<MHD_Result>(MHD_queue_response(connection, status, resp));
-        MHD_destroy_response(resp);
-        return ret;
-    }
-    
+
+        // Called again after the resume, with the response filled in
+        if (con_info->submitted) {
+            return send_json(connection, con_info->status, con_info->response);
+        }
+
+        std::string name = requested_model(connection, url);
+        if (name != catalog.default_name && !valid_model_name(name)) {
+            return send_json(connection, MHD_HTTP_BAD_REQUEST,
+                             "{\"error\":\"Invalid model name\"}");
+        }
+        if (models->find(name) == nullptr && stamp_file(catalog.source_for(name).model_file).size < 0) {
+            return send_json(connection, MHD_HTTP_NOT_FOUND,
+                             "{\"error\":\"Unknown model\"}");
+        }
+
+        // Park the connection so this I/O thread goes back to serving the
+        // others while the upload is decoded and classified; a model not
+        // yet resident loads on the compute pool too
+        con_info->submitted = true;
+        MHD_suspend_connection(connection);
+        // Pool jobs must not throw: loading may run out of memory and submit
+        // throws once the batcher is shutting down. Nothing has resumed the
+        // connection when either throws, so it is answered here.
+        bool posted = compute_pool->post([connection, con_info, name]() {
+            try {
+                std::shared_ptr<ServedModel> model = models->get(name);
+                if (model == nullptr) {
+                    finish_request(connection, con_info, MHD_HTTP_SERVICE_UNAVAILABLE,
+                                   "{\"error\":\"Model failed to load\"}");
+                    return;
+                }
+                classify_upload(connection, con_info, *model);
+            } catch (const std::exception& e) {
+                std::cerr << "Classification failed: " << e.what() << std::endl;
+                finish_request(connection, con_info, MHD_HTTP_INTERNAL_SERVER_ERROR,
+                               "{\"error\":\"Classification failed\"}");
+            }
+        });
+        if (!posted) {
+            finish_request(connection, con_info, MHD_HTTP_SERVICE_UNAVAILABLE,
+                           "{\"error\":\"Server is shutting down\"}");
+        }
+        return MHD_YES;
+    }
+
+    if (strcmp(method, "POST") == 0 && strcmp(url, "/admin/reload") == 0) {
+        if (!is_loopback_client(connection)) {
+            return send_json(connection, MHD_HTTP_FORBIDDEN,
+                             "{\"error\":\"Reload is only accepted from localhost\"}");
+        }
+        request_reload();
+        return send_json(connection, MHD_HTTP_ACCEPTED, "{\"status\":\"reloading\"}");
+    }
+
     if (strcmp(method, "GET") == 0 && strcmp(url, "/health") == 0) {
-        std::string response = "{\"status\":\"healthy\",\"modelLoaded\":" 
-                             + std::string(nn != nullptr ? "true" : "false") + "}";
-        auto *resp = MHD_create_response_from_buffer(response.length(),
-                                                      (void*)response.c_str(),
-                                                      MHD_RESPMEM_MUST_COPY);
-        MHD_add_response_header(resp, "Content-Type", "application/json");
-        MHD_add_response_header(resp, "Access-Control-Allow-Origin", "*");
-        MHD_Result ret = static_cast<MHD_Result>(MHD_queue_response(connection, MHD_HTTP_OK, resp));
-        MHD_destroy_response(resp);
-        return ret;
-    }
-    
+        std::shared_ptr<ServedModel> model = models->find(catalog.default_name);
+        std::string response = "{\"status\":\"healthy\",\"modelLoaded\":"
+                             + std::string(model != nullptr ? "true" : "false");
+        if (model != nullptr) response += ",\"modelVersion\":" + std::to_string(model->version);
+        response += ",\"residentBytes\":" + std::to_string(models->resident_bytes())
+                  + ",\"budgetBytes\":" + std::to_string(models->budget()) + ",\"models\":[";
+        bool first = true;
+        for (const auto& resident : models->resident()) {
+            if (!first) response += ",";
+            first = false;
+            response += "{\"name\":\"" + resident.first + "\",\"version\":"
+                      + std::to_string(resident.second->version) + ",\"bytes\":"
+                      + std::to_string(resident.second->bytes) + "}";
+        }
+        return send_json(connection, MHD_HTTP_OK, response + "]}");
+    }
+
     std::string response = "{\"error\":\"Not found\"}";
     auto *resp = MHD_create_response_from_buffer(response.length(),
                                                   (void*)response.c_str(),
@@ -125,57 +562,114 @@ static void request_completed(void *cls, struct MHD_Connection *connection,
 }
 
 int main(int argc, char* argv[]) {
-    std::string model_file = "../models/trained_model.bin";
-    std::string classes_file = "../models/classes.txt";
+    ModelSource source;
+    source.model_file = "../models/trained_model.bin";
+    source.classes_file = "../models/classes.txt";
+    source.batching.workers = 2;
     int port = 8080;
-    
-    if (argc > 1) model_file = argv[1];
-    if (argc > 2) classes_file = argv[2];
+
+    if (argc > 1) source.model_file = argv[1];
+    if (argc > 2) source.classes_file = argv[2];
     if (argc > 3) port = std::atoi(argv[3]);
-    
+    if (argc > 4) source.int8_model_file = argv[4];
+    if (argc > 5) source.batching.max_batch = std::max(1, std::atoi(argv[5]));
+    if (argc > 6) source.batching.max_wait = std::chrono::microseconds(std::max(0, std::atoi(argv[6])));
+    if (argc > 7) source.batching.workers = std::max(1, std::atoi(argv[7]));
+    // The HTTP threads only move bytes; decoding runs on the compute pool
+    unsigned int http_threads = 2;
+    if (argc > 8) http_threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[8])));
+    int compute_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (argc > 9) compute_threads = std::max(1, std::atoi(argv[9]));
+    // Model files resident at once, in MiB, before cold models are evicted
+    size_t budget_mb = 1024;
+    if (argc > 10) budget_mb = static_cast<size_t>(std::max(1, std::atoi(argv[10])));
+
+    catalog.default_name = std::filesystem::path(source.model_file).stem().string();
+    catalog.default_source = source;
+    catalog.directory = std::filesystem::path(source.model_file).parent_path().string();
+    if (catalog.directory.empty()) catalog.directory = ".";
+    catalog.int8 = !source.int8_model_file.empty();
+
     std::cout << "=== Image Classifier Server ===" << std::endl;
-    
-    std::ifstream cf(classes_file);
-    if (!cf.is_open()) {
-        std::cerr << "Could not open classes file: " << classes_file << std::endl;
+    std::cout << "SIMD kernels: " << simd_level_name(detect_simd_level())
+              << " (math: " << math_accuracy_name(math_kernels().accuracy) << ")" << std::endl;
+
+    models = std::make_unique<ModelRegistry<ServedModel>>(
+        [](const std::string& name) { return load_model(name, catalog.source_for(name), 1); },
+        [](const ServedModel& model) { return model.bytes; },
+        budget_mb << 20);
+    // The default model loads up front, so a broken one stops the server here
+    if (models->get(catalog.default_name) == nullptr) {
         return 1;
     }
-    
-    std::string line;
-    while (std::getline(cf, line)) {
-        class_names.push_back(line);
-    }
-    cf.close();
-    
-    std::cout << "Loaded " << class_names.size() << " classes" << std::endl;
-    
-    nn = new NeuralNetwork({IMG_SIZE * IMG_SIZE, 128, (int)class_names.size()});
-    nn->load(model_file);
-    
-    struct MHD_Daemon *daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY,
+    std::cout << "Serving " << catalog.default_name << " by default and other models from "
+              << catalog.directory << " on demand, within " << budget_mb << " MiB" << std::endl;
+    compute_pool = std::make_unique<ThreadPool>(compute_threads);
+    std::cout << "Batching up to " << source.batching.max_batch << " images or "
+              << source.batching.max_wait.count() << " us on " << source.batching.workers
+              << " inference threads" << std::endl;
+
+    std::signal(SIGHUP, handle_hangup);
+    std::thread reloader(reload_loop);
+
+    // A pool of I/O threads, each polling its share of the connections with
+    // epoll (no FD_SETSIZE limit); poll() where the library was built
+    // without epoll. /classify connections are suspended while they wait
+    // for the compute pool, so they never hold an I/O thread.
+    const bool epoll = MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES;
+    struct MHD_Daemon *daemon = MHD_start_daemon((epoll ? MHD_USE_EPOLL_INTERNALLY
+                                                        : MHD_USE_POLL_INTERNALLY) |
+                                                 MHD_ALLOW_SUSPEND_RESUME,
                                                  port, NULL, NULL,
                                                  &answer_to_connection, NULL,
+                                                 MHD_OPTION_THREAD_POOL_SIZE, http_threads,
                                                  MHD_OPTION_NOTIFY_COMPLETED,
                                                  &request_completed, NULL,
                                                  MHD_OPTION_END);
     if (daemon == NULL) {
         std::cerr << "Failed to start server" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(reload_mutex);
+            reload_stopping = true;
+        }
+        reload_cv.notify_one();
+        reloader.join();
         return 1;
     }
-    
-    std::cout << "Server running on http://localhost:" << port << std::endl;
+
+    std::cout << "Server running on http://localhost:" << port << " ("
+              << http_threads << " " << (epoll ? "epoll" : "poll") << " I/O threads, "
+              << compute_threads << " compute threads)" << std::endl;
     std::cout << "Endpoints:" << std::endl;
-    std::cout << "  GET  /health   - Health check" << std::endl;
-    std::cout << "  POST /classify - Classify image" << std::endl;
+    std::cout << "  GET  /health       - Health check" << std::endl;
+    std::cout << "  POST /classify     - Classify image with the default model" << std::endl;
+    std::cout << "  POST /classify/<m> - Classify image with model m (or set the X-Model header)" << std::endl;
+    std::cout << "  POST /admin/reload - Reload the resident models, from localhost only (also on SIGHUP or when their files change)" << std::endl;
     std::cout << "\nPress Enter to stop server and exit..." << std::endl;
 
     getchar();
 
     std::cout << "Shutting down server..." << std::endl;
-    MHD_stop_daemon(daemon);
+    {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        reload_stopping = true;
+    }
+    reload_cv.notify_one();
+    reloader.join();
 
-    std::cout << "Cleaning up resources..." << std::endl;
-    delete nn;
+    // Suspended connections must be resumed before the daemon stops: finish
+    // the queued decodes (later uploads get 503), then release the models,
+    // whose batchers run the batches they fed
+    compute_pool->shutdown();
+    for (const auto& resident : models->resident()) {
+        std::cout << "Served " << resident.second->batcher->requests() << " images in "
+                  << resident.second->batcher->batches() << " batches on " << resident.first
+                  << " version " << resident.second->version << std::endl;
+    }
+    std::cout << models->loads() << " model loads, " << models->evictions() << " evictions" << std::endl;
+    models->clear();
+    MHD_stop_daemon(daemon);
+    compute_pool.reset();
 
     std::cout << "Server stopped successfully. Goodbye!" << std::endl;
     return 0;
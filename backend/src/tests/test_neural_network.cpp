@@ -1,13 +1,32 @@
 #include "neural_network.h"
+#include "quantized_network.h"
+#include "sequential.h"
 #include "activation_function.h"
 #include "sigmoid_activation.h"
 #include "relu_activation.h"
 #include "tanh_activation.h"
 #include "data_buffer.h"
 #include "matrix.h"
+#include "simd_kernels.h"
+#include "int8_kernels.h"
+#include "fast_math.h"
+#include "direct_conv.h"
+#include "workspace.h"
+#include "micro_batcher.h"
+#include "thread_pool.h"
+#include "rcu_ptr.h"
+#include "model_registry.h"
 #include <iostream>
+#include <fstream>
 #include <cassert>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <sstream>
 
 // Simple test framework
 int tests_passed = 0;
@@ -54,7 +73,7 @@ TEST(test_neural_network_construction) {
 // Test Neural Network Forward Pass
 TEST(test_neural_network_forward) {
     NeuralNetwork nn({2, 3, 1});
-    std::vector<double> input = {0.5, 0.5};
+    std::vector<float> input = {0.5, 0.5};
     auto output = nn.forward(input);
 
     ASSERT_EQ(output.size(), 1);
@@ -64,8 +83,8 @@ TEST(test_neural_network_forward) {
 // Test Neural Network Training
 TEST(test_neural_network_training) {
     NeuralNetwork nn({2, 2, 1}, 0.1);
-    std::vector<double> input = {0.0, 1.0};
-    std::vector<double> target = {1.0};
+    std::vector<float> input = {0.0, 1.0};
+    std::vector<float> target = {1.0};
 
     auto output_before = nn.forward(input);
     nn.train(input, target);
@@ -75,6 +94,301 @@ TEST(test_neural_network_training) {
     ASSERT_TRUE(output_before[0] != output_after[0]);
 }
 
+// Test flat, cache-line aligned parameter storage
+TEST(test_neural_network_flat_layout) {
+    NeuralNetwork nn({4, 3, 2});
+    const auto& layers = nn.get_layers();
+
+    ASSERT_EQ(layers.size(), 2);
+    ASSERT_EQ(layers[0].weight_count(), 12);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(layers[0].weights()) % 64, 0);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(layers[0].biases()) % 64, 0);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(layers[1].weights()) % 64, 0);
+}
+
+// Test save/load round trip and column-major training path
+TEST(test_neural_network_save_load_column_major) {
+    const std::string path = "test_model_roundtrip.bin";
+    NeuralNetwork original({3, 4, 2}, 0.1);
+    original.save(path);
+
+    NeuralNetwork copy({3, 4, 2}, 0.1);
+    copy.load(path);
+    copy.set_column_major_copy(true);
+    std::remove(path.c_str());
+
+    std::vector<float> input = {0.2, 0.7, 0.1};
+    std::vector<float> target = {0.0, 1.0};
+    ASSERT_NEAR(original.forward(input)[0], copy.forward(input)[0], 1e-6);
+
+    original.train(input, target);
+    copy.train(input, target);
+    ASSERT_NEAR(original.forward(input)[1], copy.forward(input)[1], 1e-6);
+    ASSERT_NEAR(copy.get_layers()[1].weights_cm[1], copy.get_layers()[1].row(1)[0], 1e-6);
+}
+
+// Test models record their precision and double/legacy files load into float
+TEST(test_neural_network_precision_conversion) {
+    const std::string path = "test_model_precision.bin";
+    NeuralNetwork<double> reference({3, 4, 2}, 0.1);
+    reference.save(path);
+
+    NeuralNetwork<> converted({3, 4, 2}, 0.1);
+    converted.load(path);
+    std::vector<double> xd = {0.2, 0.7, 0.1};
+    std::vector<float> xf = {0.2f, 0.7f, 0.1f};
+    ASSERT_NEAR(converted.forward(xf)[0], reference.forward(xd)[0], 1e-5);
+    ASSERT_EQ(converted.get_layers()[0].weights()[1],
+              static_cast<float>(reference.get_layers()[0].weights()[1]));
+
+    // Legacy layout: no precision header, double parameters
+    auto write_legacy = [&](std::vector<int> sizes, size_t drop_bytes) {
+        std::ostringstream legacy;
+        size_t count = sizes.size();
+        double lr = 0.1;
+        legacy.write((const char*)&count, sizeof(size_t));
+        legacy.write((const char*)sizes.data(), sizes.size() * sizeof(int));
+        legacy.write((const char*)&lr, sizeof(double));
+        for (const auto& dl : reference.get_layers()) {
+            legacy.write((const char*)dl.weights(), dl.weight_count() * sizeof(double));
+            legacy.write((const char*)dl.biases(), dl.outputs * sizeof(double));
+        }
+        std::string bytes = legacy.str();
+        std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size() - drop_bytes);
+    };
+    write_legacy({3, 4, 2}, 0);
+    NeuralNetwork<> from_legacy({3, 4, 2}, 0.1);
+    ASSERT_TRUE(from_legacy.load(path));
+    ASSERT_NEAR(from_legacy.forward(xf)[1], reference.forward(xd)[1], 1e-5);
+
+    // Truncated weights and impossible sizes fail and keep the loaded network
+    write_legacy({3, 4, 2}, 8);
+    ASSERT_TRUE(!from_legacy.load(path));
+    write_legacy({3, 1 << 30, 2}, 0);
+    ASSERT_TRUE(!from_legacy.load(path));
+    write_legacy({3, -4, 2}, 0);
+    ASSERT_TRUE(!from_legacy.load(path));
+    ASSERT_NEAR(from_legacy.forward(xf)[1], reference.forward(xd)[1], 1e-5);
+
+    // float models widen into a double network
+    converted.save(path);
+    NeuralNetwork<double> widened({3, 4, 2}, 0.1);
+    widened.load(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(widened.get_layers()[1].biases()[0],
+              static_cast<double>(converted.get_layers()[1].biases()[0]));
+}
+
+// Test the self-describing model file: the architecture, activation and
+// class names come from the file, and a mapped network runs in place
+TEST(test_model_file_memory_mapped) {
+    const std::string path = "test_model_mapped.bin";
+    NeuralNetwork original({5, 7, 3}, 0.1, ActivationType::TANH);
+    original.set_class_names({"cat", "dog", "bird"});
+    original.save(path);
+
+    ModelFileHeader header;
+    std::ifstream(path, std::ios::binary).read((char*)&header, sizeof(header));
+    ASSERT_EQ(header.magic, MODEL_FILE_MAGIC);
+    ASSERT_EQ(header.version, MODEL_FILE_VERSION);
+    ASSERT_EQ(header.input_size, 5u);
+    ASSERT_EQ(header.tensor_offset % MODEL_FILE_ALIGNMENT, 0u);
+
+    auto mapped = NeuralNetwork<>::from_file(path);
+    ASSERT_TRUE(mapped != nullptr);
+    ASSERT_TRUE(mapped->is_memory_mapped());
+    ASSERT_TRUE(mapped->get_layer_sizes() == original.get_layer_sizes());
+    ASSERT_TRUE(mapped->getActivationType() == ActivationType::TANH);
+    ASSERT_EQ(mapped->get_class_names()[2], std::string("bird"));
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mapped->get_layers()[1].biases()) % 64, 0u);
+
+    std::vector<float> x = {0.1f, 0.5f, 0.9f, 0.3f, 0.2f};
+    ASSERT_TRUE(mapped->forward(x) == original.forward(x));
+
+    // Training copies the weights out of the read-only pages first
+    mapped->train(x, {0.0f, 1.0f, 0.0f});
+    ASSERT_TRUE(!mapped->is_memory_mapped());
+    ASSERT_TRUE(mapped->forward(x) != original.forward(x));
+
+    // Out-of-range fields are corrupt even without the checksum: an unknown
+    // activation, and a hidden layer size above INT_MAX
+    auto open_patched = [&](std::streamoff offset, uint32_t value) {
+        original.save(path);
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(offset);
+            file.write((const char*)&value, sizeof(value));
+        }
+        return MappedModelFile::open(path, false);
+    };
+    ASSERT_TRUE(open_patched(0, MODEL_FILE_MAGIC) != nullptr);
+    ASSERT_TRUE(open_patched(offsetof(ModelFileHeader, activation), 9) == nullptr);
+    ASSERT_TRUE(open_patched(sizeof(ModelFileHeader) + 4, 0x80000007u) == nullptr);
+    original.save(path);
+
+    // A flipped byte fails the checksum, which mapping skips unless asked
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(header.tensor_offset + 4);
+        char byte = static_cast<char>(file.get());
+        file.seekp(header.tensor_offset + 4);
+        file.put(static_cast<char>(~byte));
+    }
+    ASSERT_TRUE(MappedModelFile::open(path) != nullptr);
+    ASSERT_TRUE(MappedModelFile::open(path, true) == nullptr);
+    ASSERT_TRUE(NeuralNetwork<>::from_file(path, false) == nullptr);
+    std::remove(path.c_str());
+    ASSERT_TRUE(NeuralNetwork<>::from_file(path) == nullptr);
+}
+
+// Test batched forward pass matches per-sample forward
+TEST(test_neural_network_forward_batch) {
+    NeuralNetwork nn({6, 5, 3});
+    const size_t batch_size = 7;
+    std::vector<float> batch;
+    for (size_t i = 0; i < batch_size * 6; i++) {
+        batch.push_back((i % 11) / 10.0f);
+    }
+
+    auto probs = nn.forward_batch(batch, batch_size);
+    ASSERT_EQ(probs.size(), batch_size * 3);
+
+    std::vector<float> last(batch.end() - 6, batch.end());
+    auto single = nn.forward(last);
+    ASSERT_NEAR(probs[6 * 3 + 0], single[0], 1e-6);
+    ASSERT_NEAR(probs[6 * 3 + 2], single[2], 1e-6);
+
+    std::vector<float> first(batch.begin(), batch.begin() + 6);
+    ASSERT_NEAR(probs[1], nn.forward(first)[1], 1e-6);
+}
+
+// Separable toy problem shared by the training tests
+static void make_toy_dataset(std::vector<std::vector<float>>& inputs,
+                             std::vector<std::vector<float>>& targets) {
+    for (int i = 0; i < 40; i++) {
+        float x = (i % 10) / 10.0f;
+        float y = (i / 10) / 4.0f;
+        inputs.push_back({x, y});
+        targets.push_back(x > y ? std::vector<float>{1.0f, 0.0f} : std::vector<float>{0.0f, 1.0f});
+    }
+}
+
+static double toy_loss(NeuralNetwork<>& nn, const std::vector<std::vector<float>>& inputs,
+                       const std::vector<std::vector<float>>& targets) {
+    double total = 0.0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        auto out = nn.forward(inputs[i]);
+        for (size_t j = 0; j < out.size(); j++) total += -targets[i][j] * std::log(out[j] + 1e-10);
+    }
+    return total / inputs.size();
+}
+
+// Test mini-batch SGD lowers the loss on a separable toy problem
+TEST(test_neural_network_minibatch_training) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+
+    double before = toy_loss(nn, inputs, targets);
+    nn.train_batch(inputs, targets, 50, 8);
+    ASSERT_TRUE(toy_loss(nn, inputs, targets) < before);
+}
+
+// Test a training step reports the loss and accuracy of its own forward pass
+TEST(test_neural_network_train_step_result) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+
+    std::vector<float> x, y;
+    size_t expected_correct = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        x.insert(x.end(), inputs[i].begin(), inputs[i].end());
+        y.insert(y.end(), targets[i].begin(), targets[i].end());
+        if (nn.predict_class(inputs[i]) == (targets[i][0] > 0.5 ? 0 : 1)) expected_correct++;
+    }
+    double expected_loss = toy_loss(nn, inputs, targets) * inputs.size();
+
+    StepResult result = nn.train_step(x.data(), y.data(), inputs.size());
+    ASSERT_NEAR(result.loss, expected_loss, 1e-4);
+    ASSERT_EQ(result.correct, expected_correct);
+
+    double single_before = toy_loss(nn, {inputs[0]}, {targets[0]});
+    ASSERT_NEAR(nn.train(inputs[0], targets[0]), single_before, 1e-6);
+}
+
+// Test the arena hands out aligned slices, rewinds with a scope and tracks its peak
+TEST(test_workspace_arena) {
+    Workspace ws;
+    ws.reserve(4096);
+    size_t capacity = ws.capacity_bytes();
+    {
+        Workspace::Scope scope(ws);
+        double* a = ws.alloc<double>(3);
+        float* b = ws.alloc<float>(5);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % CACHE_LINE_SIZE, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(b) % CACHE_LINE_SIZE, 0u);
+        ASSERT_EQ(ws.used_bytes(), 2 * CACHE_LINE_SIZE);
+    }
+    ASSERT_EQ(ws.used_bytes(), 0u);
+    ASSERT_EQ(ws.peak_bytes(), 2 * CACHE_LINE_SIZE);
+
+    bool threw = false;
+    try {
+        ws.alloc<double>(capacity);
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+}
+
+// Test repeated training steps run inside the preallocated arena
+TEST(test_neural_network_workspace_reuse) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+
+    std::vector<float> x, y;
+    for (size_t i = 0; i < 16; i++) {
+        x.insert(x.end(), inputs[i].begin(), inputs[i].end());
+        y.insert(y.end(), targets[i].begin(), targets[i].end());
+    }
+
+    nn.train_step(x.data(), y.data(), 16);
+    size_t grows = thread_workspace().grow_count();
+    for (int step = 0; step < 5; step++) {
+        nn.train_step(x.data(), y.data(), 16);
+        nn.train(inputs[step], targets[step]);
+    }
+    ASSERT_EQ(thread_workspace().grow_count(), grows);
+    ASSERT_EQ(thread_workspace().used_bytes(), 0u);
+    ASSERT_TRUE(nn.workspace_peak_bytes() > 0);
+}
+
+// Test data-parallel training (private gradients + tree reduction)
+TEST(test_neural_network_parallel_training) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+
+    double before = toy_loss(nn, inputs, targets);
+    nn.train_batch_parallel(inputs, targets, 50, 3, 8);
+    ASSERT_TRUE(toy_loss(nn, inputs, targets) < before);
+}
+
+// Test lock-free asynchronous training and its throughput report
+TEST(test_neural_network_hogwild_training) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+
+    double before = toy_loss(nn, inputs, targets);
+    TrainingStats stats = nn.train_hogwild(inputs, targets, 30, 3, 2);
+    ASSERT_TRUE(toy_loss(nn, inputs, targets) < before);
+    ASSERT_EQ(stats.samples, 30 * inputs.size());
+    ASSERT_TRUE(stats.samples_per_second > 0.0);
+}
+
 // Test Activation Functions - Sigmoid
 TEST(test_sigmoid_activation) {
     SigmoidActivation sigmoid;
@@ -202,6 +516,234 @@ TEST(test_matrix_transpose) {
     ASSERT_EQ(transposed[2][1], 6);
 }
 
+// Test Matrix Multiplication (blocked GEMM) against a naive triple loop
+TEST(test_matrix_multiplication) {
+    Matrix<int> a(2, 3, 0);
+    Matrix<int> b(3, 2, 0);
+    a[0][0] = 1; a[0][1] = 2; a[0][2] = 3;
+    a[1][0] = 4; a[1][1] = 5; a[1][2] = 6;
+    b[0][0] = 7; b[0][1] = 8;
+    b[1][0] = 9; b[1][1] = 10;
+    b[2][0] = 11; b[2][1] = 12;
+
+    Matrix<int> c = a * b;
+    ASSERT_EQ(c.getRows(), 2);
+    ASSERT_EQ(c.getCols(), 2);
+    ASSERT_EQ(c[0][0], 58);
+    ASSERT_EQ(c[1][1], 154);
+
+    // Sizes that cross every register and cache tile boundary
+    const size_t m = 131, k = 300, n = 70;
+    Matrix<double> x(m, k), y(k, n);
+    for (size_t i = 0; i < x.size(); i++) x.data()[i] = ((i * 7) % 13) / 13.0 - 0.5;
+    for (size_t i = 0; i < y.size(); i++) y.data()[i] = ((i * 5) % 17) / 17.0 - 0.5;
+
+    Matrix<double> fast = x.multiply(y, 3);
+    double max_err = 0.0;
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            double ref = 0.0;
+            for (size_t p = 0; p < k; p++) ref += x[i][p] * y[p][j];
+            max_err = std::max(max_err, std::abs(ref - fast[i][j]));
+        }
+    }
+    ASSERT_NEAR(max_err, 0.0, 1e-9);
+}
+
+// Test Matrix bounds-checked access
+TEST(test_matrix_at) {
+    Matrix<int> mat(2, 2, 7);
+    ASSERT_EQ(mat.at(1, 1), 7);
+
+    bool threw = false;
+    try {
+        mat.at(2, 0);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+}
+
+// Compare every SIMD level the CPU supports against the scalar kernels
+template<typename T>
+static void check_simd_kernels(T tol) {
+    constexpr size_t NR = 64 / sizeof(T);  // packed B panel width
+    const SimdKernels<T>& ref = simd_kernels_for<T>(SimdLevel::SCALAR);
+    const size_t n = 37, rows = 6;
+    std::vector<T> a(n), b(n), W(rows * n), packed_a(5 * 4), packed_b(5 * NR);
+    for (size_t i = 0; i < n; i++) { a[i] = std::sin(i * 0.3); b[i] = std::cos(i * 0.7); }
+    for (size_t i = 0; i < W.size(); i++) W[i] = ((i * 13) % 7) / 7.0 - 0.4;
+    for (size_t i = 0; i < packed_a.size(); i++) packed_a[i] = i * 0.1 - 1.0;
+    for (size_t i = 0; i < packed_b.size(); i++) packed_b[i] = 0.5 - i * 0.05;
+
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        const SimdKernels<T>& k = simd_kernels_for<T>(level);
+        ASSERT_NEAR(k.dot(a.data(), b.data(), n), ref.dot(a.data(), b.data(), n), tol);
+
+        std::vector<T> y1(rows, T(1)), y2(rows, T(1));
+        k.gemv(W.data(), a.data(), y1.data(), rows, n);
+        ref.gemv(W.data(), a.data(), y2.data(), rows, n);
+        ASSERT_NEAR(y1[5], y2[5], tol);
+
+        std::vector<T> c1(4 * 20, T(0)), c2(4 * 20, T(0));
+        k.gemm_micro(5, packed_a.data(), packed_b.data(), c1.data(), 20, 3, NR - 1, T(2));
+        ref.gemm_micro(5, packed_a.data(), packed_b.data(), c2.data(), 20, 3, NR - 1, T(2));
+        ASSERT_NEAR(c1[2 * 20 + NR - 2], c2[2 * 20 + NR - 2], tol);
+        ASSERT_EQ(c1[3 * 20], T(0));
+
+        std::vector<T> r1(a), r2(a), d1(b), d2(b);
+        k.relu(r1.data(), n);
+        ref.relu(r2.data(), n);
+        k.tanh_grad(a.data(), d1.data(), n);
+        ref.tanh_grad(a.data(), d2.data(), n);
+        ASSERT_TRUE(r1 == r2);
+        ASSERT_NEAR(d1[n - 1], d2[n - 1], tol);
+    }
+}
+
+TEST(test_simd_kernels_match_scalar) {
+    std::cout << "  (detected: " << simd_level_name(detect_simd_level()) << ")" << std::endl;
+    check_simd_kernels<double>(1e-12);
+    check_simd_kernels<float>(1e-4f);
+}
+
+// Every integer kernel, with and without VNNI, returns the exact scalar sums
+TEST(test_int8_kernels_match_scalar) {
+    std::cout << "  (detected: " << int8_kernels().name << ")" << std::endl;
+    const Int8Kernels& ref = int8_kernels_for(SimdLevel::SCALAR);
+    const size_t cols = 133, rows = 7;  // odd sizes exercise every tail
+    std::vector<uint8_t> x(cols);
+    std::vector<int8_t> W(rows * cols);
+    for (size_t i = 0; i < cols; i++) x[i] = static_cast<uint8_t>((i * 37) % (INT8_ACTIVATION_MAX + 1));
+    for (size_t i = 0; i < W.size(); i++) W[i] = static_cast<int8_t>((i * 53) % 255 - 127);
+
+    std::vector<int32_t> expected(rows);
+    ref.gemv(W.data(), cols, x.data(), expected.data(), rows, cols);
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        for (bool vnni : {false, true}) {
+            const Int8Kernels& k = int8_kernels_for(level, vnni);
+            std::vector<int32_t> y(rows, -1);
+            k.gemv(W.data(), cols, x.data(), y.data(), rows, cols);
+            ASSERT_TRUE(y == expected);
+            ASSERT_EQ(k.dot(x.data(), W.data() + cols, cols), expected[1]);
+        }
+    }
+}
+
+// Test every level and tier of the fast math kernels stays within the
+// documented error and saturates cleanly
+TEST(test_fast_math_accuracy) {
+    std::vector<float> xs;
+    for (int i = -200; i <= 200; i++) xs.push_back(i * 0.37f);  // 401 points, odd tails
+
+    for (MathAccuracy accuracy : {MathAccuracy::PRECISE, MathAccuracy::FAST, MathAccuracy::FASTEST}) {
+        const float tol = accuracy == MathAccuracy::FASTEST ? 2e-5f : 4e-7f;
+        for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            const MathKernels& k = math_kernels_for(level, accuracy);
+            std::vector<float> e(xs.size()), s = xs, t = xs;
+            k.exp(xs.data(), e.data(), xs.size());
+            k.sigmoid(s.data(), s.size());
+            k.tanh(t.data(), t.size());
+            double worst = 0.0;  // relative error
+            for (size_t i = 0; i < xs.size(); i++) {
+                double x = xs[i];
+                double ex = std::exp(x), sig = 1.0 / (1.0 + std::exp(-x)), th = std::tanh(x);
+                if (ex > 1e-30) worst = std::max(worst, std::fabs(e[i] - ex) / ex);
+                if (sig > 1e-30) worst = std::max(worst, std::fabs(s[i] - sig) / sig);
+                worst = std::max(worst, std::fabs(t[i] - th) / std::max(std::fabs(th), 1e-3));
+            }
+            ASSERT_TRUE(worst <= tol);
+            ASSERT_TRUE(s.front() >= 0.0f && s.front() < 1e-30f);
+            ASSERT_EQ(s.back(), 1.0f);
+            ASSERT_EQ(t.front(), -1.0f);
+            ASSERT_EQ(t.back(), 1.0f);
+
+            std::vector<float> logits = {1000.0f, 999.0f, -1000.0f, 3.0f, 2.0f, 1.0f, 0.0f, -1.0f, 0.5f};
+            k.softmax(logits.data(), 1, logits.size());
+            float sum = std::accumulate(logits.begin(), logits.end(), 0.0f);
+            ASSERT_TRUE(std::fabs(sum - 1.0f) < 1e-5f);
+            ASSERT_TRUE(std::fabs(logits[0] - 1.0f / (1.0f + std::exp(-1.0f))) < 1e-5f);
+            ASSERT_EQ(logits[2], 0.0f);
+        }
+    }
+}
+
+// Test the INT8 network tracks the float network it was quantized from
+TEST(test_quantized_network) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+    nn.train_batch(inputs, targets, 50, 8);
+
+    QuantizedNetwork qnet = QuantizedNetwork::quantize(nn, inputs);
+    ASSERT_EQ(qnet.weight_bytes(), 2u * 8u + 8u * 2u);
+
+    std::vector<int> labels;
+    for (const auto& t : targets) labels.push_back(t[0] > 0.5f ? 0 : 1);
+    QuantizationReport report = compare_quantized(nn, qnet, inputs, labels);
+    ASSERT_EQ(report.samples, inputs.size());
+    ASSERT_TRUE(report.max_prob_error < 0.05);
+    ASSERT_TRUE(report.agreement >= 0.9);
+
+    const char* path = "test_quantized_model.bin";
+    ASSERT_TRUE(qnet.save(path));
+    QuantizedNetwork loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_TRUE(loaded.forward(inputs[3]) == qnet.forward(inputs[3]));
+
+    // Corrupt headers are rejected, not allocated or run: a huge layer
+    // count, a huge layer and layers that do not chain (the second layer's
+    // inputs follow the 8-byte file header and the first 96-byte layer)
+    auto corrupt = [&](std::streamoff offset, uint32_t value) {
+        qnet.save(path);
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(offset);
+        file.write((const char*)&value, sizeof(value));
+        file.close();
+        return loaded.load(path);
+    };
+    ASSERT_TRUE(!corrupt(4, 0xFFFFFFFFu));
+    ASSERT_TRUE(!corrupt(12, 1u << 30));
+    ASSERT_TRUE(!corrupt(104, 7));
+    ASSERT_TRUE(loaded.forward(inputs[3]) == qnet.forward(inputs[3]));
+    std::remove(path);
+
+    ASSERT_TRUE(!loaded.load("test_quantized_missing.bin"));
+    ASSERT_TRUE(!qnet.save("test_missing_dir/model.int8.bin"));
+}
+
+// Test quantization-aware training learns activation ranges that are saved
+// with the model and used by the INT8 network instead of calibration
+TEST(test_quantization_aware_training) {
+    NeuralNetwork nn({2, 8, 2}, 0.5);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+    ASSERT_TRUE(nn.get_activation_ranges().empty());
+
+    nn.set_quantization_aware(true);
+    double before = toy_loss(nn, inputs, targets);
+    nn.train_batch(inputs, targets, 50, 8);
+    ASSERT_TRUE(toy_loss(nn, inputs, targets) < before);
+
+    const auto& ranges = nn.get_activation_ranges();
+    ASSERT_EQ(ranges.size(), 2u);
+    ASSERT_TRUE(ranges[0].min >= 0.0f && ranges[0].max <= 1.0f);
+    ASSERT_TRUE(ranges[1].min > 0.0f && ranges[1].max < 1.0f);  // sigmoid outputs
+
+    const char* path = "test_qat_model.bin";
+    nn.save(path);
+    NeuralNetwork loaded({2, 8, 2});
+    loaded.load(path);
+    std::remove(path);
+    ASSERT_EQ(loaded.get_activation_ranges().size(), 2u);
+    ASSERT_EQ(loaded.get_activation_ranges()[1].max, ranges[1].max);
+
+    QuantizedNetwork qnet = QuantizedNetwork::quantize(loaded, {});
+    QuantParams expected = ranges[1].params();
+    ASSERT_EQ(qnet.get_layers()[1].input_scale, expected.scale);
+    ASSERT_EQ(qnet.get_layers()[1].input_zero_point, expected.zero_point);
+}
+
 // Test Neural Network with Different Activation Types
 TEST(test_neural_network_with_different_activations) {
     NeuralNetwork nn_sigmoid({2, 3, 1}, 0.01, ActivationType::SIGMOID);
@@ -213,6 +755,744 @@ TEST(test_neural_network_with_different_activations) {
     ASSERT_TRUE(nn_tanh.getActivationType() == ActivationType::TANH);
 }
 
+// Test the hidden layers apply the configured activation in forward and training
+TEST(test_neural_network_uses_configured_activation) {
+    std::vector<float> x = {0.3f, -0.8f, 0.5f};
+    for (ActivationType type : {ActivationType::SIGMOID, ActivationType::RELU, ActivationType::TANH}) {
+        NeuralNetwork nn({3, 4, 2}, 0.5, type);
+        auto act = ActivationFactory::create<float>(type);
+        const auto& layers = nn.get_layers();
+
+        // Reference forward pass with the scalar virtual activate()
+        std::vector<float> hidden(4), logits(2);
+        for (int j = 0; j < 4; j++) {
+            float z = layers[0].biases()[j];
+            for (int i = 0; i < 3; i++) z += layers[0].row(j)[i] * x[i];
+            hidden[j] = act->activate(z);
+        }
+        for (int j = 0; j < 2; j++) {
+            logits[j] = layers[1].biases()[j];
+            for (int i = 0; i < 4; i++) logits[j] += layers[1].row(j)[i] * hidden[i];
+        }
+        float p0 = 1.0f / (1.0f + std::exp(logits[1] - logits[0]));
+        ASSERT_NEAR(nn.forward(x)[0], p0, 1e-5);
+    }
+
+    NeuralNetwork relu({2, 8, 2}, 0.1, ActivationType::RELU);
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+    double before = toy_loss(relu, inputs, targets);
+    relu.train_batch(inputs, targets, 50, 8);
+    ASSERT_TRUE(toy_loss(relu, inputs, targets) < before);
+
+    // The INT8 copy keeps the activation
+    QuantizedNetwork qnet = QuantizedNetwork::quantize(relu, inputs);
+    ASSERT_TRUE(qnet.getActivationType() == ActivationType::RELU);
+    ASSERT_NEAR(qnet.forward(inputs[5])[0], relu.forward(inputs[5])[0], 0.05);
+}
+
+// Test a Sequential network with NeuralNetwork's weights computes the same
+// outputs and the same update
+TEST(test_sequential_matches_neural_network) {
+    NeuralNetwork nn({3, 5, 4, 2}, 0.5, ActivationType::TANH);
+    Sequential<> net(3, 0.5);
+    net.add<Dense>(5).add<Activation>(ActivationType::TANH)
+       .add<Dense>(4).add<Activation>(ActivationType::TANH)
+       .add<Dense>(2).add<Softmax>();
+    ASSERT_EQ(net.get_plan().steps.size(), 3u);  // every Dense fused with what follows
+
+    auto sync = [&]() {
+        for (size_t i = 0; i < 3; i++) {
+            auto& dense = static_cast<Dense<float>&>(*net.get_layers()[2 * i]);
+            dense.get_block().params = nn.get_layers()[i].params;
+        }
+    };
+    sync();
+
+    std::vector<float> x = {0.1f, -0.4f, 0.9f, 0.5f, 0.2f, -0.7f};
+    std::vector<float> y = {1.0f, 0.0f, 0.0f, 1.0f};
+    std::vector<float> expected = nn.forward_batch(x.data(), 2);
+    std::vector<float> actual = net.forward_batch(x.data(), 2);
+    float worst = 0.0f;
+    for (size_t i = 0; i < expected.size(); i++) worst = std::max(worst, std::fabs(expected[i] - actual[i]));
+    ASSERT_TRUE(worst < 1e-6f);
+
+    StepResult a = nn.train_step(x.data(), y.data(), 2);
+    StepResult b = net.train_step(x.data(), y.data(), 2);
+    ASSERT_NEAR(a.loss, b.loss, 1e-5);
+    expected = nn.forward_batch(x.data(), 2);
+    actual = net.forward_batch(x.data(), 2);
+    worst = 0.0f;
+    for (size_t i = 0; i < expected.size(); i++) worst = std::max(worst, std::fabs(expected[i] - actual[i]));
+    ASSERT_TRUE(worst < 1e-5f);
+}
+
+// Test a network with a different activation per layer and dropout trains,
+// and that its inference plan leaves the dropout out
+TEST(test_sequential_heterogeneous_layers) {
+    Sequential<> net(2, 0.1);
+    net.add<Dense>(16).add<Activation>(ActivationType::RELU).add<Dropout>(0.1)
+       .add<Dense>(8).add<Activation>(ActivationType::TANH)
+       .add<Dense>(2).add<Softmax>();
+    ASSERT_EQ(net.output_size(), 2u);
+    ASSERT_EQ(net.get_plan().steps.size(), 3u);
+    ASSERT_EQ(net.get_plan(true).steps.size(), 4u);
+
+    std::vector<std::vector<float>> inputs, targets;
+    make_toy_dataset(inputs, targets);
+    auto loss = [&]() {
+        double total = 0.0;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            auto out = net.forward(inputs[i]);
+            for (size_t j = 0; j < out.size(); j++) total += -targets[i][j] * std::log(out[j] + 1e-10);
+        }
+        return total / inputs.size();
+    };
+    double before = loss();
+    net.train_batch(inputs, targets, 100, 8);
+    ASSERT_TRUE(loss() < before);
+    ASSERT_TRUE(net.forward(inputs[7]) == net.forward(inputs[7]));
+
+    bool rejected = false;
+    try {
+        net.add<Activation>(ActivationType::SOFTMAX);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected);
+}
+
+// Largest gap between the layer's backward pass and central differences of
+// L = sum(out * r), over every 7th input and every param_stride-th
+// parameter. Parameters are fetched for every write, so layers that cache
+// repacked filters see each change.
+static double gradient_check_error(Layer<double>& layer, const Shape& in_shape,
+                                   std::vector<double>& x, size_t n, size_t param_stride) {
+    Shape shape = layer.build(in_shape);
+    std::vector<double> r(n * shape.size()), out(r.size()), dx(x.size());
+    for (size_t i = 0; i < r.size(); i++) r[i] = std::cos(1.3 * i);
+    auto loss = [&]() {
+        layer.forward(x.data(), out.data(), n, false);
+        return std::inner_product(out.begin(), out.end(), r.begin(), 0.0);
+    };
+    std::vector<double> param_grads(layer.parameter_count(), 0.0);
+    layer.forward(x.data(), out.data(), n, false);
+    layer.backward(x.data(), out.data(), r.data(), dx.data(), n, param_grads.data());
+
+    double err = 0.0;
+    const double h = 1e-6;
+    for (size_t i = 0; i < x.size(); i += 7) {
+        double saved = x[i];
+        x[i] = saved + h;
+        double up = loss();
+        x[i] = saved - h;
+        double down = loss();
+        x[i] = saved;
+        err = std::max(err, std::fabs((up - down) / (2 * h) - dx[i]));
+    }
+    for (size_t i = 0; i < param_grads.size(); i += param_stride) {
+        double saved = layer.parameters()[i];
+        layer.parameters()[i] = saved + h;
+        double up = loss();
+        layer.parameters()[i] = saved - h;
+        double down = loss();
+        layer.parameters()[i] = saved;
+        err = std::max(err, std::fabs((up - down) / (2 * h) - param_grads[i]));
+    }
+    return err;
+}
+
+// Test Conv2D and pooling against direct loops, and their backward passes
+// against finite differences of L = sum(out * r)
+TEST(test_conv_and_pooling_layers) {
+    const Shape in_shape = {2, 5, 6};
+    const size_t n = 3;
+    std::vector<double> x(n * in_shape.size());
+    for (size_t i = 0; i < x.size(); i++) x[i] = std::sin(0.7 * i) + 0.1 * (i % 5);
+
+    Conv2D<double> conv(3, 3, 2, 1);
+    conv.set_num_threads(2);
+    Shape out_shape = conv.build(in_shape);
+    ASSERT_TRUE(out_shape == (Shape{3, 3, 3}));
+    std::vector<double> y(n * out_shape.size());
+    conv.forward(x.data(), y.data(), n, false);
+
+    const DenseLayer<double>& p = conv.get_block();
+    double worst = 0.0;
+    for (size_t s = 0; s < n; s++) {
+        for (int f = 0; f < 3; f++) {
+            for (int oy = 0; oy < 3; oy++) {
+                for (int ox = 0; ox < 3; ox++) {
+                    double acc = p.biases()[f];
+                    for (int c = 0; c < 2; c++) {
+                        for (int ky = 0; ky < 3; ky++) {
+                            for (int kx = 0; kx < 3; kx++) {
+                                int iy = oy * 2 - 1 + ky, ix = ox * 2 - 1 + kx;
+                                if (iy < 0 || iy >= 5 || ix < 0 || ix >= 6) continue;
+                                acc += p.row(f)[(c * 3 + ky) * 3 + kx] * x[s * 60 + (c * 5 + iy) * 6 + ix];
+                            }
+                        }
+                    }
+                    worst = std::max(worst, std::fabs(acc - y[s * 27 + (f * 3 + oy) * 3 + ox]));
+                }
+            }
+        }
+    }
+    ASSERT_TRUE(worst < 1e-12);
+
+    MaxPool2D<double> max_pool(2);
+    AvgPool2D<double> avg_pool(3, 1);
+    ASSERT_TRUE(max_pool.build(in_shape) == (Shape{2, 2, 3}));
+    ASSERT_TRUE(avg_pool.build(in_shape) == (Shape{2, 3, 4}));
+    std::vector<double> pooled(n * 12);
+    max_pool.forward(x.data(), pooled.data(), n, false);
+    ASSERT_EQ(pooled[0], std::max({x[0], x[1], x[6], x[7]}));
+
+    // Finite-difference check of every layer's input (and conv weight) gradient
+    for (Layer<double>* layer : std::initializer_list<Layer<double>*>{&conv, &max_pool, &avg_pool}) {
+        ASSERT_TRUE(gradient_check_error(*layer, in_shape, x, n, 5) < 1e-6);
+    }
+}
+
+// Test both Winograd tile sizes against im2col (odd sizes leave partial
+// tiles), the AUTO choice by shape, and that weight changes are picked up
+TEST(test_winograd_conv) {
+    const Shape in_shape = {9, 11, 10};
+    const size_t n = 3;
+    auto max_error = [&](auto zero, ConvAlgorithm algorithm, int padding) {
+        using T = decltype(zero);
+        std::vector<T> x(n * in_shape.size());
+        for (size_t i = 0; i < x.size(); i++) x[i] = T(std::sin(0.37 * i) + 0.2 * (i % 7));
+
+        Conv2D<T> reference(5, 3, 1, padding), winograd(5, 3, 1, padding);
+        reference.set_algorithm(ConvAlgorithm::IM2COL);
+        winograd.set_algorithm(algorithm);
+        reference.build(in_shape);
+        Shape out_shape = winograd.build(in_shape);
+        winograd.set_num_threads(2);
+
+        std::vector<T> expected(n * out_shape.size()), actual(expected.size());
+        double worst = 0.0, scale = 0.0;
+        for (int round = 0; round < 2; round++) {
+            // The second round changes the weights after a forward pass
+            std::copy(reference.parameters(), reference.parameters() + reference.parameter_count(),
+                      winograd.parameters());
+            reference.forward(x.data(), expected.data(), n, false);
+            winograd.forward(x.data(), actual.data(), n, false);
+            for (size_t i = 0; i < expected.size(); i++) {
+                worst = std::max(worst, std::fabs(double(expected[i]) - double(actual[i])));
+                scale = std::max(scale, std::fabs(double(expected[i])));
+            }
+            reference.parameters()[7] += T(0.5);
+        }
+        return worst / scale;
+    };
+    for (int padding : {0, 1}) {
+        ASSERT_TRUE(max_error(0.0f, ConvAlgorithm::WINOGRAD_2X2, padding) < 1e-5);
+        ASSERT_TRUE(max_error(0.0f, ConvAlgorithm::WINOGRAD_4X4, padding) < 1e-4);
+        ASSERT_TRUE(max_error(0.0, ConvAlgorithm::WINOGRAD_4X4, padding) < 1e-12);
+    }
+
+    Conv2D<> wide(32, 3, 1, 1), narrow(16, 3, 1, 1), strided(16, 3, 2, 1), shallow(16, 3, 1, 1);
+    wide.build({32, 32, 32});
+    narrow.build({16, 16, 16});
+    strided.build({16, 16, 16});
+    shallow.build({1, 16, 16});
+    ASSERT_TRUE(wide.get_algorithm() == ConvAlgorithm::WINOGRAD_4X4);
+    ASSERT_TRUE(narrow.get_algorithm() == ConvAlgorithm::DIRECT);
+    ASSERT_TRUE(strided.get_algorithm() == ConvAlgorithm::DIRECT);
+    ASSERT_TRUE(shallow.get_algorithm() == ConvAlgorithm::IM2COL);
+
+    bool rejected = false;
+    try {
+        strided.set_algorithm(ConvAlgorithm::WINOGRAD_2X2);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected);
+    ASSERT_TRUE(strided.get_algorithm() == ConvAlgorithm::DIRECT);
+}
+
+// Test the direct NCHWc path against im2col for channel counts off the
+// 8-lane blocks, larger kernels and strides, and its portable kernel
+// against the detected one
+TEST(test_direct_conv) {
+    struct Case { Shape input; int filters, kernel, stride, padding; };
+    const Case cases[] = {
+        {{3, 12, 13}, 5, 3, 1, 1},
+        {{9, 11, 10}, 17, 3, 2, 0},
+        {{4, 9, 9}, 8, 5, 2, 2},
+        {{10, 6, 7}, 3, 1, 1, 0}
+    };
+    auto max_error = [&](auto zero, const Case& c) {
+        using T = decltype(zero);
+        const size_t n = 2;
+        std::vector<T> x(n * c.input.size());
+        for (size_t i = 0; i < x.size(); i++) x[i] = T(std::cos(0.23 * i) + 0.1 * (i % 3));
+
+        Conv2D<T> reference(c.filters, c.kernel, c.stride, c.padding);
+        Conv2D<T> direct(c.filters, c.kernel, c.stride, c.padding);
+        reference.set_algorithm(ConvAlgorithm::IM2COL);
+        direct.set_algorithm(ConvAlgorithm::DIRECT);
+        reference.build(c.input);
+        Shape out_shape = direct.build(c.input);
+        std::copy(reference.parameters(), reference.parameters() + reference.parameter_count(),
+                  direct.parameters());
+
+        // Several threads race to repack the filters the copy made stale
+        std::vector<std::vector<T>> concurrent(3, std::vector<T>(n * out_shape.size()));
+        std::vector<std::thread> threads;
+        for (std::vector<T>& out : concurrent) {
+            threads.emplace_back([&]() { direct.forward(x.data(), out.data(), n, false); });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        std::vector<T> expected(n * out_shape.size()), actual(expected.size());
+        reference.forward(x.data(), expected.data(), n, false);
+        direct.forward(x.data(), actual.data(), n, false);
+        double worst = 0.0;
+        for (size_t i = 0; i < expected.size(); i++) {
+            worst = std::max(worst, std::fabs(double(expected[i]) - double(actual[i])));
+            for (const std::vector<T>& out : concurrent) {
+                worst = std::max(worst, std::fabs(double(out[i]) - double(actual[i])));
+            }
+        }
+        return worst;
+    };
+    for (const Case& c : cases) {
+        ASSERT_TRUE(max_error(0.0f, c) < 1e-4);
+        ASSERT_TRUE(max_error(0.0, c) < 1e-12);
+    }
+
+    // One 3x3 output row of 11 pixels over 10 channels (two blocks)
+    const int channels = 10, width = 13;
+    std::vector<float> input(2 * 3 * width * CONV_BLOCK), weights(channels * 9 * CONV_BLOCK);
+    std::vector<float> bias(CONV_BLOCK), portable(11 * CONV_BLOCK), detected(portable.size());
+    for (size_t i = 0; i < input.size(); i++) input[i] = std::sin(0.1f * i);
+    for (size_t i = 0; i < weights.size(); i++) weights[i] = std::cos(0.3f * i);
+    for (int l = 0; l < CONV_BLOCK; l++) bias[l] = 0.1f * l;
+    DirectConvArgs<float> args{input.data(), input.size() / 2, width * size_t(CONV_BLOCK),
+                               weights.data(), bias.data(), portable.data(), channels, 3, 1, 11};
+    direct_conv_kernels_for<float>(SimdLevel::SCALAR).row(args);
+    args.output = detected.data();
+    direct_conv_kernels<float>().row(args);
+    double worst = 0.0;
+    for (size_t i = 0; i < portable.size(); i++) {
+        worst = std::max(worst, std::fabs(double(portable[i]) - double(detected[i])));
+    }
+    ASSERT_TRUE(worst < 1e-4);
+}
+
+// Test DepthwiseConv2D against direct loops, DepthwiseConv2D and
+// GlobalAvgPool2D backward against finite differences of L = sum(out * r),
+// the portable depthwise row kernel against the detected one, and that
+// pointwise layers stay on GEMM
+TEST(test_depthwise_separable_layers) {
+    const Shape in_shape = {3, 7, 21};
+    const size_t n = 2;
+    std::vector<double> x(n * in_shape.size());
+    for (size_t i = 0; i < x.size(); i++) x[i] = std::sin(0.41 * i) + 0.1 * (i % 4);
+
+    for (int stride : {1, 2}) {
+        DepthwiseConv2D<double> depthwise(3, stride, 1);
+        depthwise.set_num_threads(2);
+        Shape out_shape = depthwise.build(in_shape);
+        const int oh = out_shape.height, ow = out_shape.width;
+        std::vector<double> y(n * out_shape.size());
+        depthwise.forward(x.data(), y.data(), n, false);
+
+        const DenseLayer<double>& p = depthwise.get_block();
+        double worst = 0.0;
+        for (size_t s = 0; s < n; s++) {
+            for (int c = 0; c < 3; c++) {
+                for (int oy = 0; oy < oh; oy++) {
+                    for (int ox = 0; ox < ow; ox++) {
+                        double acc = p.biases()[c];
+                        for (int ky = 0; ky < 3; ky++) {
+                            for (int kx = 0; kx < 3; kx++) {
+                                int iy = oy * stride - 1 + ky, ix = ox * stride - 1 + kx;
+                                if (iy < 0 || iy >= 7 || ix < 0 || ix >= 21) continue;
+                                acc += p.row(c)[ky * 3 + kx] * x[s * 441 + (c * 7 + iy) * 21 + ix];
+                            }
+                        }
+                        worst = std::max(worst, std::fabs(acc - y[((s * 3 + c) * oh + oy) * ow + ox]));
+                    }
+                }
+            }
+        }
+        ASSERT_TRUE(worst < 1e-12);
+    }
+
+    DepthwiseConv2D<double> depthwise(3, 2, 1), unpadded(2);
+    GlobalAvgPool2D<double> global_pool;
+    ASSERT_TRUE(global_pool.build(in_shape) == Shape::flat(3));
+    for (Layer<double>* layer : std::initializer_list<Layer<double>*>{&depthwise, &unpadded, &global_pool}) {
+        ASSERT_TRUE(gradient_check_error(*layer, in_shape, x, n, 2) < 1e-6);
+    }
+
+    // One 5x5 row of 45 pixels, wide enough for every vector chunk and a tail
+    std::vector<float> plane(5 * 50), taps(25), portable(45), detected(45);
+    for (size_t i = 0; i < plane.size(); i++) plane[i] = std::sin(0.1f * i);
+    for (size_t i = 0; i < taps.size(); i++) taps[i] = std::cos(0.3f * i);
+    double worst = 0.0;
+    for (int stride : {1, 2}) {
+        const int width = stride == 1 ? 45 : 23;
+        direct_conv_kernels_for<float>(SimdLevel::SCALAR).depthwise_row(
+            plane.data(), 50, taps.data(), 0.5f, portable.data(), 5, stride, width);
+        direct_conv_kernels<float>().depthwise_row(
+            plane.data(), 50, taps.data(), 0.5f, detected.data(), 5, stride, width);
+        for (int i = 0; i < width; i++) {
+            worst = std::max(worst, std::fabs(double(portable[i]) - double(detected[i])));
+        }
+    }
+    ASSERT_TRUE(worst < 1e-4);
+
+    PointwiseConv2D<> pointwise(64);
+    ASSERT_TRUE(pointwise.build({32, 16, 16}) == (Shape{64, 16, 16}));
+    ASSERT_TRUE(pointwise.get_algorithm() == ConvAlgorithm::IM2COL);
+}
+
+// Synthetic 1 x 8 x 8 images: a horizontal (class 0) or vertical (class 1) bar
+static void make_bar_dataset(std::vector<std::vector<float>>& inputs,
+                             std::vector<std::vector<float>>& targets) {
+    for (int i = 0; i < 32; i++) {
+        std::vector<float> img(64, 0.0f);
+        bool vertical = i % 2 == 1;
+        int pos = (i / 2) % 8;
+        for (int k = 0; k < 8; k++) img[vertical ? k * 8 + pos : pos * 8 + k] = 1.0f;
+        inputs.push_back(img);
+        targets.push_back(vertical ? std::vector<float>{0.0f, 1.0f} : std::vector<float>{1.0f, 0.0f});
+    }
+}
+
+// Test a small CNN trains, fuses conv + activation, skips Flatten and
+// survives a save/load round trip
+TEST(test_sequential_cnn) {
+    Sequential<> net(Shape{1, 8, 8}, 0.1);
+    net.add<Conv2D>(4, 3, 1, 1).add<Activation>(ActivationType::RELU).add<MaxPool2D>(2)
+       .add<Flatten>().add<Dense>(2).add<Softmax>();
+    net.set_num_threads(2);
+    ASSERT_EQ(net.get_plan().steps.size(), 3u);  // conv + relu, pool, dense + softmax
+    ASSERT_EQ(net.get_plan(true).steps.size(), 3u);
+
+    std::vector<std::vector<float>> inputs, targets;
+    make_bar_dataset(inputs, targets);
+    auto accuracy = [&](const Sequential<>& model) {
+        int correct = 0;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (model.predict_class(inputs[i]) == (targets[i][1] > 0.5f ? 1 : 0)) correct++;
+        }
+        return correct / static_cast<double>(inputs.size());
+    };
+    net.train_batch(inputs, targets, 60, 8);
+    ASSERT_TRUE(accuracy(net) >= 0.9);
+
+    const char* path = "test_cnn_model.bin";
+    net.set_class_names({"horizontal", "vertical"});
+    ASSERT_TRUE(net.save(path));
+    ASSERT_TRUE(is_graph_model_file(path));
+    auto loaded = Sequential<>::from_file(path);
+    ASSERT_TRUE(loaded != nullptr);
+    ASSERT_TRUE(loaded->get_class_names() == net.get_class_names());
+    ASSERT_TRUE(loaded->forward(inputs[3]) == net.forward(inputs[3]));
+    ASSERT_TRUE(Sequential<double>::from_file(path) == nullptr);
+
+    // A flipped byte fails the checksum; version 1 files (no checksum) load
+    std::string bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::string flipped = bytes;
+    flipped[bytes.size() / 2] = static_cast<char>(~flipped[bytes.size() / 2]);
+    std::ofstream(path, std::ios::binary).write(flipped.data(), flipped.size());
+    ASSERT_TRUE(Sequential<>::from_file(path) == nullptr);
+    std::string v1 = bytes.substr(0, bytes.size() - sizeof(uint64_t));
+    const uint32_t version = 1;
+    std::memcpy(&v1[sizeof(uint32_t)], &version, sizeof(version));
+    std::ofstream(path, std::ios::binary).write(v1.data(), v1.size());
+    loaded = Sequential<>::from_file(path);
+    ASSERT_TRUE(loaded != nullptr);
+    ASSERT_TRUE(loaded->forward(inputs[3]) == net.forward(inputs[3]));
+    std::remove(path);
+}
+
+// Test a MobileNet-style graph of depthwise-separable blocks trains, fuses
+// each convolution with its activation and survives a save/load round trip
+TEST(test_sequential_mobile) {
+    Sequential<> net(Shape{1, 8, 8}, 0.1);
+    net.add<DepthwiseConv2D>(3, 1, 1).add<Activation>(ActivationType::TANH)
+       .add<PointwiseConv2D>(8).add<Activation>(ActivationType::TANH)
+       .add<DepthwiseConv2D>(3, 2, 1).add<Activation>(ActivationType::TANH)
+       .add<PointwiseConv2D>(16).add<Activation>(ActivationType::TANH)
+       .add<GlobalAvgPool2D>().add<Dense>(2).add<Softmax>();
+    net.set_num_threads(2);
+    ASSERT_EQ(net.get_plan().steps.size(), 6u);
+
+    std::vector<std::vector<float>> inputs, targets;
+    make_bar_dataset(inputs, targets);
+    auto loss = [&]() {
+        double total = 0.0;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            std::vector<float> out = net.forward(inputs[i]);
+            total -= std::log(std::max(out[targets[i][1] > 0.5f ? 1 : 0], 1e-7f));
+        }
+        return total;
+    };
+    // With the small initialization four stages deep the bars are barely
+    // told apart in 40 epochs, so check the gradient reached the first
+    // layer rather than that the loss fell (the layer gradients themselves
+    // are checked in test_depthwise_separable_layers)
+    Layer<float>& first = *net.get_layers().front();
+    std::vector<float> initial(first.parameters(), first.parameters() + first.parameter_count());
+    net.train_batch(inputs, targets, 40, 8);
+    ASSERT_TRUE(std::isfinite(loss()));
+    ASSERT_TRUE(!std::equal(initial.begin(), initial.end(), first.parameters()));
+
+    const char* path = "test_mobile_model.bin";
+    net.save(path);
+    auto loaded = Sequential<>::from_file(path);
+    ASSERT_TRUE(loaded != nullptr);
+    ASSERT_TRUE(loaded->summary() == net.summary());
+    ASSERT_TRUE(loaded->forward(inputs[5]) == net.forward(inputs[5]));
+    std::remove(path);
+}
+
+// Test several threads can run inference on one const network at once
+TEST(test_neural_network_concurrent_inference) {
+    NeuralNetwork<> trained({16, 12, 3}, 0.1, ActivationType::TANH);
+    const NeuralNetwork<>& nn = trained;
+    std::vector<float> inputs(10 * 16);
+    for (size_t i = 0; i < inputs.size(); i++) inputs[i] = std::cos(0.3f * i);
+    const std::vector<float> expected = nn.forward_batch(inputs.data(), 10);
+
+    std::vector<std::thread> threads;
+    std::vector<int> matches(4, 0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 50; round++) {
+                matches[t] += nn.forward_batch(inputs.data(), 10) == expected;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    ASSERT_EQ(std::accumulate(matches.begin(), matches.end(), 0), 200);
+}
+
+// Test concurrent requests are batched without exceeding max_batch, each
+// caller gets its own output row, a lone request is released by max_wait
+// and batch errors reach every caller
+TEST(test_micro_batcher) {
+    NeuralNetwork<> nn({16, 8, 4}, 0.1, ActivationType::RELU);
+    std::mutex sizes_mutex;
+    std::vector<size_t> sizes;
+    MicroBatcher::Options options;
+    options.max_batch = 8;
+    options.max_wait = std::chrono::milliseconds(20);
+    options.workers = 2;
+    MicroBatcher batcher(16, 4, [&](const float* in, size_t n, float* out) {
+        std::vector<float> probs = nn.forward_batch(in, n);
+        std::copy(probs.begin(), probs.end(), out);
+        std::lock_guard<std::mutex> lock(sizes_mutex);
+        sizes.push_back(n);
+    }, options);
+
+    const int clients = 24;
+    std::vector<std::vector<float>> inputs(clients, std::vector<float>(16));
+    std::vector<std::vector<float>> results(clients);
+    for (int c = 0; c < clients; c++) {
+        for (int i = 0; i < 16; i++) inputs[c][i] = std::sin(0.5f * (c * 16 + i));
+    }
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c]() { results[c] = batcher.submit(inputs[c]).get(); });
+    }
+    for (std::thread& t : threads) t.join();
+
+    double worst = 0.0;
+    for (int c = 0; c < clients; c++) {
+        std::vector<float> expected = nn.forward(inputs[c]);
+        for (int j = 0; j < 4; j++) worst = std::max(worst, double(std::fabs(expected[j] - results[c][j])));
+    }
+    ASSERT_TRUE(worst < 1e-6);
+    ASSERT_EQ(batcher.requests(), static_cast<size_t>(clients));
+    ASSERT_TRUE(batcher.batches() < static_cast<size_t>(clients));
+    ASSERT_TRUE(*std::max_element(sizes.begin(), sizes.end()) <= options.max_batch);
+
+    auto start = std::chrono::steady_clock::now();
+    batcher.submit(inputs[0]).get();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start >= options.max_wait);
+
+    MicroBatcher failing(16, 4, [](const float*, size_t, float*) {
+        throw std::runtime_error("model unavailable");
+    }, options);
+    bool rethrown = false;
+    try {
+        failing.submit(inputs[0]).get();
+    } catch (const std::runtime_error&) {
+        rethrown = true;
+    }
+    ASSERT_TRUE(rethrown);
+
+    // A warmup that throws on one worker fails the constructor
+    std::atomic<int> warmups{0};
+    options.warmup = [&]() {
+        if (warmups++ == 1) throw std::bad_alloc();
+    };
+    bool warmup_rethrown = false;
+    try {
+        MicroBatcher cold(16, 4, [](const float*, size_t, float*) {}, options);
+    } catch (const std::bad_alloc&) {
+        warmup_rethrown = true;
+    }
+    ASSERT_TRUE(warmup_rethrown);
+    ASSERT_EQ(warmups.load(), 2);
+}
+
+// Test the pool runs every posted job before shutdown returns and refuses
+// later ones, with jobs handing their work on to the batcher's callbacks
+// as the server does
+TEST(test_thread_pool) {
+    MicroBatcher::Options options;
+    options.max_batch = 4;
+    options.max_wait = std::chrono::milliseconds(1);
+    MicroBatcher batcher(1, 1, [](const float* in, size_t n, float* out) {
+        for (size_t i = 0; i < n; i++) out[i] = 2.0f * in[i];
+    }, options);
+
+    ThreadPool pool(3);
+    ASSERT_EQ(pool.size(), 3u);
+    std::atomic<int> done{0};
+    std::atomic<int> wrong{0};
+    int posted = 0;
+    for (int i = 0; i < 40; i++) {
+        posted += pool.post([&, i]() {
+            batcher.submit({float(i)}, [&, i](std::vector<float> out, std::exception_ptr error) {
+                if (error || out[0] != 2.0f * i) wrong++;
+                done++;
+            });
+        });
+    }
+    pool.shutdown();
+    ASSERT_EQ(posted, 40);
+    ASSERT_TRUE(!pool.post([]() {}));
+    while (done < 40) std::this_thread::yield();
+    ASSERT_EQ(wrong.load(), 0);
+}
+
+// Test readers always see a whole, live value while a writer keeps
+// replacing it, and that a copy a reader holds outlives its replacement
+TEST(test_rcu_ptr) {
+    struct Versioned {
+        int version;
+        int check;
+        std::atomic<int>* destroyed;
+        Versioned(int v, std::atomic<int>* d) : version(v), check(v * 7), destroyed(d) {}
+        ~Versioned() { check = -1; (*destroyed)++; }
+    };
+    std::atomic<int> destroyed{0};
+    RcuPtr<Versioned> current(std::make_shared<Versioned>(0, &destroyed));
+
+    std::shared_ptr<Versioned> held = current.load();
+    std::atomic<bool> writing{true};
+    std::atomic<int> torn{0};
+    std::atomic<int> went_back{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; t++) {
+        readers.emplace_back([&]() {
+            int last = 0;
+            while (writing) {
+                std::shared_ptr<Versioned> value = current.load();
+                if (value->check != value->version * 7) torn++;
+                if (value->version < last) went_back++;
+                last = value->version;
+            }
+        });
+    }
+    for (int v = 1; v <= 200; v++) {
+        current.store(std::make_shared<Versioned>(v, &destroyed));
+    }
+    writing = false;
+    for (std::thread& reader : readers) reader.join();
+
+    ASSERT_EQ(torn.load(), 0);
+    ASSERT_EQ(went_back.load(), 0);
+    ASSERT_EQ(current.load()->version, 200);
+    ASSERT_EQ(destroyed.load(), 199);  // version 0 is still held
+    ASSERT_EQ(held->check, 0);
+    held.reset();
+    ASSERT_EQ(destroyed.load(), 200);
+}
+
+TEST(test_model_registry) {
+    struct Model {
+        std::string name;
+        size_t bytes;
+    };
+    std::atomic<int> loaded{0};
+    ModelRegistry<Model> registry(
+        [&](const std::string& name) -> std::shared_ptr<Model> {
+            if (name == "missing") return nullptr;
+            loaded++;
+            return std::make_shared<Model>(Model{name, name == "large" ? size_t(500) : size_t(40)});
+        },
+        [](const Model& model) { return model.bytes; },
+        100);
+
+    // Loaded on first use only
+    ASSERT_TRUE(registry.find("a") == nullptr);
+    std::shared_ptr<Model> a = registry.get("a");
+    ASSERT_TRUE(registry.get("a") == a);
+    ASSERT_EQ(loaded.load(), 1);
+    ASSERT_TRUE(registry.get("missing") == nullptr);
+    ASSERT_EQ(registry.loads(), size_t(1));
+
+    // b and a fit; c evicts the least recently used, which is b since a was
+    // used after it
+    registry.get("b");
+    registry.get("a");
+    registry.get("c");
+    ASSERT_TRUE(registry.find("b") == nullptr);
+    ASSERT_TRUE(registry.find("a") == a);
+    ASSERT_EQ(registry.resident_bytes(), size_t(80));
+    ASSERT_EQ(registry.evictions(), size_t(1));
+    ASSERT_TRUE(registry.resident().front().first == "c");
+
+    // A model over the whole budget stays alone; the evicted one still
+    // serves whoever holds it
+    registry.get("large");
+    ASSERT_EQ(registry.resident().size(), size_t(1));
+    ASSERT_TRUE(a->name == "a");
+    registry.replace("large", std::make_shared<Model>(Model{"large", 60}));
+    ASSERT_EQ(registry.resident_bytes(), size_t(60));
+
+    // A reload only lands on the model it was loaded from
+    std::shared_ptr<Model> large = registry.find("large");
+    ASSERT_TRUE(registry.replace_if("large", large, std::make_shared<Model>(Model{"large", 50})));
+    ASSERT_TRUE(!registry.replace_if("large", large, std::make_shared<Model>(Model{"large", 40})));
+    large = registry.find("large");
+    ASSERT_TRUE(registry.evict("large"));
+    ASSERT_TRUE(!registry.replace_if("large", large, std::make_shared<Model>(Model{"large", 40})));
+    ASSERT_TRUE(registry.find("large") == nullptr);
+
+    // Concurrent misses of one name load it once
+    registry.clear();
+    loaded = 0;
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong{0};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 200; i++) {
+                std::shared_ptr<Model> model = registry.get(i % 2 ? "x" : "y");
+                if (model->name != (i % 2 ? "x" : "y")) wrong++;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    ASSERT_EQ(wrong.load(), 0);
+    ASSERT_EQ(loaded.load(), 2);
+}
+
 // Test Enum Class
 TEST(test_enum_class) {
     ActivationType type1 = ActivationType::SIGMOID;
@@ -230,6 +1510,17 @@ int main() {
     RUN_TEST(test_neural_network_construction);
     RUN_TEST(test_neural_network_forward);
     RUN_TEST(test_neural_network_training);
+    RUN_TEST(test_neural_network_flat_layout);
+    RUN_TEST(test_neural_network_save_load_column_major);
+    RUN_TEST(test_neural_network_precision_conversion);
+    RUN_TEST(test_model_file_memory_mapped);
+    RUN_TEST(test_neural_network_forward_batch);
+    RUN_TEST(test_neural_network_minibatch_training);
+    RUN_TEST(test_neural_network_train_step_result);
+    RUN_TEST(test_workspace_arena);
+    RUN_TEST(test_neural_network_workspace_reuse);
+    RUN_TEST(test_neural_network_parallel_training);
+    RUN_TEST(test_neural_network_hogwild_training);
     RUN_TEST(test_sigmoid_activation);
     RUN_TEST(test_relu_activation);
     RUN_TEST(test_tanh_activation);
@@ -241,7 +1532,28 @@ int main() {
     RUN_TEST(test_matrix_subtraction);
     RUN_TEST(test_matrix_scalar_multiplication);
     RUN_TEST(test_matrix_transpose);
+    RUN_TEST(test_matrix_multiplication);
+    RUN_TEST(test_matrix_at);
+    RUN_TEST(test_simd_kernels_match_scalar);
+    RUN_TEST(test_int8_kernels_match_scalar);
+    RUN_TEST(test_fast_math_accuracy);
+    RUN_TEST(test_quantized_network);
+    RUN_TEST(test_quantization_aware_training);
     RUN_TEST(test_neural_network_with_different_activations);
+    RUN_TEST(test_neural_network_uses_configured_activation);
+    RUN_TEST(test_sequential_matches_neural_network);
+    RUN_TEST(test_sequential_heterogeneous_layers);
+    RUN_TEST(test_conv_and_pooling_layers);
+    RUN_TEST(test_winograd_conv);
+    RUN_TEST(test_direct_conv);
+    RUN_TEST(test_depthwise_separable_layers);
+    RUN_TEST(test_sequential_cnn);
+    RUN_TEST(test_sequential_mobile);
+    RUN_TEST(test_neural_network_concurrent_inference);
+    RUN_TEST(test_micro_batcher);
+    RUN_TEST(test_thread_pool);
+    RUN_TEST(test_rcu_ptr);
+    RUN_TEST(test_model_registry);
     RUN_TEST(test_enum_class);
 
     std::cout << "\n==================================" << std::endl;
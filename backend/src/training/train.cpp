@@ -1,27 +1,33 @@
 #include "neural_network.h"
+#include "sequential.h"
+#include "quantized_network.h"
+#include "simd_kernels.h"
+#include "fast_math.h"
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <numeric>
+#include <random>
 
 namespace fs = std::filesystem;
 
 struct Dataset {
-    std::vector<std::vector<double>> images;
+    std::vector<std::vector<float>> images;
     std::vector<int> labels;
     std::vector<std::string> class_names;
 };
 
-std::vector<double> image_to_vector(const cv::Mat& img, int target_size = 32) {
+std::vector<float> image_to_vector(const cv::Mat& img, int target_size = 32) {
     cv::Mat resized, gray;
     cv::resize(img, resized, cv::Size(target_size, target_size));
     cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
     
-    std::vector<double> vec;
+    std::vector<float> vec;
     for (int i = 0; i < gray.rows; i++) {
         for (int j = 0; j < gray.cols; j++) {
-            vec.push_back(gray.at<uchar>(i, j) / 255.0);
+            vec.push_back(gray.at<uchar>(i, j) / 255.0f);
         }
     }
     return vec;
@@ -67,28 +73,114 @@ Dataset load_dataset(const std::string& data_dir, int img_size = 32) {
     return dataset;
 }
 
-std::vector<double> one_hot_encode(int label, int num_classes) {
-    std::vector<double> encoded(num_classes, 0.0);
-    encoded[label] = 1.0;
+std::vector<float> one_hot_encode(int label, int num_classes) {
+    std::vector<float> encoded(num_classes, 0.0f);
+    encoded[label] = 1.0f;
     return encoded;
 }
 
+// Top-1 accuracy in percent of a network with forward_batch(const float*, n)
+template<typename Net>
+double evaluate(Net& net, const Dataset& dataset) {
+    int correct = 0;
+    const size_t eval_batch = 64;
+    const size_t num_classes = dataset.class_names.size();
+    std::vector<float> batch;
+    for (size_t start = 0; start < dataset.images.size(); start += eval_batch) {
+        size_t count = std::min(eval_batch, dataset.images.size() - start);
+        batch.clear();
+        for (size_t i = start; i < start + count; i++) {
+            batch.insert(batch.end(), dataset.images[i].begin(), dataset.images[i].end());
+        }
+
+        auto probs = net.forward_batch(batch.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            auto row = probs.begin() + i * num_classes;
+            int predicted = std::max_element(row, row + num_classes) - row;
+            if (predicted == dataset.labels[start + i]) correct++;
+        }
+    }
+    return 100.0 * correct / dataset.images.size();
+}
+
+void save_class_file(const std::vector<std::string>& class_names) {
+    std::ofstream class_file("../models/classes.txt");
+    for (const auto& name : class_names) {
+        class_file << name << std::endl;
+    }
+    class_file.close();
+    std::cout << "Class names saved to ../models/classes.txt" << std::endl;
+}
+
+// Layer graph on the 1 x size x size image. "cnn" is two conv + pool
+// stages and a dense head; "mobile" is a stem convolution, two
+// depthwise-separable blocks and global average pooling.
+void train_cnn(const Dataset& dataset, const std::vector<std::vector<float>>& targets,
+               const std::string& model_file, const std::string& mode, int img_size, int epochs,
+               int batch_size, double learning_rate, ActivationType activation, int threads) {
+    const int classes = static_cast<int>(dataset.class_names.size());
+    Sequential<> cnn(Shape{1, img_size, img_size}, learning_rate);
+    if (mode == "mobile") {
+        cnn.add<Conv2D>(16, 3, 1, 1).add<Activation>(activation)
+           .add<DepthwiseConv2D>(3, 2, 1).add<Activation>(activation)
+           .add<PointwiseConv2D>(32).add<Activation>(activation)
+           .add<DepthwiseConv2D>(3, 2, 1).add<Activation>(activation)
+           .add<PointwiseConv2D>(64).add<Activation>(activation)
+           .add<GlobalAvgPool2D>()
+           .add<Dense>(classes).add<Softmax>();
+    } else {
+        cnn.add<Conv2D>(8, 3, 1, 1).add<Activation>(activation).add<MaxPool2D>(2)
+           .add<Conv2D>(16, 3, 1, 1).add<Activation>(activation).add<MaxPool2D>(2)
+           .add<Flatten>()
+           .add<Dense>(128).add<Activation>(activation)
+           .add<Dense>(classes).add<Softmax>();
+    }
+    cnn.set_num_threads(threads);
+    std::cout << cnn.summary() << std::endl;
+
+    std::cout << "Training..." << std::endl;
+    cnn.train_batch(dataset.images, targets, epochs, batch_size);
+
+    std::cout << "\nEvaluating on training set..." << std::endl;
+    std::cout << "Training Accuracy: " << evaluate(cnn, dataset) << "%" << std::endl;
+
+    cnn.set_class_names(dataset.class_names);
+    cnn.save(model_file);
+    std::cout << "INT8 quantization covers dense networks only; skipped for the CNN" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     std::string data_dir = "../data/train";
     std::string model_file = "../models/trained_model.bin";
     int img_size = 32;
     int epochs = 100;
+    int batch_size = 32;
+    std::string mode = "sgd";  // sgd | qat | sync | hogwild | cnn | mobile
     
     if (argc > 1) data_dir = argv[1];
     if (argc > 2) model_file = argv[2];
     if (argc > 3) img_size = std::atoi(argv[3]);
     if (argc > 4) epochs = std::atoi(argv[4]);
+    if (argc > 5) batch_size = std::max(1, std::atoi(argv[5]));
+    if (argc > 6) mode = argv[6];
+    ActivationType activation = ActivationType::SIGMOID;
+    if (argc > 7) {
+        std::string name = argv[7];
+        if (name == "relu") activation = ActivationType::RELU;
+        else if (name == "tanh") activation = ActivationType::TANH;
+    }
     
     std::cout << "=== Neural Network Trainer ===" << std::endl;
     std::cout << "Data directory: " << data_dir << std::endl;
     std::cout << "Model output: " << model_file << std::endl;
     std::cout << "Image size: " << img_size << "x" << img_size << std::endl;
     std::cout << "Epochs: " << epochs << std::endl;
+    std::cout << "Batch size: " << batch_size << std::endl;
+    std::cout << "Training mode: " << mode << std::endl;
+    std::cout << "Hidden activation: " << activation << std::endl;
+    std::cout << "SIMD kernels: " << simd_level_name(detect_simd_level())
+              << " (math: " << math_accuracy_name(math_kernels().accuracy) << ")" << std::endl;
+    std::cout << "Precision: " << scalar_type_name(NeuralNetwork<>::scalar_type) << std::endl;
     std::cout << std::endl;
     
     std::cout << "Loading dataset..." << std::endl;
@@ -103,11 +195,24 @@ int main(int argc, char* argv[]) {
     std::cout << "Number of classes: " << dataset.class_names.size() << std::endl;
     std::cout << std::endl;
     
-    std::vector<std::vector<double>> targets;
+    std::vector<std::vector<float>> targets;
     for (int label : dataset.labels) {
         targets.push_back(one_hot_encode(label, dataset.class_names.size()));
     }
     
+    // Updates use the mean batch gradient, so the per-sample rate of 0.01
+    // is scaled linearly with the batch size
+    double learning_rate = 0.01 * batch_size;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (mode == "cnn" || mode == "mobile") {
+        train_cnn(dataset, targets, model_file, mode, img_size, epochs, batch_size,
+                  learning_rate, activation, threads);
+        save_class_file(dataset.class_names);
+        std::cout << "\nTraining complete!" << std::endl;
+        return 0;
+    }
+
     int input_size = img_size * img_size;
     int hidden_size = 128;
     int output_size = dataset.class_names.size();
@@ -116,29 +221,48 @@ int main(int argc, char* argv[]) {
     std::cout << "Architecture: " << input_size << " -> " << hidden_size << " -> " << output_size << std::endl;
     std::cout << std::endl;
     
-    NeuralNetwork nn({input_size, hidden_size, output_size}, 0.01);
+    NeuralNetwork nn({input_size, hidden_size, output_size}, learning_rate, activation);
     
     std::cout << "Training..." << std::endl;
-    nn.train_batch(dataset.images, targets, epochs);
-    
-    std::cout << "\nEvaluating on training set..." << std::endl;
-    int correct = 0;
-    for (size_t i = 0; i < dataset.images.size(); i++) {
-        int predicted = nn.predict_class(dataset.images[i]);
-        if (predicted == dataset.labels[i]) correct++;
+    if (mode == "sync") {
+        nn.train_batch_parallel(dataset.images, targets, epochs, threads, batch_size);
+    } else if (mode == "hogwild") {
+        nn.train_hogwild(dataset.images, targets, epochs, threads, batch_size);
+    } else {
+        // qat: mini-batch SGD on simulated int8 weights and activations
+        nn.set_quantization_aware(mode == "qat");
+        nn.train_batch(dataset.images, targets, epochs, batch_size);
     }
     
-    double accuracy = 100.0 * correct / dataset.images.size();
-    std::cout << "Training Accuracy: " << accuracy << "%" << std::endl;
+    std::cout << "Workspace peak: " << nn.workspace_peak_bytes() / 1024.0 << " KiB" << std::endl;
+
+    std::cout << "\nEvaluating on training set..." << std::endl;
+    std::cout << "Training Accuracy: " << evaluate(nn, dataset) << "%" << std::endl;
     
+    nn.set_class_names(dataset.class_names);
     nn.save(model_file);
-    
-    std::ofstream class_file("../models/classes.txt");
-    for (const auto& name : dataset.class_names) {
-        class_file << name << std::endl;
+
+    // Post-training INT8 quantization, calibrated on a random sample of the
+    // training images and checked against the float model on all of them
+    const size_t calibration_size = 256;
+    std::vector<size_t> order(dataset.images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(std::random_device{}()));
+    std::vector<std::vector<float>> calibration;
+    for (size_t i = 0; i < std::min(calibration_size, order.size()); i++) {
+        calibration.push_back(dataset.images[order[i]]);
     }
-    class_file.close();
-    std::cout << "Class names saved to ../models/classes.txt" << std::endl;
+
+    if (nn.get_activation_ranges().empty()) {
+        std::cout << "\nQuantizing to INT8 (" << calibration.size() << " calibration images)..." << std::endl;
+    } else {
+        std::cout << "\nQuantizing to INT8 (activation ranges learned in training)..." << std::endl;
+    }
+    QuantizedNetwork qnet = QuantizedNetwork::quantize(nn, calibration);
+    print_quantization_report(compare_quantized(nn, qnet, dataset.images, dataset.labels));
+    qnet.save(fs::path(model_file).replace_extension(".int8.bin").string());
+    
+    save_class_file(dataset.class_names);
     
     std::cout << "\nTraining complete!" << std::endl;
     
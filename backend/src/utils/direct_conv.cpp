@@ -0,0 +1,273 @@
+#include "direct_conv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int B = CONV_BLOCK;
+
+// ---------- Portable: R pixels x 8 lanes of plain loops ----------
+
+template<typename T, int R>
+void conv_pixels_portable(const DirectConvArgs<T>& a, int ox) {
+    T acc[R][B];
+    for (int r = 0; r < R; r++) {
+        for (int l = 0; l < B; l++) acc[r][l] = a.bias[l];
+    }
+
+    const int kernel = a.kernel;
+    const size_t step = static_cast<size_t>(a.stride) * B;
+    const size_t row_stride = a.row_stride;
+    const T* w = a.weights;
+    for (int c = 0; c < a.channels; c++) {
+        const T* in = a.input + (c / B) * a.channel_stride + c % B + ox * step;
+        for (int ky = 0; ky < kernel; ky++) {
+            for (int kx = 0; kx < kernel; kx++, w += B) {
+                const T* px = in + ky * row_stride + kx * B;
+                for (int r = 0; r < R; r++) {
+                    const T v = px[r * step];
+                    for (int l = 0; l < B; l++) acc[r][l] += v * w[l];
+                }
+            }
+        }
+    }
+
+    T* out = a.output + static_cast<size_t>(ox) * B;
+    for (int r = 0; r < R; r++) {
+        for (int l = 0; l < B; l++) out[r * B + l] = acc[r][l];
+    }
+}
+
+template<typename T>
+void conv_row_portable(const DirectConvArgs<T>& a) {
+    int ox = 0;
+    for (; ox + 4 <= a.out_width; ox += 4) conv_pixels_portable<T, 4>(a, ox);
+    for (; ox < a.out_width; ox++) conv_pixels_portable<T, 1>(a, ox);
+}
+
+// Tap by tap over the whole row, which the compiler vectorizes at stride 1
+template<typename T>
+void depthwise_row_portable(const T* in, size_t row_stride, const T* w, T bias, T* out,
+                            int kernel, int stride, int out_width) {
+    std::fill(out, out + out_width, bias);
+    for (int ky = 0; ky < kernel; ky++) {
+        for (int kx = 0; kx < kernel; kx++) {
+            const T tap = w[ky * kernel + kx];
+            const T* row = in + ky * row_stride + kx;
+            if (stride == 1) {
+                for (int ox = 0; ox < out_width; ox++) out[ox] += tap * row[ox];
+            } else {
+                for (int ox = 0; ox < out_width; ox++) out[ox] += tap * row[ox * stride];
+            }
+        }
+    }
+}
+
+#ifdef CNN_X86
+
+// ---------- AVX2 + FMA: one (float) or two (double) registers per pixel ----------
+//
+// K and S are the kernel and stride when known at compile time (0 = read
+// them from the arguments), so the common 3x3 stride 1 case addresses every
+// tap with constant offsets.
+
+template<int R, int K, int S>
+__attribute__((target("avx2,fma")))
+inline void conv_pixels_avx2(const DirectConvArgs<float>& a, int ox) {
+    const int kernel = K > 0 ? K : a.kernel;
+    const size_t step = static_cast<size_t>(S > 0 ? S : a.stride) * B;
+    const size_t row_stride = a.row_stride;
+    const size_t channel_stride = a.channel_stride;
+    const int channels = a.channels;
+
+    __m256 acc[R];
+    const __m256 bias = _mm256_loadu_ps(a.bias);
+    for (int r = 0; r < R; r++) acc[r] = bias;
+
+    const float* w = a.weights;
+    for (int c = 0; c < channels; c++) {
+        const float* in = a.input + (c / B) * channel_stride + c % B + ox * step;
+        for (int ky = 0; ky < kernel; ky++) {
+            const float* row = in + ky * row_stride;
+            for (int kx = 0; kx < kernel; kx++, w += B) {
+                const __m256 wv = _mm256_loadu_ps(w);
+                for (int r = 0; r < R; r++) {
+                    acc[r] = _mm256_fmadd_ps(_mm256_broadcast_ss(row + kx * B + r * step), wv, acc[r]);
+                }
+            }
+        }
+    }
+
+    float* out = a.output + static_cast<size_t>(ox) * B;
+    for (int r = 0; r < R; r++) _mm256_storeu_ps(out + r * B, acc[r]);
+}
+
+template<int K, int S>
+__attribute__((target("avx2,fma")))
+void conv_row_avx2(const DirectConvArgs<float>& a) {
+    int ox = 0;
+    for (; ox + 8 <= a.out_width; ox += 8) conv_pixels_avx2<8, K, S>(a, ox);
+    for (; ox + 4 <= a.out_width; ox += 4) conv_pixels_avx2<4, K, S>(a, ox);
+    for (; ox < a.out_width; ox++) conv_pixels_avx2<1, K, S>(a, ox);
+}
+
+template<int R, int K, int S>
+__attribute__((target("avx2,fma")))
+inline void conv_pixels_avx2(const DirectConvArgs<double>& a, int ox) {
+    const int kernel = K > 0 ? K : a.kernel;
+    const size_t step = static_cast<size_t>(S > 0 ? S : a.stride) * B;
+    const size_t row_stride = a.row_stride;
+    const size_t channel_stride = a.channel_stride;
+    const int channels = a.channels;
+
+    __m256d lo[R], hi[R];
+    const __m256d bias_lo = _mm256_loadu_pd(a.bias);
+    const __m256d bias_hi = _mm256_loadu_pd(a.bias + 4);
+    for (int r = 0; r < R; r++) {
+        lo[r] = bias_lo;
+        hi[r] = bias_hi;
+    }
+
+    const double* w = a.weights;
+    for (int c = 0; c < channels; c++) {
+        const double* in = a.input + (c / B) * channel_stride + c % B + ox * step;
+        for (int ky = 0; ky < kernel; ky++) {
+            const double* row = in + ky * row_stride;
+            for (int kx = 0; kx < kernel; kx++, w += B) {
+                const __m256d w_lo = _mm256_loadu_pd(w);
+                const __m256d w_hi = _mm256_loadu_pd(w + 4);
+                for (int r = 0; r < R; r++) {
+                    const __m256d v = _mm256_broadcast_sd(row + kx * B + r * step);
+                    lo[r] = _mm256_fmadd_pd(v, w_lo, lo[r]);
+                    hi[r] = _mm256_fmadd_pd(v, w_hi, hi[r]);
+                }
+            }
+        }
+    }
+
+    double* out = a.output + static_cast<size_t>(ox) * B;
+    for (int r = 0; r < R; r++) {
+        _mm256_storeu_pd(out + r * B, lo[r]);
+        _mm256_storeu_pd(out + r * B + 4, hi[r]);
+    }
+}
+
+template<int K, int S>
+__attribute__((target("avx2,fma")))
+void conv_row_avx2(const DirectConvArgs<double>& a) {
+    int ox = 0;
+    for (; ox + 4 <= a.out_width; ox += 4) conv_pixels_avx2<4, K, S>(a, ox);
+    for (; ox < a.out_width; ox++) conv_pixels_avx2<1, K, S>(a, ox);
+}
+
+template<typename T>
+void conv_row_avx2_dispatch(const DirectConvArgs<T>& a) {
+    if (a.kernel == 3 && a.stride == 1) return conv_row_avx2<3, 1>(a);
+    conv_row_avx2<0, 0>(a);
+}
+
+// Depthwise at stride 1: R registers of neighbouring outputs accumulate
+// broadcast taps times unaligned loads of the shifted input row. Other
+// strides and the last few pixels take the portable loop.
+
+template<int R>
+__attribute__((target("avx2,fma")))
+inline void depthwise_pixels_avx2(const float* in, size_t row_stride, const float* w, float bias,
+                                  float* out, int kernel) {
+    __m256 acc[R];
+    for (int r = 0; r < R; r++) acc[r] = _mm256_set1_ps(bias);
+    for (int ky = 0; ky < kernel; ky++) {
+        const float* row = in + ky * row_stride;
+        for (int kx = 0; kx < kernel; kx++) {
+            const __m256 tap = _mm256_broadcast_ss(w + ky * kernel + kx);
+            for (int r = 0; r < R; r++) {
+                acc[r] = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + kx + r * 8), acc[r]);
+            }
+        }
+    }
+    for (int r = 0; r < R; r++) _mm256_storeu_ps(out + r * 8, acc[r]);
+}
+
+__attribute__((target("avx2,fma")))
+void depthwise_row_avx2(const float* in, size_t row_stride, const float* w, float bias,
+                        float* out, int kernel, int stride, int out_width) {
+    int ox = 0;
+    if (stride == 1) {
+        for (; ox + 32 <= out_width; ox += 32) depthwise_pixels_avx2<4>(in + ox, row_stride, w, bias, out + ox, kernel);
+        for (; ox + 8 <= out_width; ox += 8) depthwise_pixels_avx2<1>(in + ox, row_stride, w, bias, out + ox, kernel);
+    }
+    depthwise_row_portable(in + ox * stride, row_stride, w, bias, out + ox, kernel, stride, out_width - ox);
+}
+
+template<int R>
+__attribute__((target("avx2,fma")))
+inline void depthwise_pixels_avx2(const double* in, size_t row_stride, const double* w, double bias,
+                                  double* out, int kernel) {
+    __m256d acc[R];
+    for (int r = 0; r < R; r++) acc[r] = _mm256_set1_pd(bias);
+    for (int ky = 0; ky < kernel; ky++) {
+        const double* row = in + ky * row_stride;
+        for (int kx = 0; kx < kernel; kx++) {
+            const __m256d tap = _mm256_broadcast_sd(w + ky * kernel + kx);
+            for (int r = 0; r < R; r++) {
+                acc[r] = _mm256_fmadd_pd(tap, _mm256_loadu_pd(row + kx + r * 4), acc[r]);
+            }
+        }
+    }
+    for (int r = 0; r < R; r++) _mm256_storeu_pd(out + r * 4, acc[r]);
+}
+
+__attribute__((target("avx2,fma")))
+void depthwise_row_avx2(const double* in, size_t row_stride, const double* w, double bias,
+                        double* out, int kernel, int stride, int out_width) {
+    int ox = 0;
+    if (stride == 1) {
+        for (; ox + 16 <= out_width; ox += 16) depthwise_pixels_avx2<4>(in + ox, row_stride, w, bias, out + ox, kernel);
+        for (; ox + 4 <= out_width; ox += 4) depthwise_pixels_avx2<1>(in + ox, row_stride, w, bias, out + ox, kernel);
+    }
+    depthwise_row_portable(in + ox * stride, row_stride, w, bias, out + ox, kernel, stride, out_width - ox);
+}
+
+#endif
+
+template<typename T>
+const DirectConvKernels<T> PORTABLE_CONV = {
+    SimdLevel::SCALAR, conv_row_portable<T>, depthwise_row_portable<T>
+};
+
+#ifdef CNN_X86
+template<typename T>
+const DirectConvKernels<T> AVX2_CONV = {
+    SimdLevel::AVX2, conv_row_avx2_dispatch<T>, depthwise_row_avx2
+};
+#endif
+
+} // namespace
+
+// The 8-lane block fills one AVX2 register of floats; AVX-512 machines run
+// the AVX2 kernels rather than half-empty 16-lane registers
+template<typename T>
+const DirectConvKernels<T>& direct_conv_kernels_for(SimdLevel level) {
+    level = simd_kernels_for<T>(level).level;
+    switch (level) {
+#ifdef CNN_X86
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2: return AVX2_CONV<T>;
+#endif
+        default: return PORTABLE_CONV<T>;
+    }
+}
+
+template<typename T>
+const DirectConvKernels<T>& direct_conv_kernels() {
+    static const DirectConvKernels<T>& kernels = direct_conv_kernels_for<T>(detect_simd_level());
+    return kernels;
+}
+
+template const DirectConvKernels<float>& direct_conv_kernels_for<float>(SimdLevel level);
+template const DirectConvKernels<double>& direct_conv_kernels_for<double>(SimdLevel level);
+template const DirectConvKernels<float>& direct_conv_kernels<float>();
+template const DirectConvKernels<double>& direct_conv_kernels<double>();
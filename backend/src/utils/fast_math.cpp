@@ -0,0 +1,488 @@
+#include "fast_math.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Range of exp: below EXP_MIN the result flushes to zero (so 2^n stays a
+// normal number), above EXP_MAX it saturates
+constexpr float EXP_MIN = -86.6f;
+constexpr float EXP_MAX = 88.0f;
+constexpr float LOG2E = 1.44269504088896341f;
+// ln 2 split so that n * LN2_HI is exact for every n in range (Cody-Waite)
+constexpr float LN2_HI = 0.693359375f;
+constexpr float LN2_LO = -2.12194440e-4f;
+
+// FAST: e^r = 1 + r + r^2 * P(r), Cephes expf minimax coefficients
+constexpr float EXP_P0 = 1.9875691500e-4f;
+constexpr float EXP_P1 = 1.3981999507e-3f;
+constexpr float EXP_P2 = 8.3334519073e-3f;
+constexpr float EXP_P3 = 4.1665795894e-2f;
+constexpr float EXP_P4 = 1.6666665459e-1f;
+constexpr float EXP_P5 = 5.0000001201e-1f;
+
+// FASTEST: degree 2 P(r), fitted at Chebyshev nodes on [-ln2/2, ln2/2]
+constexpr float EXP_Q0 = 4.1791986e-2f;
+constexpr float EXP_Q1 = 1.6741899e-1f;
+constexpr float EXP_Q2 = 0.5f;
+
+// tanh(x) = x + x^3 * T(x^2) for |x| < TANH_SMALL (Cephes tanhf)
+constexpr float TANH_SMALL = 0.625f;
+constexpr float TANH_T0 = -5.70498872745e-3f;
+constexpr float TANH_T1 = 2.06390887954e-2f;
+constexpr float TANH_T2 = -5.37397155531e-2f;
+constexpr float TANH_T3 = 1.33314422036e-1f;
+constexpr float TANH_T4 = -3.33332819422e-1f;
+
+// ---------- PRECISE: libm per element ----------
+
+void exp_precise(const float* x, float* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] = std::exp(x[i]);
+}
+
+void sigmoid_precise(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+}
+
+void tanh_precise(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = std::tanh(x[i]);
+}
+
+template<typename T>
+void softmax_precise(T* data, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) {
+        T* x = data + r * cols;
+        T max_val = *std::max_element(x, x + cols);
+        T sum = T(0);
+        for (size_t i = 0; i < cols; i++) {
+            x[i] = std::exp(x[i] - max_val);
+            sum += x[i];
+        }
+        for (size_t i = 0; i < cols; i++) {
+            x[i] /= sum;
+        }
+    }
+}
+
+// ---------- FAST / FASTEST, portable (also the tails of the SIMD loops) ----------
+
+template<MathAccuracy A>
+float exp_poly(float x) {
+    if (x < EXP_MIN) return 0.0f;
+    x = std::min(x, EXP_MAX);
+    float n = std::nearbyint(x * LOG2E);
+    float r = x - n * LN2_HI;
+    r = r - n * LN2_LO;
+
+    float p;
+    if (A == MathAccuracy::FASTEST) {
+        p = (EXP_Q0 * r + EXP_Q1) * r + EXP_Q2;
+    } else {
+        p = ((((EXP_P0 * r + EXP_P1) * r + EXP_P2) * r + EXP_P3) * r + EXP_P4) * r + EXP_P5;
+    }
+    p = p * (r * r) + (r + 1.0f);
+
+    // Multiply by 2^n by adding n to the exponent field
+    int32_t bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += static_cast<int32_t>(n) * (1 << 23);
+    std::memcpy(&p, &bits, sizeof(bits));
+    return p;
+}
+
+template<MathAccuracy A>
+float tanh_poly(float x) {
+    float ax = std::fabs(x);
+    if (ax < TANH_SMALL) {
+        float z = x * x;
+        float t = (((TANH_T0 * z + TANH_T1) * z + TANH_T2) * z + TANH_T3) * z + TANH_T4;
+        return x + x * z * t;
+    }
+    float t = 1.0f - 2.0f / (exp_poly<A>(2.0f * ax) + 1.0f);
+    return std::copysign(t, x);
+}
+
+template<MathAccuracy A>
+void exp_portable(const float* x, float* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] = exp_poly<A>(x[i]);
+}
+
+template<MathAccuracy A>
+void sigmoid_portable(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = 1.0f / (1.0f + exp_poly<A>(-x[i]));
+}
+
+template<MathAccuracy A>
+void tanh_portable(float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = tanh_poly<A>(x[i]);
+}
+
+template<MathAccuracy A>
+void softmax_portable(float* data, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) {
+        float* x = data + r * cols;
+        float max_val = *std::max_element(x, x + cols);
+        float sum = 0.0f;
+        for (size_t i = 0; i < cols; i++) {
+            x[i] = exp_poly<A>(x[i] - max_val);
+            sum += x[i];
+        }
+        float inv = 1.0f / sum;
+        for (size_t i = 0; i < cols; i++) x[i] *= inv;
+    }
+}
+
+#ifdef CNN_X86
+
+// ---------- AVX2 + FMA (8 floats per register) ----------
+
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+inline __m256 exp_avx2(__m256 x) {
+    __m256 flush = _mm256_cmp_ps(x, _mm256_set1_ps(EXP_MIN), _CMP_LT_OQ);
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), r);
+
+    __m256 p;
+    if (A == MathAccuracy::FASTEST) {
+        p = _mm256_fmadd_ps(_mm256_set1_ps(EXP_Q0), r, _mm256_set1_ps(EXP_Q1));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_Q2));
+    } else {
+        p = _mm256_fmadd_ps(_mm256_set1_ps(EXP_P0), r, _mm256_set1_ps(EXP_P1));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P2));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P3));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P4));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P5));
+    }
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    __m256i scale = _mm256_slli_epi32(_mm256_cvtps_epi32(n), 23);
+    __m256 y = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), scale));
+    return _mm256_andnot_ps(flush, y);
+}
+
+// 1 / d, as a division or (FASTEST) a refined reciprocal estimate
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+inline __m256 reciprocal_avx2(__m256 d) {
+    if (A != MathAccuracy::FASTEST) return _mm256_div_ps(_mm256_set1_ps(1.0f), d);
+    __m256 r = _mm256_rcp_ps(d);
+    return _mm256_mul_ps(r, _mm256_fnmadd_ps(d, r, _mm256_set1_ps(2.0f)));
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+void exp_avx2(const float* x, float* y, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(y + i, exp_avx2<A>(_mm256_loadu_ps(x + i)));
+    for (; i < n; i++) y[i] = exp_poly<A>(x[i]);
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+void sigmoid_avx2(float* x, size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = exp_avx2<A>(_mm256_xor_ps(_mm256_loadu_ps(x + i), sign));
+        _mm256_storeu_ps(x + i, reciprocal_avx2<A>(_mm256_add_ps(one, e)));
+    }
+    for (; i < n; i++) x[i] = 1.0f / (1.0f + exp_poly<A>(-x[i]));
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+void tanh_avx2(float* x, size_t n) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 ax = _mm256_andnot_ps(sign, v);
+
+        // Odd polynomial near zero
+        __m256 z = _mm256_mul_ps(v, v);
+        __m256 t = _mm256_fmadd_ps(_mm256_set1_ps(TANH_T0), z, _mm256_set1_ps(TANH_T1));
+        t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TANH_T2));
+        t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TANH_T3));
+        t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TANH_T4));
+        __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(v, z), t, v);
+
+        // 1 - 2 / (e^2|x| + 1) with the sign of x elsewhere
+        __m256 e = exp_avx2<A>(_mm256_add_ps(ax, ax));
+        __m256 q = reciprocal_avx2<A>(_mm256_add_ps(e, one));
+        __m256 large = _mm256_fnmadd_ps(_mm256_set1_ps(2.0f), q, one);
+        large = _mm256_or_ps(large, _mm256_and_ps(v, sign));
+
+        __m256 use_small = _mm256_cmp_ps(ax, _mm256_set1_ps(TANH_SMALL), _CMP_LT_OQ);
+        _mm256_storeu_ps(x + i, _mm256_blendv_ps(large, small, use_small));
+    }
+    for (; i < n; i++) x[i] = tanh_poly<A>(x[i]);
+}
+
+__attribute__((target("avx2,fma")))
+inline float hmax_avx2(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+__attribute__((target("avx2,fma")))
+inline float hsum_avx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx2,fma")))
+void softmax_avx2(float* data, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) {
+        float* x = data + r * cols;
+
+        __m256 vmax = _mm256_set1_ps(-INFINITY);
+        size_t i = 0;
+        for (; i + 8 <= cols; i += 8) vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(x + i));
+        float max_val = hmax_avx2(vmax);
+        for (; i < cols; i++) max_val = std::max(max_val, x[i]);
+
+        // Subtract, exponentiate and accumulate in one pass
+        __m256 m = _mm256_set1_ps(max_val);
+        __m256 vsum = _mm256_setzero_ps();
+        i = 0;
+        for (; i + 8 <= cols; i += 8) {
+            __m256 e = exp_avx2<A>(_mm256_sub_ps(_mm256_loadu_ps(x + i), m));
+            _mm256_storeu_ps(x + i, e);
+            vsum = _mm256_add_ps(vsum, e);
+        }
+        float sum = hsum_avx2(vsum);
+        for (; i < cols; i++) {
+            x[i] = exp_poly<A>(x[i] - max_val);
+            sum += x[i];
+        }
+
+        __m256 inv = _mm256_set1_ps(1.0f / sum);
+        i = 0;
+        for (; i + 8 <= cols; i += 8) _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), inv));
+        for (; i < cols; i++) x[i] *= 1.0f / sum;
+    }
+}
+
+// ---------- AVX-512F (16 floats per register) ----------
+
+__attribute__((target("avx512f")))
+inline __m512 sign_of_avx512(__m512 v) {
+    return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(v),
+                                                _mm512_set1_epi32(INT32_MIN)));
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+inline __m512 exp_avx512(__m512 x) {
+    __mmask16 keep = _mm512_cmp_ps_mask(x, _mm512_set1_ps(EXP_MIN), _CMP_GE_OQ);
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN)), _mm512_set1_ps(EXP_MAX));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(LOG2E)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_HI), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_LO), r);
+
+    __m512 p;
+    if (A == MathAccuracy::FASTEST) {
+        p = _mm512_fmadd_ps(_mm512_set1_ps(EXP_Q0), r, _mm512_set1_ps(EXP_Q1));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_Q2));
+    } else {
+        p = _mm512_fmadd_ps(_mm512_set1_ps(EXP_P0), r, _mm512_set1_ps(EXP_P1));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P2));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P3));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P4));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P5));
+    }
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+
+    __m512i scale = _mm512_slli_epi32(_mm512_cvtps_epi32(n), 23);
+    __m512 y = _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(p), scale));
+    return _mm512_maskz_mov_ps(keep, y);
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+inline __m512 reciprocal_avx512(__m512 d) {
+    if (A != MathAccuracy::FASTEST) return _mm512_div_ps(_mm512_set1_ps(1.0f), d);
+    __m512 r = _mm512_rcp14_ps(d);
+    return _mm512_mul_ps(r, _mm512_fnmadd_ps(d, r, _mm512_set1_ps(2.0f)));
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+void exp_avx512(const float* x, float* y, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(y + i, exp_avx512<A>(_mm512_loadu_ps(x + i)));
+    for (; i < n; i++) y[i] = exp_poly<A>(x[i]);
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+void sigmoid_avx512(float* x, size_t n) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 e = exp_avx512<A>(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_loadu_ps(x + i)));
+        _mm512_storeu_ps(x + i, reciprocal_avx512<A>(_mm512_add_ps(one, e)));
+    }
+    for (; i < n; i++) x[i] = 1.0f / (1.0f + exp_poly<A>(-x[i]));
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+void tanh_avx512(float* x, size_t n) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_loadu_ps(x + i);
+        __m512 ax = _mm512_abs_ps(v);
+
+        __m512 z = _mm512_mul_ps(v, v);
+        __m512 t = _mm512_fmadd_ps(_mm512_set1_ps(TANH_T0), z, _mm512_set1_ps(TANH_T1));
+        t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TANH_T2));
+        t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TANH_T3));
+        t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TANH_T4));
+        __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(v, z), t, v);
+
+        __m512 e = exp_avx512<A>(_mm512_add_ps(ax, ax));
+        __m512 q = reciprocal_avx512<A>(_mm512_add_ps(e, one));
+        __m512 large = _mm512_fnmadd_ps(_mm512_set1_ps(2.0f), q, one);
+        large = _mm512_castsi512_ps(_mm512_or_epi32(_mm512_castps_si512(large),
+                                                    _mm512_castps_si512(sign_of_avx512(v))));
+
+        __mmask16 use_small = _mm512_cmp_ps_mask(ax, _mm512_set1_ps(TANH_SMALL), _CMP_LT_OQ);
+        _mm512_storeu_ps(x + i, _mm512_mask_blend_ps(use_small, large, small));
+    }
+    for (; i < n; i++) x[i] = tanh_poly<A>(x[i]);
+}
+
+template<MathAccuracy A>
+__attribute__((target("avx512f")))
+void softmax_avx512(float* data, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) {
+        float* x = data + r * cols;
+
+        __m512 vmax = _mm512_set1_ps(-INFINITY);
+        size_t i = 0;
+        for (; i + 16 <= cols; i += 16) vmax = _mm512_max_ps(vmax, _mm512_loadu_ps(x + i));
+        float max_val = _mm512_reduce_max_ps(vmax);
+        for (; i < cols; i++) max_val = std::max(max_val, x[i]);
+
+        __m512 m = _mm512_set1_ps(max_val);
+        __m512 vsum = _mm512_setzero_ps();
+        i = 0;
+        for (; i + 16 <= cols; i += 16) {
+            __m512 e = exp_avx512<A>(_mm512_sub_ps(_mm512_loadu_ps(x + i), m));
+            _mm512_storeu_ps(x + i, e);
+            vsum = _mm512_add_ps(vsum, e);
+        }
+        float sum = _mm512_reduce_add_ps(vsum);
+        for (; i < cols; i++) {
+            x[i] = exp_poly<A>(x[i] - max_val);
+            sum += x[i];
+        }
+
+        __m512 inv = _mm512_set1_ps(1.0f / sum);
+        i = 0;
+        for (; i + 16 <= cols; i += 16) _mm512_storeu_ps(x + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), inv));
+        for (; i < cols; i++) x[i] *= 1.0f / sum;
+    }
+}
+
+#endif // CNN_X86
+
+const MathKernels PRECISE_MATH = {
+    SimdLevel::SCALAR, MathAccuracy::PRECISE,
+    exp_precise, sigmoid_precise, tanh_precise, softmax_precise<float>
+};
+
+template<MathAccuracy A>
+const MathKernels PORTABLE_MATH = {
+    SimdLevel::SCALAR, A, exp_portable<A>, sigmoid_portable<A>, tanh_portable<A>, softmax_portable<A>
+};
+
+#ifdef CNN_X86
+template<MathAccuracy A>
+const MathKernels AVX2_MATH = {
+    SimdLevel::AVX2, A, exp_avx2<A>, sigmoid_avx2<A>, tanh_avx2<A>, softmax_avx2<A>
+};
+
+template<MathAccuracy A>
+const MathKernels AVX512_MATH = {
+    SimdLevel::AVX512, A, exp_avx512<A>, sigmoid_avx512<A>, tanh_avx512<A>, softmax_avx512<A>
+};
+#endif
+
+template<MathAccuracy A>
+const MathKernels& approximate_kernels_for(SimdLevel level) {
+    switch (level) {
+#ifdef CNN_X86
+        case SimdLevel::AVX512: return AVX512_MATH<A>;
+        case SimdLevel::AVX2: return AVX2_MATH<A>;
+#endif
+        default: return PORTABLE_MATH<A>;
+    }
+}
+
+} // namespace
+
+MathAccuracy default_math_accuracy() {
+    const char* env = std::getenv("CNN_MATH_ACCURACY");
+    if (env != nullptr) {
+        std::string name(env);
+        if (name == "precise") return MathAccuracy::PRECISE;
+        if (name == "fastest") return MathAccuracy::FASTEST;
+    }
+    return MathAccuracy::FAST;
+}
+
+const char* math_accuracy_name(MathAccuracy accuracy) {
+    switch (accuracy) {
+        case MathAccuracy::PRECISE: return "precise";
+        case MathAccuracy::FASTEST: return "fastest";
+        default: return "fast";
+    }
+}
+
+const MathKernels& math_kernels_for(SimdLevel level, MathAccuracy accuracy) {
+    // Clamp to what the CPU runs, the same way the dense kernels do
+    level = simd_kernels_for<float>(level).level;
+
+    switch (accuracy) {
+        case MathAccuracy::FAST: return approximate_kernels_for<MathAccuracy::FAST>(level);
+        case MathAccuracy::FASTEST: return approximate_kernels_for<MathAccuracy::FASTEST>(level);
+        default: return PRECISE_MATH;
+    }
+}
+
+const MathKernels& math_kernels() {
+    static const MathKernels& kernels = math_kernels_for(detect_simd_level(), default_math_accuracy());
+    return kernels;
+}
+
+void softmax_rows(float* x, size_t rows, size_t cols) {
+    math_kernels().softmax(x, rows, cols);
+}
+
+void softmax_rows(double* x, size_t rows, size_t cols) {
+    softmax_precise(x, rows, cols);
+}
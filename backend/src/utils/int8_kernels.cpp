@@ -0,0 +1,261 @@
+#include "int8_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// ---------- Portable scalar kernels ----------
+
+int32_t dot_scalar(const uint8_t* a, const int8_t* b, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+void gemv_scalar(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+                 size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] = dot_scalar(x, W + r * ldw, cols);
+}
+
+#ifdef CNN_X86
+
+// ---------- SSE4.2 maddubs (16 bytes per register) ----------
+
+__attribute__((target("sse4.2")))
+int32_t dot_sse42(const uint8_t* a, const int8_t* b, size_t n) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_maddubs_epi16(va, vb), ones));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t sum = _mm_cvtsi128_si32(acc);
+    for (; i < n; i++) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+__attribute__((target("sse4.2")))
+void gemv_sse42(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+                size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] = dot_sse42(x, W + r * ldw, cols);
+}
+
+// ---------- AVX2 maddubs and AVX-VNNI (32 bytes per register) ----------
+
+__attribute__((target("avx2")))
+inline int32_t hsum_epi32_avx2(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// acc += sums of 4-byte groups of a * b, via saturating int16 pair sums
+__attribute__((target("avx2")))
+inline __m256i madd_u8s8_avx2(__m256i acc, __m256i a, __m256i b) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), ones));
+}
+
+__attribute__((target("avx2")))
+int32_t dot_avx2(const uint8_t* a, const int8_t* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc = madd_u8s8_avx2(acc, va, vb);
+    }
+    int32_t sum = hsum_epi32_avx2(acc);
+    for (; i < n; i++) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2")))
+void gemv_avx2(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+              size_t rows, size_t cols) {
+    // Four weight rows per pass share every load of x
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const int8_t* w0 = W + r * ldw;
+        const int8_t* w1 = w0 + ldw;
+        const int8_t* w2 = w1 + ldw;
+        const int8_t* w3 = w2 + ldw;
+        __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+        __m256i s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= cols; i += 32) {
+            __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+            s0 = madd_u8s8_avx2(s0, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w0 + i)));
+            s1 = madd_u8s8_avx2(s1, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w1 + i)));
+            s2 = madd_u8s8_avx2(s2, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w2 + i)));
+            s3 = madd_u8s8_avx2(s3, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w3 + i)));
+        }
+        int32_t out[4] = {hsum_epi32_avx2(s0), hsum_epi32_avx2(s1),
+                          hsum_epi32_avx2(s2), hsum_epi32_avx2(s3)};
+        for (; i < cols; i++) {
+            int32_t xi = x[i];
+            out[0] += xi * w0[i];
+            out[1] += xi * w1[i];
+            out[2] += xi * w2[i];
+            out[3] += xi * w3[i];
+        }
+        y[r] = out[0];
+        y[r + 1] = out[1];
+        y[r + 2] = out[2];
+        y[r + 3] = out[3];
+    }
+    for (; r < rows; r++) y[r] = dot_avx2(x, W + r * ldw, cols);
+}
+
+// AVX-VNNI fuses the same multiply-add into one dpbusd without the int16 step
+
+__attribute__((target("avx2,avxvnni")))
+int32_t dot_avxvnni(const uint8_t* a, const int8_t* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc = _mm256_dpbusd_avx_epi32(acc, va, vb);
+    }
+    int32_t sum = hsum_epi32_avx2(acc);
+    for (; i < n; i++) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,avxvnni")))
+void gemv_avxvnni(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+                 size_t rows, size_t cols) {
+    // Four weight rows per pass share every load of x
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const int8_t* w0 = W + r * ldw;
+        const int8_t* w1 = w0 + ldw;
+        const int8_t* w2 = w1 + ldw;
+        const int8_t* w3 = w2 + ldw;
+        __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+        __m256i s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= cols; i += 32) {
+            __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+            s0 = _mm256_dpbusd_avx_epi32(s0, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w0 + i)));
+            s1 = _mm256_dpbusd_avx_epi32(s1, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w1 + i)));
+            s2 = _mm256_dpbusd_avx_epi32(s2, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w2 + i)));
+            s3 = _mm256_dpbusd_avx_epi32(s3, vx, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w3 + i)));
+        }
+        int32_t out[4] = {hsum_epi32_avx2(s0), hsum_epi32_avx2(s1),
+                          hsum_epi32_avx2(s2), hsum_epi32_avx2(s3)};
+        for (; i < cols; i++) {
+            int32_t xi = x[i];
+            out[0] += xi * w0[i];
+            out[1] += xi * w1[i];
+            out[2] += xi * w2[i];
+            out[3] += xi * w3[i];
+        }
+        y[r] = out[0];
+        y[r + 1] = out[1];
+        y[r + 2] = out[2];
+        y[r + 3] = out[3];
+    }
+    for (; r < rows; r++) y[r] = dot_avxvnni(x, W + r * ldw, cols);
+}
+
+// ---------- AVX-512 VNNI (64 bytes per register) ----------
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+int32_t dot_avx512vnni(const uint8_t* a, const int8_t* b, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    }
+    if (i < n) {
+        __mmask64 m = (~0ULL) >> (64 - (n - i));
+        acc = _mm512_dpbusd_epi32(acc, _mm512_maskz_loadu_epi8(m, a + i),
+                                  _mm512_maskz_loadu_epi8(m, b + i));
+    }
+    return _mm512_reduce_add_epi32(acc);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+void gemv_avx512vnni(const int8_t* W, size_t ldw, const uint8_t* x, int32_t* y,
+                     size_t rows, size_t cols) {
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const int8_t* w0 = W + r * ldw;
+        const int8_t* w1 = w0 + ldw;
+        const int8_t* w2 = w1 + ldw;
+        const int8_t* w3 = w2 + ldw;
+        __m512i s0 = _mm512_setzero_si512(), s1 = _mm512_setzero_si512();
+        __m512i s2 = _mm512_setzero_si512(), s3 = _mm512_setzero_si512();
+        size_t i = 0;
+        for (; i + 64 <= cols; i += 64) {
+            __m512i vx = _mm512_loadu_si512(x + i);
+            s0 = _mm512_dpbusd_epi32(s0, vx, _mm512_loadu_si512(w0 + i));
+            s1 = _mm512_dpbusd_epi32(s1, vx, _mm512_loadu_si512(w1 + i));
+            s2 = _mm512_dpbusd_epi32(s2, vx, _mm512_loadu_si512(w2 + i));
+            s3 = _mm512_dpbusd_epi32(s3, vx, _mm512_loadu_si512(w3 + i));
+        }
+        if (i < cols) {
+            __mmask64 m = (~0ULL) >> (64 - (cols - i));
+            __m512i vx = _mm512_maskz_loadu_epi8(m, x + i);
+            s0 = _mm512_dpbusd_epi32(s0, vx, _mm512_maskz_loadu_epi8(m, w0 + i));
+            s1 = _mm512_dpbusd_epi32(s1, vx, _mm512_maskz_loadu_epi8(m, w1 + i));
+            s2 = _mm512_dpbusd_epi32(s2, vx, _mm512_maskz_loadu_epi8(m, w2 + i));
+            s3 = _mm512_dpbusd_epi32(s3, vx, _mm512_maskz_loadu_epi8(m, w3 + i));
+        }
+        y[r] = _mm512_reduce_add_epi32(s0);
+        y[r + 1] = _mm512_reduce_add_epi32(s1);
+        y[r + 2] = _mm512_reduce_add_epi32(s2);
+        y[r + 3] = _mm512_reduce_add_epi32(s3);
+    }
+    for (; r < rows; r++) y[r] = dot_avx512vnni(x, W + r * ldw, cols);
+}
+
+#endif // CNN_X86
+
+const Int8Kernels SCALAR_INT8 = {"scalar", dot_scalar, gemv_scalar};
+
+#ifdef CNN_X86
+const Int8Kernels SSE42_INT8 = {"SSE4.2 maddubs", dot_sse42, gemv_sse42};
+const Int8Kernels AVX2_INT8 = {"AVX2 maddubs", dot_avx2, gemv_avx2};
+const Int8Kernels AVXVNNI_INT8 = {"AVX-VNNI", dot_avxvnni, gemv_avxvnni};
+const Int8Kernels AVX512VNNI_INT8 = {"AVX-512 VNNI", dot_avx512vnni, gemv_avx512vnni};
+#endif
+
+} // namespace
+
+const Int8Kernels& int8_kernels_for(SimdLevel level, bool allow_vnni) {
+    // Clamp to what the CPU runs, the same way the float kernels do
+    level = simd_kernels_for<float>(level).level;
+
+#ifdef CNN_X86
+    if (allow_vnni) {
+        if (level >= SimdLevel::AVX512 && __builtin_cpu_supports("avx512vnni") &&
+            __builtin_cpu_supports("avx512bw")) {
+            return AVX512VNNI_INT8;
+        }
+        if (level >= SimdLevel::AVX2 && __builtin_cpu_supports("avxvnni")) {
+            return AVXVNNI_INT8;
+        }
+    }
+    if (level >= SimdLevel::AVX2) return AVX2_INT8;
+    if (level >= SimdLevel::SSE42) return SSE42_INT8;
+#else
+    (void)allow_vnni;
+#endif
+    return SCALAR_INT8;
+}
+
+const Int8Kernels& int8_kernels() {
+    static const Int8Kernels& kernels = int8_kernels_for(detect_simd_level());
+    return kernels;
+}
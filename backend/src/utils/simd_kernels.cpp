@@ -0,0 +1,1013 @@
+#include "simd_kernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CNN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// ---------- Portable scalar kernels (float and double) ----------
+
+template<typename T>
+T dot_scalar(const T* a, const T* b, size_t n) {
+    T sum = T();
+    for (size_t i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+template<typename T>
+void axpy_scalar(T alpha, const T* x, T* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+template<typename T>
+void gemv_scalar(const T* W, const T* x, T* y, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] += dot_scalar(W + r * cols, x, cols);
+}
+
+// B micro-panels are one cache line wide: 8 doubles or 16 floats
+template<typename T>
+void gemm_micro_scalar(size_t kc, const T* a, const T* b, T* C, size_t ldc,
+                       size_t mr, size_t nr, T alpha) {
+    constexpr size_t NR = 64 / sizeof(T);
+    T acc[4][NR] = {};
+    for (size_t p = 0; p < kc; p++) {
+        for (size_t i = 0; i < 4; i++) {
+            T ai = a[p * 4 + i];
+            for (size_t j = 0; j < NR; j++) acc[i][j] += ai * b[p * NR + j];
+        }
+    }
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) C[i * ldc + j] += alpha * acc[i][j];
+    }
+}
+
+template<typename T>
+void bias_add_scalar(T* Y, const T* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) {
+        T* y = Y + r * cols;
+        for (size_t j = 0; j < cols; j++) y[j] += b[j];
+    }
+}
+
+template<typename T>
+void sigmoid_scalar(T* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = T(1) / (T(1) + std::exp(-x[i]));
+}
+
+template<typename T>
+void relu_scalar(T* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = x[i] > T() ? x[i] : T();
+}
+
+template<typename T>
+void tanh_scalar(T* x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = std::tanh(x[i]);
+}
+
+template<typename T>
+void sigmoid_grad_scalar(const T* y, T* d, size_t n) {
+    for (size_t i = 0; i < n; i++) d[i] *= y[i] * (T(1) - y[i]);
+}
+
+template<typename T>
+void relu_grad_scalar(const T* y, T* d, size_t n) {
+    for (size_t i = 0; i < n; i++) d[i] = y[i] > T() ? d[i] : T();
+}
+
+template<typename T>
+void tanh_grad_scalar(const T* y, T* d, size_t n) {
+    for (size_t i = 0; i < n; i++) d[i] *= T(1) - y[i] * y[i];
+}
+
+#ifdef CNN_X86
+
+// ---------- SSE4.2, double (2 doubles per register) ----------
+
+__attribute__((target("sse4.2")))
+double dot_sse42(const double* a, const double* b, size_t n) {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    double sum = _mm_cvtsd_f64(_mm_add_sd(s0, _mm_unpackhi_pd(s0, s0)));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse4.2")))
+void axpy_sse42(double alpha, const double* x, double* y, size_t n) {
+    __m128d va = _mm_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("sse4.2")))
+void gemv_sse42(const double* W, const double* x, double* y, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] += dot_sse42(W + r * cols, x, cols);
+}
+
+__attribute__((target("sse4.2")))
+void gemm_micro_sse42(size_t kc, const double* a, const double* b, double* C, size_t ldc,
+                      size_t mr, size_t nr, double alpha) {
+    alignas(16) double acc[4][8];
+    // Two rows per pass keeps the 8 accumulators plus operands in 16 registers
+    for (size_t i = 0; i < 4; i += 2) {
+        __m128d c0[4], c1[4];
+        for (int q = 0; q < 4; q++) {
+            c0[q] = _mm_setzero_pd();
+            c1[q] = _mm_setzero_pd();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m128d a0 = _mm_set1_pd(a[p * 4 + i]);
+            __m128d a1 = _mm_set1_pd(a[p * 4 + i + 1]);
+            const double* bp = b + p * 8;
+            for (int q = 0; q < 4; q++) {
+                __m128d bq = _mm_loadu_pd(bp + 2 * q);
+                c0[q] = _mm_add_pd(c0[q], _mm_mul_pd(a0, bq));
+                c1[q] = _mm_add_pd(c1[q], _mm_mul_pd(a1, bq));
+            }
+        }
+        for (int q = 0; q < 4; q++) {
+            _mm_store_pd(&acc[i][2 * q], c0[q]);
+            _mm_store_pd(&acc[i + 1][2 * q], c1[q]);
+        }
+    }
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) C[i * ldc + j] += alpha * acc[i][j];
+    }
+}
+
+__attribute__((target("sse4.2")))
+void bias_add_sse42(double* Y, const double* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_sse42(1.0, b, Y + r * cols, cols);
+}
+
+__attribute__((target("sse4.2")))
+void relu_sse42(double* x, size_t n) {
+    __m128d zero = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(x + i, _mm_max_pd(_mm_loadu_pd(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0 ? x[i] : 0.0;
+}
+
+__attribute__((target("sse4.2")))
+void sigmoid_grad_sse42(const double* y, double* d, size_t n) {
+    __m128d one = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d vy = _mm_loadu_pd(y + i);
+        __m128d g = _mm_mul_pd(vy, _mm_sub_pd(one, vy));
+        _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0 - y[i]);
+}
+
+__attribute__((target("sse4.2")))
+void relu_grad_sse42(const double* y, double* d, size_t n) {
+    __m128d zero = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d mask = _mm_cmpgt_pd(_mm_loadu_pd(y + i), zero);
+        _mm_storeu_pd(d + i, _mm_and_pd(_mm_loadu_pd(d + i), mask));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0 ? d[i] : 0.0;
+}
+
+__attribute__((target("sse4.2")))
+void tanh_grad_sse42(const double* y, double* d, size_t n) {
+    __m128d one = _mm_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d vy = _mm_loadu_pd(y + i);
+        __m128d g = _mm_sub_pd(one, _mm_mul_pd(vy, vy));
+        _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0 - y[i] * y[i];
+}
+
+// ---------- SSE4.2, float (4 floats per register) ----------
+
+__attribute__((target("sse4.2")))
+float dot_sse42(const float* a, const float* b, size_t n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    s0 = _mm_add_ps(s0, s1);
+    s0 = _mm_hadd_ps(s0, s0);
+    float sum = _mm_cvtss_f32(_mm_hadd_ps(s0, s0));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse4.2")))
+void axpy_sse42(float alpha, const float* x, float* y, size_t n) {
+    __m128 va = _mm_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("sse4.2")))
+void gemv_sse42(const float* W, const float* x, float* y, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) y[r] += dot_sse42(W + r * cols, x, cols);
+}
+
+__attribute__((target("sse4.2")))
+void gemm_micro_sse42(size_t kc, const float* a, const float* b, float* C, size_t ldc,
+                      size_t mr, size_t nr, float alpha) {
+    alignas(16) float acc[4][16];
+    // Two rows per pass: 8 accumulators, 4 B vectors and 2 broadcasts
+    for (size_t i = 0; i < 4; i += 2) {
+        __m128 c0[4], c1[4];
+        for (int q = 0; q < 4; q++) {
+            c0[q] = _mm_setzero_ps();
+            c1[q] = _mm_setzero_ps();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m128 a0 = _mm_set1_ps(a[p * 4 + i]);
+            __m128 a1 = _mm_set1_ps(a[p * 4 + i + 1]);
+            const float* bp = b + p * 16;
+            for (int q = 0; q < 4; q++) {
+                __m128 bq = _mm_loadu_ps(bp + 4 * q);
+                c0[q] = _mm_add_ps(c0[q], _mm_mul_ps(a0, bq));
+                c1[q] = _mm_add_ps(c1[q], _mm_mul_ps(a1, bq));
+            }
+        }
+        for (int q = 0; q < 4; q++) {
+            _mm_store_ps(&acc[i][4 * q], c0[q]);
+            _mm_store_ps(&acc[i + 1][4 * q], c1[q]);
+        }
+    }
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) C[i * ldc + j] += alpha * acc[i][j];
+    }
+}
+
+__attribute__((target("sse4.2")))
+void bias_add_sse42(float* Y, const float* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_sse42(1.0f, b, Y + r * cols, cols);
+}
+
+__attribute__((target("sse4.2")))
+void relu_sse42(float* x, size_t n) {
+    __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(x + i, _mm_max_ps(_mm_loadu_ps(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+__attribute__((target("sse4.2")))
+void sigmoid_grad_sse42(const float* y, float* d, size_t n) {
+    __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 g = _mm_mul_ps(vy, _mm_sub_ps(one, vy));
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0f - y[i]);
+}
+
+__attribute__((target("sse4.2")))
+void relu_grad_sse42(const float* y, float* d, size_t n) {
+    __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 mask = _mm_cmpgt_ps(_mm_loadu_ps(y + i), zero);
+        _mm_storeu_ps(d + i, _mm_and_ps(_mm_loadu_ps(d + i), mask));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0f ? d[i] : 0.0f;
+}
+
+__attribute__((target("sse4.2")))
+void tanh_grad_sse42(const float* y, float* d, size_t n) {
+    __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 g = _mm_sub_ps(one, _mm_mul_ps(vy, vy));
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0f - y[i] * y[i];
+}
+
+// ---------- AVX2 + FMA, double (4 doubles per register) ----------
+
+__attribute__((target("avx2,fma")))
+double dot_avx2(const double* a, const double* b, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+    }
+    s0 = _mm256_add_pd(s0, s1);
+    __m128d h = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+void axpy_avx2(double alpha, const double* x, double* y, size_t n) {
+    __m256d va = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("avx2,fma")))
+void gemv_avx2(const double* W, const double* x, double* y, size_t rows, size_t cols) {
+    // Four rows at a time share every load of x
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const double* w0 = W + r * cols;
+        const double* w1 = w0 + cols;
+        const double* w2 = w1 + cols;
+        const double* w3 = w2 + cols;
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= cols; i += 4) {
+            __m256d vx = _mm256_loadu_pd(x + i);
+            s0 = _mm256_fmadd_pd(_mm256_loadu_pd(w0 + i), vx, s0);
+            s1 = _mm256_fmadd_pd(_mm256_loadu_pd(w1 + i), vx, s1);
+            s2 = _mm256_fmadd_pd(_mm256_loadu_pd(w2 + i), vx, s2);
+            s3 = _mm256_fmadd_pd(_mm256_loadu_pd(w3 + i), vx, s3);
+        }
+        // Horizontal sums of the four accumulators in one vector
+        __m256d t01 = _mm256_hadd_pd(s0, s1);
+        __m256d t23 = _mm256_hadd_pd(s2, s3);
+        __m256d sum = _mm256_add_pd(_mm256_permute2f128_pd(t01, t23, 0x20),
+                                    _mm256_permute2f128_pd(t01, t23, 0x31));
+        alignas(32) double out[4];
+        _mm256_store_pd(out, sum);
+        for (; i < cols; i++) {
+            out[0] += w0[i] * x[i];
+            out[1] += w1[i] * x[i];
+            out[2] += w2[i] * x[i];
+            out[3] += w3[i] * x[i];
+        }
+        y[r] += out[0];
+        y[r + 1] += out[1];
+        y[r + 2] += out[2];
+        y[r + 3] += out[3];
+    }
+    for (; r < rows; r++) y[r] += dot_avx2(W + r * cols, x, cols);
+}
+
+__attribute__((target("avx2,fma")))
+void gemm_micro_avx2(size_t kc, const double* a, const double* b, double* C, size_t ldc,
+                     size_t mr, size_t nr, double alpha) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_loadu_pd(b + p * 8);
+        __m256d b1 = _mm256_loadu_pd(b + p * 8 + 4);
+        __m256d a0 = _mm256_broadcast_sd(a + p * 4);
+        c00 = _mm256_fmadd_pd(a0, b0, c00);
+        c01 = _mm256_fmadd_pd(a0, b1, c01);
+        __m256d a1 = _mm256_broadcast_sd(a + p * 4 + 1);
+        c10 = _mm256_fmadd_pd(a1, b0, c10);
+        c11 = _mm256_fmadd_pd(a1, b1, c11);
+        __m256d a2 = _mm256_broadcast_sd(a + p * 4 + 2);
+        c20 = _mm256_fmadd_pd(a2, b0, c20);
+        c21 = _mm256_fmadd_pd(a2, b1, c21);
+        __m256d a3 = _mm256_broadcast_sd(a + p * 4 + 3);
+        c30 = _mm256_fmadd_pd(a3, b0, c30);
+        c31 = _mm256_fmadd_pd(a3, b1, c31);
+    }
+
+    __m256d va = _mm256_set1_pd(alpha);
+    if (mr == 4 && nr == 8) {
+        __m256d rows[4][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}};
+        for (size_t i = 0; i < 4; i++) {
+            double* c = C + i * ldc;
+            _mm256_storeu_pd(c, _mm256_fmadd_pd(va, rows[i][0], _mm256_loadu_pd(c)));
+            _mm256_storeu_pd(c + 4, _mm256_fmadd_pd(va, rows[i][1], _mm256_loadu_pd(c + 4)));
+        }
+        return;
+    }
+
+    alignas(32) double acc[4][8];
+    _mm256_store_pd(&acc[0][0], c00); _mm256_store_pd(&acc[0][4], c01);
+    _mm256_store_pd(&acc[1][0], c10); _mm256_store_pd(&acc[1][4], c11);
+    _mm256_store_pd(&acc[2][0], c20); _mm256_store_pd(&acc[2][4], c21);
+    _mm256_store_pd(&acc[3][0], c30); _mm256_store_pd(&acc[3][4], c31);
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) C[i * ldc + j] += alpha * acc[i][j];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void bias_add_avx2(double* Y, const double* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_avx2(1.0, b, Y + r * cols, cols);
+}
+
+__attribute__((target("avx2,fma")))
+void relu_avx2(double* x, size_t n) {
+    __m256d zero = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(x + i, _mm256_max_pd(_mm256_loadu_pd(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0 ? x[i] : 0.0;
+}
+
+__attribute__((target("avx2,fma")))
+void sigmoid_grad_avx2(const double* y, double* d, size_t n) {
+    __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vy = _mm256_loadu_pd(y + i);
+        __m256d g = _mm256_mul_pd(vy, _mm256_sub_pd(one, vy));
+        _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0 - y[i]);
+}
+
+__attribute__((target("avx2,fma")))
+void relu_grad_avx2(const double* y, double* d, size_t n) {
+    __m256d zero = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(y + i), zero, _CMP_GT_OQ);
+        _mm256_storeu_pd(d + i, _mm256_and_pd(_mm256_loadu_pd(d + i), mask));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0 ? d[i] : 0.0;
+}
+
+__attribute__((target("avx2,fma")))
+void tanh_grad_avx2(const double* y, double* d, size_t n) {
+    __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vy = _mm256_loadu_pd(y + i);
+        __m256d g = _mm256_fnmadd_pd(vy, vy, one);
+        _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0 - y[i] * y[i];
+}
+
+// ---------- AVX2 + FMA, float (8 floats per register) ----------
+
+__attribute__((target("avx2,fma")))
+inline float hsum_avx2(__m256 v) {
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+float dot_avx2(const float* a, const float* b, size_t n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+    }
+    float sum = hsum_avx2(_mm256_add_ps(s0, s1));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+void axpy_avx2(float alpha, const float* x, float* y, size_t n) {
+    __m256 va = _mm256_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("avx2,fma")))
+void gemv_avx2(const float* W, const float* x, float* y, size_t rows, size_t cols) {
+    // Four rows at a time share every load of x
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* w0 = W + r * cols;
+        const float* w1 = w0 + cols;
+        const float* w2 = w1 + cols;
+        const float* w3 = w2 + cols;
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= cols; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i);
+            s0 = _mm256_fmadd_ps(_mm256_loadu_ps(w0 + i), vx, s0);
+            s1 = _mm256_fmadd_ps(_mm256_loadu_ps(w1 + i), vx, s1);
+            s2 = _mm256_fmadd_ps(_mm256_loadu_ps(w2 + i), vx, s2);
+            s3 = _mm256_fmadd_ps(_mm256_loadu_ps(w3 + i), vx, s3);
+        }
+        float out[4] = {hsum_avx2(s0), hsum_avx2(s1), hsum_avx2(s2), hsum_avx2(s3)};
+        for (; i < cols; i++) {
+            out[0] += w0[i] * x[i];
+            out[1] += w1[i] * x[i];
+            out[2] += w2[i] * x[i];
+            out[3] += w3[i] * x[i];
+        }
+        y[r] += out[0];
+        y[r + 1] += out[1];
+        y[r + 2] += out[2];
+        y[r + 3] += out[3];
+    }
+    for (; r < rows; r++) y[r] += dot_avx2(W + r * cols, x, cols);
+}
+
+__attribute__((target("avx2,fma")))
+void gemm_micro_avx2(size_t kc, const float* a, const float* b, float* C, size_t ldc,
+                     size_t mr, size_t nr, float alpha) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m256 b0 = _mm256_loadu_ps(b + p * 16);
+        __m256 b1 = _mm256_loadu_ps(b + p * 16 + 8);
+        __m256 a0 = _mm256_broadcast_ss(a + p * 4);
+        c00 = _mm256_fmadd_ps(a0, b0, c00);
+        c01 = _mm256_fmadd_ps(a0, b1, c01);
+        __m256 a1 = _mm256_broadcast_ss(a + p * 4 + 1);
+        c10 = _mm256_fmadd_ps(a1, b0, c10);
+        c11 = _mm256_fmadd_ps(a1, b1, c11);
+        __m256 a2 = _mm256_broadcast_ss(a + p * 4 + 2);
+        c20 = _mm256_fmadd_ps(a2, b0, c20);
+        c21 = _mm256_fmadd_ps(a2, b1, c21);
+        __m256 a3 = _mm256_broadcast_ss(a + p * 4 + 3);
+        c30 = _mm256_fmadd_ps(a3, b0, c30);
+        c31 = _mm256_fmadd_ps(a3, b1, c31);
+    }
+
+    __m256 va = _mm256_set1_ps(alpha);
+    if (mr == 4 && nr == 16) {
+        __m256 rows[4][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}};
+        for (size_t i = 0; i < 4; i++) {
+            float* c = C + i * ldc;
+            _mm256_storeu_ps(c, _mm256_fmadd_ps(va, rows[i][0], _mm256_loadu_ps(c)));
+            _mm256_storeu_ps(c + 8, _mm256_fmadd_ps(va, rows[i][1], _mm256_loadu_ps(c + 8)));
+        }
+        return;
+    }
+
+    alignas(32) float acc[4][16];
+    _mm256_store_ps(&acc[0][0], c00); _mm256_store_ps(&acc[0][8], c01);
+    _mm256_store_ps(&acc[1][0], c10); _mm256_store_ps(&acc[1][8], c11);
+    _mm256_store_ps(&acc[2][0], c20); _mm256_store_ps(&acc[2][8], c21);
+    _mm256_store_ps(&acc[3][0], c30); _mm256_store_ps(&acc[3][8], c31);
+    for (size_t i = 0; i < mr; i++) {
+        for (size_t j = 0; j < nr; j++) C[i * ldc + j] += alpha * acc[i][j];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void bias_add_avx2(float* Y, const float* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_avx2(1.0f, b, Y + r * cols, cols);
+}
+
+__attribute__((target("avx2,fma")))
+void relu_avx2(float* x, size_t n) {
+    __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+__attribute__((target("avx2,fma")))
+void sigmoid_grad_avx2(const float* y, float* d, size_t n) {
+    __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 g = _mm256_mul_ps(vy, _mm256_sub_ps(one, vy));
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0f - y[i]);
+}
+
+__attribute__((target("avx2,fma")))
+void relu_grad_avx2(const float* y, float* d, size_t n) {
+    __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 mask = _mm256_cmp_ps(_mm256_loadu_ps(y + i), zero, _CMP_GT_OQ);
+        _mm256_storeu_ps(d + i, _mm256_and_ps(_mm256_loadu_ps(d + i), mask));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0f ? d[i] : 0.0f;
+}
+
+__attribute__((target("avx2,fma")))
+void tanh_grad_avx2(const float* y, float* d, size_t n) {
+    __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 g = _mm256_fnmadd_ps(vy, vy, one);
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0f - y[i] * y[i];
+}
+
+// ---------- AVX-512F, double (8 doubles per register) ----------
+
+__attribute__((target("avx512f")))
+double dot_avx512(const double* a, const double* b, size_t n) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+    }
+    if (i + 8 <= n) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+        i += 8;
+    }
+    if (i < n) {
+        __mmask8 m = static_cast<__mmask8>((1u << (n - i)) - 1);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+__attribute__((target("avx512f")))
+void axpy_avx512(double alpha, const double* x, double* y, size_t n) {
+    __m512d va = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    if (i < n) {
+        __mmask8 m = static_cast<__mmask8>((1u << (n - i)) - 1);
+        __m512d r = _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, r);
+    }
+}
+
+__attribute__((target("avx512f")))
+void gemv_avx512(const double* W, const double* x, double* y, size_t rows, size_t cols) {
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const double* w0 = W + r * cols;
+        const double* w1 = w0 + cols;
+        const double* w2 = w1 + cols;
+        const double* w3 = w2 + cols;
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= cols; i += 8) {
+            __m512d vx = _mm512_loadu_pd(x + i);
+            s0 = _mm512_fmadd_pd(_mm512_loadu_pd(w0 + i), vx, s0);
+            s1 = _mm512_fmadd_pd(_mm512_loadu_pd(w1 + i), vx, s1);
+            s2 = _mm512_fmadd_pd(_mm512_loadu_pd(w2 + i), vx, s2);
+            s3 = _mm512_fmadd_pd(_mm512_loadu_pd(w3 + i), vx, s3);
+        }
+        if (i < cols) {
+            __mmask8 m = static_cast<__mmask8>((1u << (cols - i)) - 1);
+            __m512d vx = _mm512_maskz_loadu_pd(m, x + i);
+            s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, w0 + i), vx, s0);
+            s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, w1 + i), vx, s1);
+            s2 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, w2 + i), vx, s2);
+            s3 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, w3 + i), vx, s3);
+        }
+        y[r] += _mm512_reduce_add_pd(s0);
+        y[r + 1] += _mm512_reduce_add_pd(s1);
+        y[r + 2] += _mm512_reduce_add_pd(s2);
+        y[r + 3] += _mm512_reduce_add_pd(s3);
+    }
+    for (; r < rows; r++) y[r] += dot_avx512(W + r * cols, x, cols);
+}
+
+__attribute__((target("avx512f")))
+void gemm_micro_avx512(size_t kc, const double* a, const double* b, double* C, size_t ldc,
+                       size_t mr, size_t nr, double alpha) {
+    __m512d c0 = _mm512_setzero_pd(), c1 = _mm512_setzero_pd();
+    __m512d c2 = _mm512_setzero_pd(), c3 = _mm512_setzero_pd();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m512d bp = _mm512_loadu_pd(b + p * 8);
+        c0 = _mm512_fmadd_pd(_mm512_set1_pd(a[p * 4]), bp, c0);
+        c1 = _mm512_fmadd_pd(_mm512_set1_pd(a[p * 4 + 1]), bp, c1);
+        c2 = _mm512_fmadd_pd(_mm512_set1_pd(a[p * 4 + 2]), bp, c2);
+        c3 = _mm512_fmadd_pd(_mm512_set1_pd(a[p * 4 + 3]), bp, c3);
+    }
+
+    __m512d va = _mm512_set1_pd(alpha);
+    __m512d rows[4] = {c0, c1, c2, c3};
+    __mmask8 m = static_cast<__mmask8>((1u << nr) - 1);
+    for (size_t i = 0; i < mr; i++) {
+        double* c = C + i * ldc;
+        _mm512_mask_storeu_pd(c, m, _mm512_fmadd_pd(va, rows[i], _mm512_maskz_loadu_pd(m, c)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void bias_add_avx512(double* Y, const double* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_avx512(1.0, b, Y + r * cols, cols);
+}
+
+__attribute__((target("avx512f")))
+void relu_avx512(double* x, size_t n) {
+    __m512d zero = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm512_storeu_pd(x + i, _mm512_max_pd(_mm512_loadu_pd(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0 ? x[i] : 0.0;
+}
+
+__attribute__((target("avx512f")))
+void sigmoid_grad_avx512(const double* y, double* d, size_t n) {
+    __m512d one = _mm512_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d vy = _mm512_loadu_pd(y + i);
+        __m512d g = _mm512_mul_pd(vy, _mm512_sub_pd(one, vy));
+        _mm512_storeu_pd(d + i, _mm512_mul_pd(_mm512_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0 - y[i]);
+}
+
+__attribute__((target("avx512f")))
+void relu_grad_avx512(const double* y, double* d, size_t n) {
+    __m512d zero = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 m = _mm512_cmp_pd_mask(_mm512_loadu_pd(y + i), zero, _CMP_GT_OQ);
+        _mm512_storeu_pd(d + i, _mm512_maskz_mov_pd(m, _mm512_loadu_pd(d + i)));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0 ? d[i] : 0.0;
+}
+
+__attribute__((target("avx512f")))
+void tanh_grad_avx512(const double* y, double* d, size_t n) {
+    __m512d one = _mm512_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d vy = _mm512_loadu_pd(y + i);
+        __m512d g = _mm512_fnmadd_pd(vy, vy, one);
+        _mm512_storeu_pd(d + i, _mm512_mul_pd(_mm512_loadu_pd(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0 - y[i] * y[i];
+}
+
+// ---------- AVX-512F, float (16 floats per register) ----------
+
+__attribute__((target("avx512f")))
+float dot_avx512(const float* a, const float* b, size_t n) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+    }
+    if (i + 16 <= n) {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+        i += 16;
+    }
+    if (i < n) {
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), s1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+}
+
+__attribute__((target("avx512f")))
+void axpy_avx512(float alpha, const float* x, float* y, size_t n) {
+    __m512 va = _mm512_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 r = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i));
+        _mm512_mask_storeu_ps(y + i, m, r);
+    }
+}
+
+__attribute__((target("avx512f")))
+void gemv_avx512(const float* W, const float* x, float* y, size_t rows, size_t cols) {
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* w0 = W + r * cols;
+        const float* w1 = w0 + cols;
+        const float* w2 = w1 + cols;
+        const float* w3 = w2 + cols;
+        __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+        __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= cols; i += 16) {
+            __m512 vx = _mm512_loadu_ps(x + i);
+            s0 = _mm512_fmadd_ps(_mm512_loadu_ps(w0 + i), vx, s0);
+            s1 = _mm512_fmadd_ps(_mm512_loadu_ps(w1 + i), vx, s1);
+            s2 = _mm512_fmadd_ps(_mm512_loadu_ps(w2 + i), vx, s2);
+            s3 = _mm512_fmadd_ps(_mm512_loadu_ps(w3 + i), vx, s3);
+        }
+        if (i < cols) {
+            __mmask16 m = static_cast<__mmask16>((1u << (cols - i)) - 1);
+            __m512 vx = _mm512_maskz_loadu_ps(m, x + i);
+            s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, w0 + i), vx, s0);
+            s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, w1 + i), vx, s1);
+            s2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, w2 + i), vx, s2);
+            s3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, w3 + i), vx, s3);
+        }
+        y[r] += _mm512_reduce_add_ps(s0);
+        y[r + 1] += _mm512_reduce_add_ps(s1);
+        y[r + 2] += _mm512_reduce_add_ps(s2);
+        y[r + 3] += _mm512_reduce_add_ps(s3);
+    }
+    for (; r < rows; r++) y[r] += dot_avx512(W + r * cols, x, cols);
+}
+
+__attribute__((target("avx512f")))
+void gemm_micro_avx512(size_t kc, const float* a, const float* b, float* C, size_t ldc,
+                       size_t mr, size_t nr, float alpha) {
+    __m512 c0 = _mm512_setzero_ps(), c1 = _mm512_setzero_ps();
+    __m512 c2 = _mm512_setzero_ps(), c3 = _mm512_setzero_ps();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m512 bp = _mm512_loadu_ps(b + p * 16);
+        c0 = _mm512_fmadd_ps(_mm512_set1_ps(a[p * 4]), bp, c0);
+        c1 = _mm512_fmadd_ps(_mm512_set1_ps(a[p * 4 + 1]), bp, c1);
+        c2 = _mm512_fmadd_ps(_mm512_set1_ps(a[p * 4 + 2]), bp, c2);
+        c3 = _mm512_fmadd_ps(_mm512_set1_ps(a[p * 4 + 3]), bp, c3);
+    }
+
+    __m512 va = _mm512_set1_ps(alpha);
+    __m512 rows[4] = {c0, c1, c2, c3};
+    __mmask16 m = static_cast<__mmask16>((1u << nr) - 1);
+    for (size_t i = 0; i < mr; i++) {
+        float* c = C + i * ldc;
+        _mm512_mask_storeu_ps(c, m, _mm512_fmadd_ps(va, rows[i], _mm512_maskz_loadu_ps(m, c)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void bias_add_avx512(float* Y, const float* b, size_t rows, size_t cols) {
+    for (size_t r = 0; r < rows; r++) axpy_avx512(1.0f, b, Y + r * cols, cols);
+}
+
+__attribute__((target("avx512f")))
+void relu_avx512(float* x, size_t n) {
+    __m512 zero = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(x + i, _mm512_max_ps(_mm512_loadu_ps(x + i), zero));
+    for (; i < n; i++) x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+__attribute__((target("avx512f")))
+void sigmoid_grad_avx512(const float* y, float* d, size_t n) {
+    __m512 one = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 g = _mm512_mul_ps(vy, _mm512_sub_ps(one, vy));
+        _mm512_storeu_ps(d + i, _mm512_mul_ps(_mm512_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= y[i] * (1.0f - y[i]);
+}
+
+__attribute__((target("avx512f")))
+void relu_grad_avx512(const float* y, float* d, size_t n) {
+    __m512 zero = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 m = _mm512_cmp_ps_mask(_mm512_loadu_ps(y + i), zero, _CMP_GT_OQ);
+        _mm512_storeu_ps(d + i, _mm512_maskz_mov_ps(m, _mm512_loadu_ps(d + i)));
+    }
+    for (; i < n; i++) d[i] = y[i] > 0.0f ? d[i] : 0.0f;
+}
+
+__attribute__((target("avx512f")))
+void tanh_grad_avx512(const float* y, float* d, size_t n) {
+    __m512 one = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 vy = _mm512_loadu_ps(y + i);
+        __m512 g = _mm512_fnmadd_ps(vy, vy, one);
+        _mm512_storeu_ps(d + i, _mm512_mul_ps(_mm512_loadu_ps(d + i), g));
+    }
+    for (; i < n; i++) d[i] *= 1.0f - y[i] * y[i];
+}
+
+#endif // CNN_X86
+
+// sigmoid and tanh keep libm's exp/tanh per element on every level, so all
+// levels produce identical activations. Overloads pick the float or double
+// version of each kernel.
+template<typename T>
+const SimdKernels<T> SCALAR_KERNELS = {
+    SimdLevel::SCALAR, dot_scalar<T>, axpy_scalar<T>, gemv_scalar<T>, gemm_micro_scalar<T>,
+    bias_add_scalar<T>, sigmoid_scalar<T>, relu_scalar<T>, tanh_scalar<T>,
+    sigmoid_grad_scalar<T>, relu_grad_scalar<T>, tanh_grad_scalar<T>
+};
+
+#ifdef CNN_X86
+template<typename T>
+const SimdKernels<T> SSE42_KERNELS = {
+    SimdLevel::SSE42, dot_sse42, axpy_sse42, gemv_sse42, gemm_micro_sse42, bias_add_sse42,
+    sigmoid_scalar<T>, relu_sse42, tanh_scalar<T>,
+    sigmoid_grad_sse42, relu_grad_sse42, tanh_grad_sse42
+};
+
+template<typename T>
+const SimdKernels<T> AVX2_KERNELS = {
+    SimdLevel::AVX2, dot_avx2, axpy_avx2, gemv_avx2, gemm_micro_avx2, bias_add_avx2,
+    sigmoid_scalar<T>, relu_avx2, tanh_scalar<T>,
+    sigmoid_grad_avx2, relu_grad_avx2, tanh_grad_avx2
+};
+
+template<typename T>
+const SimdKernels<T> AVX512_KERNELS = {
+    SimdLevel::AVX512, dot_avx512, axpy_avx512, gemv_avx512, gemm_micro_avx512, bias_add_avx512,
+    sigmoid_scalar<T>, relu_avx512, tanh_scalar<T>,
+    sigmoid_grad_avx512, relu_grad_avx512, tanh_grad_avx512
+};
+#endif
+
+SimdLevel hardware_simd_level() {
+#ifdef CNN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+} // namespace
+
+SimdLevel detect_simd_level() {
+    SimdLevel level = hardware_simd_level();
+
+    const char* cap = std::getenv("CNN_SIMD_LEVEL");
+    if (cap != nullptr) {
+        std::string name(cap);
+        SimdLevel requested = level;
+        if (name == "scalar") requested = SimdLevel::SCALAR;
+        else if (name == "sse4.2") requested = SimdLevel::SSE42;
+        else if (name == "avx2") requested = SimdLevel::AVX2;
+        else if (name == "avx512") requested = SimdLevel::AVX512;
+        if (requested < level) level = requested;
+    }
+    return level;
+}
+
+template<typename T>
+const SimdKernels<T>& simd_kernels_for(SimdLevel level) {
+    static const SimdLevel supported = hardware_simd_level();
+    if (level > supported) level = supported;
+
+    switch (level) {
+#ifdef CNN_X86
+        case SimdLevel::AVX512: return AVX512_KERNELS<T>;
+        case SimdLevel::AVX2: return AVX2_KERNELS<T>;
+        case SimdLevel::SSE42: return SSE42_KERNELS<T>;
+#endif
+        default: return SCALAR_KERNELS<T>;
+    }
+}
+
+template<typename T>
+const SimdKernels<T>& simd() {
+    static const SimdKernels<T>& kernels = simd_kernels_for<T>(detect_simd_level());
+    return kernels;
+}
+
+template const SimdKernels<float>& simd_kernels_for<float>(SimdLevel level);
+template const SimdKernels<double>& simd_kernels_for<double>(SimdLevel level);
+template const SimdKernels<float>& simd<float>();
+template const SimdKernels<double>& simd<double>();
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE42: return "SSE4.2";
+        case SimdLevel::AVX2: return "AVX2+FMA";
+        case SimdLevel::AVX512: return "AVX-512";
+        default: return "scalar";
+    }
+}